@@ -0,0 +1,80 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_CONCURRENCY_TIMER_WHEEL_HPP_20121018
+#define NETWORK_CONCURRENCY_TIMER_WHEEL_HPP_20121018
+
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <boost/asio/io_service.hpp>
+
+namespace network { namespace concurrency {
+
+  struct timer_wheel_pimpl;
+
+  // A hashed timer wheel driven by a single timer on an io_service. It is
+  // meant for large numbers of coarse-grained timeouts (think one per
+  // connection) where a timer per object would be too expensive: scheduling
+  // and cancelling are O(1) and do not allocate, because the bookkeeping
+  // lives in the timer objects that the users embed.
+  //
+  // Callbacks are invoked from the thread that runs the io_service, outside
+  // of the wheel's lock. A timer must be cancelled or destroyed before the
+  // wheel it was scheduled on goes away.
+  struct timer_wheel {
+    struct timer {
+      timer();
+      ~timer();
+      bool pending() const;
+      // Gives the timer a callback of its own, kept across expiries and
+      // cancellations, so that re-arming it with schedule(t, timeout) only
+      // re-links it. Must not be called while the timer is pending.
+      void set_callback(std::function<void()> callback);
+    private:
+      friend struct timer_wheel_pimpl;
+      // Set and cleared under the wheel's lock, but read without it by the
+      // destructor and pending().
+      std::atomic<timer_wheel_pimpl *> wheel_;
+      timer *prev_, *next_;
+      std::size_t slot_, rounds_;
+      std::shared_ptr<std::function<void()> const> callback_;
+      bool keep_callback_;
+      timer(timer const &);  // = delete
+      timer& operator=(timer const &);  // = delete
+    };
+
+    explicit timer_wheel(boost::asio::io_service &service,
+                         std::chrono::milliseconds resolution = std::chrono::milliseconds(250),
+                         std::size_t slots = 512);
+#if !defined(BOOST_NO_CXX11_DELETED_FUNCTIONS)
+    timer_wheel(timer_wheel const&) = delete;
+    timer_wheel& operator=(timer_wheel const&) = delete;
+#endif // !defined(BOOST_NO_CXX11_DELETED_FUNCTIONS)
+    ~timer_wheel();
+
+    // (Re-)arms the timer to call the callback once the timeout expires. The
+    // timeout is rounded up to the wheel's resolution.
+    void schedule(timer &t, std::chrono::milliseconds timeout, std::function<void()> callback);
+    // (Re-)arms the timer with the callback it was given by set_callback.
+    void schedule(timer &t, std::chrono::milliseconds timeout);
+    void cancel(timer &t);
+    std::size_t pending() const;
+
+    // Advances the wheel by one slot, firing what expires there. The wheel
+    // does this on its own every resolution while timers are pending; this
+    // is exposed so that it can be driven by hand.
+    void tick();
+
+  protected:
+    std::shared_ptr<timer_wheel_pimpl> pimpl;
+  };
+
+}  // namespace concurrency
+}  // namespace network
+
+#endif /* NETWORK_CONCURRENCY_TIMER_WHEEL_HPP_20121018 */
@@ -0,0 +1,195 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_CONCURRENCY_TIMER_WHEEL_IPP_20121018
+#define NETWORK_CONCURRENCY_TIMER_WHEEL_IPP_20121018
+
+#include <mutex>
+#include <vector>
+#include <network/concurrency/timer_wheel.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/assert.hpp>
+
+namespace network { namespace concurrency {
+
+  struct timer_wheel_pimpl : std::enable_shared_from_this<timer_wheel_pimpl> {
+    typedef timer_wheel::timer timer;
+
+    timer_wheel_pimpl(boost::asio::io_service &service,
+                      std::chrono::milliseconds resolution,
+                      std::size_t slots)
+    : timer_(service)
+    , resolution_(resolution.count() > 0 ? resolution : std::chrono::milliseconds(1))
+    , slots_(slots > 0 ? slots : 1, static_cast<timer *>(0))
+    , current_(0)
+    , pending_(0)
+    , ticking_(false)
+    {}
+
+    ~timer_wheel_pimpl() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t slot = 0; slot < slots_.size(); ++slot)
+        while (slots_[slot]) unlink(*slots_[slot]);
+      boost::system::error_code ignored;
+      timer_.cancel(ignored);
+    }
+
+    void schedule(timer &t, std::chrono::milliseconds timeout, std::function<void()> callback) {
+      std::shared_ptr<std::function<void()> const> shared =
+          std::make_shared<std::function<void()> const>(std::move(callback));
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (t.wheel_ == this) unlink(t);
+      t.callback_ = std::move(shared);
+      t.keep_callback_ = false;
+      link(t, timeout);
+    }
+
+    void schedule(timer &t, std::chrono::milliseconds timeout) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      BOOST_ASSERT(t.keep_callback_ && "The timer has no callback of its own.");
+      if (t.wheel_ == this) unlink(t);
+      link(t, timeout);
+    }
+
+    void cancel(timer &t) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (t.wheel_ == this) {
+        unlink(t);
+        if (!t.keep_callback_) t.callback_.reset();
+      }
+    }
+
+    std::size_t pending() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return pending_;
+    }
+
+    void tick() {
+      // Callbacks are copied out while holding the lock and invoked after it
+      // is released, so that they can re-schedule or destroy their timers.
+      std::vector<std::shared_ptr<std::function<void()> const> > expired;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = (current_ + 1) % slots_.size();
+        timer *t = slots_[current_];
+        while (t) {
+          timer *next = t->next_;
+          if (t->rounds_ == 0) {
+            expired.push_back(t->callback_);
+            if (!t->keep_callback_) t->callback_.reset();
+            unlink(*t);
+          } else {
+            --t->rounds_;
+          }
+          t = next;
+        }
+      }
+      for (auto& callback : expired)
+        if (callback && *callback) (*callback)();
+    }
+
+  private:
+    void link(timer &t, std::chrono::milliseconds timeout) {
+      BOOST_ASSERT(t.wheel_ == 0 && "A timer can only be scheduled on one wheel at a time.");
+      std::size_t ticks = static_cast<std::size_t>(
+          (timeout.count() + resolution_.count() - 1) / resolution_.count());
+      if (ticks == 0) ticks = 1;
+      t.wheel_ = this;
+      t.slot_ = (current_ + ticks) % slots_.size();
+      t.rounds_ = (ticks - 1) / slots_.size();
+      t.prev_ = 0;
+      t.next_ = slots_[t.slot_];
+      if (t.next_) t.next_->prev_ = &t;
+      slots_[t.slot_] = &t;
+      ++pending_;
+      if (!ticking_) arm();
+    }
+
+    void unlink(timer &t) {
+      if (t.prev_) t.prev_->next_ = t.next_;
+      else slots_[t.slot_] = t.next_;
+      if (t.next_) t.next_->prev_ = t.prev_;
+      t.prev_ = t.next_ = 0;
+      t.wheel_ = 0;
+      --pending_;
+    }
+
+    void arm() {
+      ticking_ = true;
+      timer_.expires_from_now(resolution_);
+      std::weak_ptr<timer_wheel_pimpl> self = shared_from_this();
+      timer_.async_wait([self](boost::system::error_code const &ec) {
+        if (ec) return;
+        if (std::shared_ptr<timer_wheel_pimpl> wheel = self.lock())
+          wheel->handle_tick();
+      });
+    }
+
+    void handle_tick() {
+      tick();
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (pending_ != 0) arm();
+      else ticking_ = false;
+    }
+
+    boost::asio::steady_timer timer_;
+    std::chrono::milliseconds resolution_;
+    std::vector<timer *> slots_;
+    std::size_t current_, pending_;
+    bool ticking_;
+    mutable std::mutex mutex_;
+  };
+
+  timer_wheel::timer::timer()
+  : wheel_(0), prev_(0), next_(0), slot_(0), rounds_(0), callback_(), keep_callback_(false)
+  {}
+
+  timer_wheel::timer::~timer() {
+    // The wheel checks again under its lock that the timer is still linked.
+    if (timer_wheel_pimpl *wheel = wheel_.load()) wheel->cancel(*this);
+  }
+
+  bool timer_wheel::timer::pending() const {
+    return wheel_.load() != 0;
+  }
+
+  void timer_wheel::timer::set_callback(std::function<void()> callback) {
+    BOOST_ASSERT(!pending() && "The callback of a pending timer cannot change.");
+    callback_ = std::make_shared<std::function<void()> const>(std::move(callback));
+    keep_callback_ = true;
+  }
+
+  timer_wheel::timer_wheel(boost::asio::io_service &service,
+                           std::chrono::milliseconds resolution,
+                           std::size_t slots)
+  : pimpl(std::make_shared<timer_wheel_pimpl>(service, resolution, slots))
+  {}
+
+  timer_wheel::~timer_wheel() {}
+
+  void timer_wheel::schedule(timer &t, std::chrono::milliseconds timeout, std::function<void()> callback) {
+    pimpl->schedule(t, timeout, std::move(callback));
+  }
+
+  void timer_wheel::schedule(timer &t, std::chrono::milliseconds timeout) {
+    pimpl->schedule(t, timeout);
+  }
+
+  void timer_wheel::cancel(timer &t) {
+    pimpl->cancel(t);
+  }
+
+  std::size_t timer_wheel::pending() const {
+    return pimpl->pending();
+  }
+
+  void timer_wheel::tick() {
+    pimpl->tick();
+  }
+
+}  // namespace concurrency
+}  // namespace network
+
+#endif /* NETWORK_CONCURRENCY_TIMER_WHEEL_IPP_20121018 */
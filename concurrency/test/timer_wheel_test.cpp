@@ -0,0 +1,110 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE timer wheel test
+#include <boost/config/warning_disable.hpp>
+#include <boost/test/unit_test.hpp>
+#include <network/concurrency/timer_wheel.hpp>
+
+using network::concurrency::timer_wheel;
+
+// These tests drive the wheel by hand through tick(), so none of them need
+// the io_service to actually run.
+
+BOOST_AUTO_TEST_CASE( fires_after_timeout ) {
+  boost::asio::io_service service;
+  timer_wheel wheel(service, std::chrono::milliseconds(100), 8);
+  timer_wheel::timer t;
+  int fired = 0;
+  wheel.schedule(t, std::chrono::milliseconds(250), [&fired] { ++fired; });
+  BOOST_CHECK(t.pending());
+  BOOST_CHECK_EQUAL(wheel.pending(), std::size_t(1));
+  wheel.tick();
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 0);
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 1);
+  BOOST_CHECK(!t.pending());
+  BOOST_CHECK_EQUAL(wheel.pending(), std::size_t(0));
+}
+
+BOOST_AUTO_TEST_CASE( timeouts_longer_than_a_revolution ) {
+  boost::asio::io_service service;
+  timer_wheel wheel(service, std::chrono::milliseconds(10), 4);
+  timer_wheel::timer t;
+  int fired = 0;
+  wheel.schedule(t, std::chrono::milliseconds(100), [&fired] { ++fired; });
+  for (int tick = 0; tick < 9; ++tick) wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 0);
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 1);
+}
+
+BOOST_AUTO_TEST_CASE( cancel_and_reschedule ) {
+  boost::asio::io_service service;
+  timer_wheel wheel(service, std::chrono::milliseconds(10), 16);
+  timer_wheel::timer first, second;
+  int fired = 0;
+  wheel.schedule(first, std::chrono::milliseconds(10), [&fired] { fired += 1; });
+  wheel.schedule(second, std::chrono::milliseconds(10), [&fired] { fired += 10; });
+  wheel.cancel(first);
+  BOOST_CHECK(!first.pending());
+  // Re-scheduling moves the timer instead of adding a second one.
+  wheel.schedule(second, std::chrono::milliseconds(30), [&fired] { fired += 100; });
+  BOOST_CHECK_EQUAL(wheel.pending(), std::size_t(1));
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 0);
+  wheel.tick();
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 100);
+}
+
+BOOST_AUTO_TEST_CASE( destroyed_timer_is_unlinked ) {
+  boost::asio::io_service service;
+  timer_wheel wheel(service, std::chrono::milliseconds(10), 16);
+  int fired = 0;
+  {
+    timer_wheel::timer t;
+    wheel.schedule(t, std::chrono::milliseconds(10), [&fired] { ++fired; });
+  }
+  BOOST_CHECK_EQUAL(wheel.pending(), std::size_t(0));
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 0);
+}
+
+BOOST_AUTO_TEST_CASE( ticks_on_its_own ) {
+  boost::asio::io_service service;
+  timer_wheel wheel(service, std::chrono::milliseconds(1), 16);
+  timer_wheel::timer t;
+  bool fired = false;
+  wheel.schedule(t, std::chrono::milliseconds(5), [&fired] { fired = true; });
+  service.run();
+  BOOST_CHECK(fired);
+  BOOST_CHECK_EQUAL(wheel.pending(), std::size_t(0));
+}
+
+BOOST_AUTO_TEST_CASE( own_callback_is_kept_across_schedules ) {
+  boost::asio::io_service service;
+  timer_wheel wheel(service, std::chrono::milliseconds(10), 16);
+  timer_wheel::timer t;
+  int fired = 0;
+  t.set_callback([&fired] { ++fired; });
+  wheel.schedule(t, std::chrono::milliseconds(10));
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 1);
+  // Neither expiring nor cancelling drops the callback.
+  wheel.schedule(t, std::chrono::milliseconds(10));
+  wheel.cancel(t);
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 1);
+  wheel.schedule(t, std::chrono::milliseconds(20));
+  wheel.tick();
+  wheel.tick();
+  BOOST_CHECK_EQUAL(fired, 2);
+  BOOST_CHECK(!t.pending());
+}
@@ -0,0 +1,192 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Measures the HTTP parsers against the messages in the corpus directory and
+// prints throughput and time per message for each of them, once with every
+// message handed over in one piece and once a byte at a time (the worst case
+// for an incremental parser).
+//
+// Corpus files are named request_*.http or response_*.http and are checked in
+// with plain line feeds; every "\n" is turned into "\r\n" when loading. A
+// request file may hold several requests back to back, which are parsed as a
+// pipelined batch.
+//
+// Usage: cpp-netlib-bench-parsers [corpus-directory [milliseconds]]
+
+#include <network/protocol/http/server/request_parser.hpp>
+#include <network/protocol/http/parser/incremental.hpp>
+#include <network/protocol/http/parser/chunked.hpp>
+#include <network/protocol/http/response/header_block.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef NETWORK_BENCH_CORPUS_DIR
+#define NETWORK_BENCH_CORPUS_DIR "corpus"
+#endif
+
+namespace http = network::http;
+namespace logic = boost::logic;
+namespace fusion = boost::fusion;
+
+namespace {
+
+typedef boost::iterator_range<char const *> range_type;
+
+struct corpus_entry {
+  std::string name, data;
+  bool is_request;
+};
+
+std::vector<corpus_entry> load_corpus(std::string const &directory) {
+  std::vector<corpus_entry> corpus;
+  boost::filesystem::directory_iterator it(directory), end;
+  for (; it != end; ++it) {
+    std::string name = it->path().filename().string();
+    if (it->path().extension() != ".http") continue;
+    std::ifstream file(it->path().string().c_str(), std::ios::binary);
+    std::string raw((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+    corpus_entry entry;
+    entry.name = name.substr(0, name.size() - 5);
+    entry.is_request = name.compare(0, 8, "request_") == 0;
+    for (std::string::const_iterator c = raw.begin(); c != raw.end(); ++c) {
+      if (*c == '\n') entry.data.push_back('\r');
+      entry.data.push_back(*c);
+    }
+    corpus.push_back(entry);
+  }
+  std::sort(corpus.begin(), corpus.end(),
+            [](corpus_entry const &l, corpus_entry const &r) { return l.name < r.name; });
+  return corpus;
+}
+
+// Keeps the compiler from discarding the work being measured.
+std::size_t volatile sink;
+
+// Parses every request in `data`, handing them over `step` bytes at a time.
+// Returns the number of requests.
+std::size_t parse_requests(std::string const &data, std::size_t step) {
+  http::request_parser parser;
+  char const *current = data.data(), *end = current + data.size();
+  std::size_t messages = 0;
+  while (current != end) {
+    parser.reset();
+    logic::tribool parsed_ok = logic::indeterminate;
+    while (logic::indeterminate(parsed_ok)) {
+      if (current == end) throw std::runtime_error("truncated request");
+      range_type input(current, current + std::min<std::size_t>(step, end - current));
+      range_type result_range;
+      fusion::tie(parsed_ok, result_range) =
+          parser.parse_until(http::request_parser::headers_done, input);
+      current = boost::end(result_range);
+    }
+    if (!parsed_ok) throw std::runtime_error("invalid request");
+    sink = parser.header_spans().size();
+    ++messages;
+  }
+  return messages;
+}
+
+// Parses a response's status line and headers, builds its header_block, and
+// then gets through the body the way the client would: by length, or with
+// the chunked parser.
+std::size_t parse_response(std::string const &data, std::size_t step) {
+  http::response_parser parser;
+  char const *begin = data.data(), *current = begin, *end = begin + data.size();
+  logic::tribool parsed_ok = logic::indeterminate;
+  while (logic::indeterminate(parsed_ok)) {
+    if (current == end) throw std::runtime_error("truncated response");
+    range_type input(current, current + std::min<std::size_t>(step, end - current));
+    range_type result_range;
+    fusion::tie(parsed_ok, result_range) =
+        parser.parse_until(http::response_parser::http_headers_done, input);
+    current = boost::end(result_range);
+  }
+  if (!parsed_ok) throw std::runtime_error("invalid response");
+  char const *headers_begin = std::search(begin, current, "\r\n", "\r\n" + 2) + 2;
+  std::string block(headers_begin, current);
+  http::header_block headers(block, parser.header_spans());
+  if (headers.contains("Transfer-Encoding")) {
+    http::chunked_parser chunks;
+    logic::tribool done = logic::indeterminate;
+    std::size_t body = 0;
+    while (logic::indeterminate(done)) {
+      if (current == end) throw std::runtime_error("truncated chunked body");
+      char const *piece_end = current + std::min<std::size_t>(step, end - current);
+      while (current != piece_end && logic::indeterminate(done)) {
+        range_type data;
+        fusion::tie(done, current, data) = chunks.parse(current, piece_end);
+        body += boost::size(data);
+      }
+    }
+    if (!done) throw std::runtime_error("invalid chunked body");
+    sink = body;
+  } else {
+    http::header_block::string_range length = headers.find("Content-Length");
+    sink = std::strtoul(std::string(boost::begin(length), boost::end(length)).c_str(), 0, 10);
+  }
+  return 1;
+}
+
+void run(corpus_entry const &entry, char const *mode, std::size_t step,
+         std::chrono::milliseconds budget) {
+  typedef std::chrono::steady_clock clock;
+  std::size_t (*parse)(std::string const &, std::size_t) =
+      entry.is_request ? &parse_requests : &parse_response;
+  // One untimed pass to warm up caches and to fail early on a bad entry.
+  std::size_t const per_pass = parse(entry.data, step);
+  std::size_t passes = 0;
+  clock::time_point const start = clock::now();
+  clock::duration elapsed;
+  do {
+    for (int batch = 0; batch < 64; ++batch) parse(entry.data, step);
+    passes += 64;
+    elapsed = clock::now() - start;
+  } while (elapsed < budget);
+  double const seconds = std::chrono::duration<double>(elapsed).count();
+  double const bytes = double(entry.data.size()) * passes;
+  double const messages = double(per_pass) * passes;
+  std::printf("%-20s %-9s %-13s %6zu %10.1f %10.1f\n",
+              entry.name.c_str(),
+              entry.is_request ? "request" : "response",
+              mode,
+              entry.data.size(),
+              bytes / seconds / (1024 * 1024),
+              seconds * 1e9 / messages);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string directory = argc > 1 ? argv[1] : NETWORK_BENCH_CORPUS_DIR;
+  std::chrono::milliseconds budget(argc > 2 ? std::atoi(argv[2]) : 200);
+  try {
+    std::vector<corpus_entry> corpus = load_corpus(directory);
+    if (corpus.empty()) {
+      std::fprintf(stderr, "no .http files in %s\n", directory.c_str());
+      return 1;
+    }
+    std::printf("%-20s %-9s %-13s %6s %10s %10s\n",
+                "corpus", "parser", "input", "bytes", "MB/s", "ns/msg");
+    for (std::vector<corpus_entry>::const_iterator it = corpus.begin();
+         it != corpus.end();
+         ++it) {
+      run(*it, "whole", it->data.size(), budget);
+      run(*it, "byte-by-byte", 1, budget);
+    }
+  } catch (std::exception const &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
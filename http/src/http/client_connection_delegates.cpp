@@ -8,7 +8,9 @@
 #undef NETWORK_NO_LIB 
 #endif
 
+#include <network/protocol/http/client/connection/connection_race.ipp>
 #include <network/protocol/http/client/connection/normal_delegate.ipp>
 #ifdef NETWORK_ENABLE_HTTPS
+#include <network/protocol/http/client/connection/tls_context.ipp>
 #include <network/protocol/http/client/connection/ssl_delegate.ipp>
 #endif
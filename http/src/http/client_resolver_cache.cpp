@@ -1,4 +1,3 @@
-// Copyright 2010 Dean Michael Berris. 
 // Copyright 2012 Google, Inc.
 // Distributed under the Boost Software License, Version 1.0.
 // (See accompanying file LICENSE_1_0.txt or copy at
@@ -8,5 +7,4 @@
 #undef NETWORK_NO_LIB
 #endif
 
-#include <network/protocol/http/server/impl/parsers.ipp>
-
+#include <network/protocol/http/client/connection/resolver_cache.ipp>
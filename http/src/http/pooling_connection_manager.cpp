@@ -0,0 +1,10 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef NETWORK_NO_LIB
+#undef NETWORK_NO_LIB
+#endif
+
+#include <network/protocol/http/client/pooling_connection_manager.ipp>
@@ -9,7 +9,9 @@
 #endif
 
 #include <network/protocol/http/response/response_base.ipp>
+#include <network/protocol/http/response/header_block.ipp>
 #include <network/protocol/http/response/response.ipp>
+#include <network/protocol/http/response/response_state.ipp>
 
 #include <network/protocol/http/message/wrappers/status.ipp>
 #include <network/protocol/http/message/wrappers/status_message.ipp>
@@ -0,0 +1,7 @@
+// Copyright 2012 Dean Michael Berris <dberris@google.com>.
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <network/protocol/http/server/connection/pool.ipp>
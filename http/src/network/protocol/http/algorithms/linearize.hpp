@@ -12,6 +12,7 @@
 #include <network/protocol/http/message/header_concept.hpp>
 #include <network/protocol/http/request/request_concept.hpp>
 #include <network/constants.hpp>
+#include <network/message/header_storage.hpp>
 #include <boost/concept/requires.hpp>
 #include <boost/optional.hpp>
 #include <boost/lexical_cast.hpp>
@@ -143,8 +144,8 @@ BOOST_CONCEPT_REQUIRES(
         *oi = consts::space_char();
         boost::copy(header_value, oi);
         boost::copy(crlf, oi);
-        boost::to_lower(header_name);
-        has_user_agent = has_user_agent || header_name == "user-agent";
+        has_user_agent = has_user_agent ||
+                         lookup_header(header_name) == user_agent_header;
     }
     if (!has_user_agent) {
       boost::copy(user_agent, oi);
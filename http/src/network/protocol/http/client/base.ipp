@@ -7,8 +7,10 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_ASYNC_IMPL_HPP_20100623
 #define NETWORK_PROTOCOL_HTTP_CLIENT_ASYNC_IMPL_HPP_20100623
 
-#include <thread>
+#include <atomic>
 #include <functional>
+#include <thread>
+#include <vector>
 #include <network/protocol/http/client/base.hpp>
 #include <network/protocol/http/client/options.hpp>
 #include <boost/asio/io_service.hpp>
@@ -33,12 +35,17 @@ struct client_base_pimpl {
   void clear_resolved_cache();
   ~client_base_pimpl();
  private:
+  // Picks the io_service the next new connection is bound to.
+  boost::asio::io_service & next_service();
+  void run(boost::asio::io_service * service);
+
   client_options options_;
-  boost::asio::io_service * service_ptr;
-  std::shared_ptr<boost::asio::io_service::work> sentinel_;
-  std::shared_ptr<std::thread> lifetime_thread_;
+  std::vector<boost::asio::io_service *> services_;
+  std::vector<std::shared_ptr<boost::asio::io_service> > owned_services_;
+  std::vector<std::shared_ptr<boost::asio::io_service::work> > sentinels_;
+  std::vector<std::thread> lifetime_threads_;
+  std::atomic<std::size_t> next_service_;
   std::shared_ptr<connection_manager> connection_manager_;
-  bool owned_service_;
 };
 
 client_base::client_base()
@@ -71,38 +78,47 @@ client_base::~client_base() {
 
 client_base_pimpl::client_base_pimpl(client_options const &options)
   : options_(options),
-  service_ptr(options.io_service()),
-  sentinel_(),
-  connection_manager_(options.connection_manager()),
-  owned_service_(false) {
+  next_service_(0),
+  connection_manager_(options.connection_manager()) {
   NETWORK_MESSAGE("client_base_pimpl::client_base_pimpl(client_options const &)");
-  if (service_ptr == 0) {
-    NETWORK_MESSAGE("creating owned io_service.");
-    service_ptr = new boost::asio::io_service;
-    owned_service_ = true;
+  std::size_t const threads = options.io_threads();
+  if (options.io_service()) {
+    services_.push_back(options.io_service());
+  } else {
+    NETWORK_MESSAGE("creating " << threads << " owned io_service(s).");
+    // Each owned io_service is only ever run by one thread.
+    for (std::size_t i = 0; i < threads; ++i) {
+      owned_services_.push_back(std::make_shared<boost::asio::io_service>(1));
+      services_.push_back(owned_services_.back().get());
+    }
   }
   if (!connection_manager_.get()) {
     NETWORK_MESSAGE("creating owned simple_connection_manager");
     connection_manager_.reset(
         new  simple_connection_manager(options));
   }
-  sentinel_.reset(new  boost::asio::io_service::work(*service_ptr));
-  auto local_ptr = service_ptr;
-  lifetime_thread_.reset(new  std::thread([local_ptr]() { local_ptr->run(); }));
-  if (!lifetime_thread_.get())
-    BOOST_THROW_EXCEPTION(std::runtime_error("Cannot allocate client lifetime thread; not enough memory."));
+  for (std::size_t i = 0; i < services_.size(); ++i)
+    sentinels_.push_back(std::make_shared<boost::asio::io_service::work>(*services_[i]));
+  for (std::size_t i = 0; i < threads; ++i)
+    run(services_[i % services_.size()]);
 }
 
 client_base_pimpl::~client_base_pimpl()
 {
   NETWORK_MESSAGE("client_base_pimpl::~client_base_pimpl()");
-  sentinel_.reset();
+  sentinels_.clear();
   connection_manager_->reset();
-  if (lifetime_thread_.get()) {
-    lifetime_thread_->join();
-    lifetime_thread_.reset();
-  }
-  if (owned_service_) delete service_ptr;
+  for (std::size_t i = 0; i < lifetime_threads_.size(); ++i)
+    lifetime_threads_[i].join();
+  lifetime_threads_.clear();
+}
+
+void client_base_pimpl::run(boost::asio::io_service * service) {
+  lifetime_threads_.emplace_back([service]() { service->run(); });
+}
+
+boost::asio::io_service & client_base_pimpl::next_service() {
+  return *services_[next_service_++ % services_.size()];
 }
 
 response const client_base_pimpl::request_skeleton(
@@ -115,7 +131,11 @@ response const client_base_pimpl::request_skeleton(
 {
   NETWORK_MESSAGE("client_base_pimpl::request_skeleton(...)");
   std::shared_ptr<client_connection> connection_;
-  connection_ = connection_manager_->get_connection(*service_ptr, request_, options_);
+  // A connection on any of the client's io_services will do; one is only
+  // picked for a new connection.
+  connection_ = connection_manager_->get_connection(
+      services_, [this]() -> boost::asio::io_service & { return next_service(); },
+      request_, options_);
   return connection_->send_request(method, request_, get_body, callback, options);
 }
 
@@ -23,6 +23,10 @@ struct client_connection {
     void(boost::iterator_range<char const *> const &,
          boost::system::error_code const &)>
     callback_type;
+  // Called once the response to the last request has been read, with true
+  // when the connection can carry another request and false when it has
+  // been closed. Connection managers use it to take connections back.
+  typedef std::function<void(bool)> release_callback_type;
   virtual response send_request(std::string const & method,
                                 request const & request,
                                 bool get_body,
@@ -30,6 +34,8 @@ struct client_connection {
                                 request_options const &options) = 0;
   virtual client_connection * clone() const = 0;
   virtual void reset() = 0;
+  virtual void set_release_callback(release_callback_type callback);
+  virtual bool is_open();
   virtual ~client_connection() = 0;
 };
 
@@ -25,6 +25,16 @@ client_connection * client_connection::clone() const {
   return 0;
 }
 
+void client_connection::set_release_callback(release_callback_type callback) {
+  NETWORK_MESSAGE("client_connection::set_release_callback(...)");
+  // Connections that cannot be reused have nothing to report.
+}
+
+bool client_connection::is_open() {
+  NETWORK_MESSAGE("client_connection::is_open()");
+  return false;
+}
+
 
 } /* http */
   
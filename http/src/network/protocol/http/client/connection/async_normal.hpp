@@ -9,6 +9,7 @@
 #ifndef NETWORK_PROTOCOL_HTTP_IMPL_HTTP_ASYNC_CONNECTION_HPP_20100601
 #define NETWORK_PROTOCOL_HTTP_IMPL_HTTP_ASYNC_CONNECTION_HPP_20100601
 
+#include <cstddef>
 #include <memory>
 #include <utility>
 #include <network/protocol/http/client/client_connection.hpp>
@@ -30,10 +31,12 @@ struct http_async_connection_pimpl;
 struct http_async_connection : client_connection
                              , std::enable_shared_from_this<http_async_connection> {
   using client_connection::callback_type;
+  using client_connection::release_callback_type;
   http_async_connection(std::shared_ptr<resolver_delegate> resolver_delegate,
                         std::shared_ptr<connection_delegate> connection_delegate,
                         boost::asio::io_service & io_service,
-                        bool follow_redirects);
+                        bool follow_redirects,
+                        std::size_t pipeline_depth = 1);
   http_async_connection * clone() const;
   virtual response send_request(std::string const & method,
                                 request const & request,
@@ -41,6 +44,8 @@ struct http_async_connection : client_connection
                                 callback_type callback,
                                 request_options const &options);  // override
   virtual void reset();  // override
+  virtual void set_release_callback(release_callback_type callback);  // override
+  virtual bool is_open();  // override
   virtual ~http_async_connection();
  private:
   explicit http_async_connection(std::shared_ptr<http_async_connection_pimpl>);
@@ -7,15 +7,33 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_ASYNC_NORMAL_IPP_20111123
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_ASYNC_NORMAL_IPP_20111123
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <stdexcept>
 #include <utility>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/buffer.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/bind.hpp>
 #include <network/protocol/http/client/connection/async_normal.hpp>
 #include <network/protocol/http/request.hpp>
 #include <network/protocol/http/response.hpp>
+#include <network/protocol/http/response/header_block.hpp>
+#include <network/protocol/http/response/response_state.hpp>
+#include <network/protocol/http/errors.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/protocol/http/parser/chunked.hpp>
+#include <network/protocol/http/server/impl/request_scan.hpp>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 #include <network/protocol/http/client/connection/resolver_delegate.hpp>
 #include <network/protocol/http/algorithms/linearize.hpp>
@@ -33,54 +51,103 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
   typedef resolver_delegate::resolver_iterator resolver_iterator;
   typedef resolver_delegate::iterator_pair resolver_iterator_pair;
   typedef http_async_connection_pimpl this_type;
+  typedef boost::array<char, NETWORK_BUFFER_CHUNK> buffer_type;
+  typedef std::function<void(boost::system::error_code, size_t)> read_callback_type;
+  typedef std::chrono::steady_clock clock;
+
+  // A request and the state of its response. Requests wait in unsent_
+  // until they are written and then in in_flight_ until their response has
+  // been read; responses come back in the order the requests went out.
+  struct exchange {
+    exchange()
+    : port(0), get_body(false), retried(false), body_started(false), timed_out(false),
+      upload_started(false) {}
+    // A request dropped before its response was read fails it, so nobody
+    // is left waiting on the response.
+    ~exchange() {
+      if (state)
+        state->fail(std::make_exception_ptr(
+            boost::system::system_error(boost::asio::error::operation_aborted)));
+    }
+    std::string method, command, host;
+    boost::uint16_t port;
+    bool get_body;
+    body_callback_function_type callback;
+    request_options options;
+    // When the whole request runs out of time.
+    clock::time_point deadline;
+    bool retried, body_started, timed_out;
+    // Where a streamed request body comes from, and how much of it is left
+    // to send when its length is known; see request_options::body_producer.
+    request_options::body_producer_function_type producer;
+    boost::optional<uint64_t> upload_left;
+    bool upload_started;
+    // Shared with the responses handed out for the request.
+    std::shared_ptr<response_state> state;
+  };
+  typedef std::shared_ptr<exchange> exchange_ptr;
 
   http_async_connection_pimpl(
     std::shared_ptr<resolver_delegate> resolver_delegate,
     std::shared_ptr<connection_delegate> connection_delegate,
     boost::asio::io_service & io_service,
-    bool follow_redirect)
+    bool follow_redirect,
+    std::size_t pipeline_depth)
   :
         follow_redirect_(follow_redirect),
+        pipeline_depth_(pipeline_depth ? pipeline_depth : 1),
         request_strand_(io_service),
+        timer_(io_service),
+        timer_expiry_(clock::time_point::max()),
+        phase_(no_phase),
+        phase_deadline_(clock::time_point::max()),
         resolver_delegate_(resolver_delegate),
-        connection_delegate_(connection_delegate) {
+        connection_delegate_(connection_delegate),
+        framing_(framed_by_close),
+        body_remaining_(0),
+        keep_alive_(false),
+        response_started_(false),
+        port_(0),
+        generation_(0),
+        connecting_(false),
+        connected_(false),
+        writing_(false),
+        reading_(false),
+        pipelining_(pipeline_depth > 1) {
     NETWORK_MESSAGE("http_async_connection_pimpl::http_async_connection_pimpl(...)");
+    part_begin = part.begin();
   }
 
   // This is the main entry point for the connection/request pipeline. We're
   // overriding async_connection_base<...>::start(...) here which is called
-  // by the client.
+  // by the client. The request is queued behind any others that are already
+  // on this connection; everything from here on happens in the strand.
   response start(request const & request,
                  std::string const & method,
                  bool get_body,
                  body_callback_function_type callback,
                  request_options const &options) {
     NETWORK_MESSAGE("http_async_connection_pimpl::start(...)");
+    exchange_ptr exchange_(std::make_shared<exchange>());
     response response_;
-    this->init_response(response_);
+    this->init_response(response_, *exchange_);
     // Use HTTP/1.1 -- at some point we might want to implement a different
     // connection type just for HTTP/1.0.
     // TODO: Implement a different connection type and factory for HTTP/1.0.
-    linearize(request, method, 1, 1,
-      std::ostreambuf_iterator<char>(&command_streambuf));
-    this->method = method;
-    NETWORK_MESSAGE("method: " << this->method);
-    boost::uint16_t port_ = port(request);
-    NETWORK_MESSAGE("port: " << port_);
-    this->host_ = host(request);
-    
-    resolver_delegate_->resolve(
-        this->host_,
-        port_,
-        request_strand_.wrap(
-            boost::bind(
-                &this_type::handle_resolved,
-                this_type::shared_from_this(),
-                port_,
-                get_body,
-                callback,
-                boost::asio::placeholders::error,
-                boost::asio::placeholders::bytes_transferred)));
+    linearize(request, method, 1, 1, std::back_inserter(exchange_->command));
+    exchange_->method = method;
+    NETWORK_MESSAGE("method: " << exchange_->method);
+    exchange_->port = port(request);
+    NETWORK_MESSAGE("port: " << exchange_->port);
+    exchange_->host = host(request);
+    exchange_->get_body = get_body;
+    exchange_->callback = callback;
+    exchange_->options = options;
+    exchange_->producer = options.body_producer();
+    exchange_->upload_left = options.body_length();
+    exchange_->deadline = deadline_after(options.timeout());
+    request_strand_.post(
+        boost::bind(&this_type::enqueue, this_type::shared_from_this(), exchange_));
     return response_;
   }
 
@@ -90,119 +157,416 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
         this->resolver_delegate_,
         this->connection_delegate_,
         request_strand_.get_io_service(),
-        follow_redirect_);
+        follow_redirect_,
+        pipeline_depth_);
   }
 
+  // The response state is reset as each response is read, so this only
+  // clears what is left over when nothing is queued. The socket is left
+  // alone so that a connection that was released as reusable stays open.
   void reset() {
-    // FIXME Perform the actual re-set of the internal state and pending stuff.
+    NETWORK_MESSAGE("http_async_connection_pimpl::reset()");
+    request_strand_.post(
+        boost::bind(&this_type::reset_if_idle, this_type::shared_from_this()));
+  }
+
+  void set_release_callback(http_async_connection::release_callback_type callback) {
+    release_callback_ = callback;
+  }
+
+  bool is_open() {
+    return connected_ && connection_delegate_->is_open();
   }
 
  private:
 
   http_async_connection_pimpl(http_async_connection_pimpl const &); // = delete
 
-  void init_response(response &r) {
+  void init_response(response &r, exchange &exchange_) {
     NETWORK_MESSAGE("http_async_connection_pimpl::init_response(...)");
-    impl::setter_access accessor;
-    accessor.set_source_promise(r, this->source_promise);
-    accessor.set_destination_promise(r, this->destination_promise);
-    accessor.set_headers_promise(r, this->headers_promise);
-    accessor.set_body_promise(r, this->body_promise);
-    accessor.set_version_promise(r, this->version_promise);
-    accessor.set_status_promise(r, this->status_promise);
-    accessor.set_status_message_promise(r, this->status_message_promise);
-    NETWORK_MESSAGE("futures and promises lined up.");
-  }
-
-  void set_errors(boost::system::error_code const & ec) {
-    NETWORK_MESSAGE("http_async_connection_pimpl::set_errors(...)");
+    exchange_.state = std::make_shared<response_state>();
+    impl::setter_access().set_response_state(r, exchange_.state);
+  }
+
+  // Fails every part of the response that has not been delivered yet.
+  static void fail(exchange & exchange_, std::exception_ptr error) {
+    exchange_.state->fail(error);
+  }
+
+  static void fail(exchange & exchange_, boost::system::error_code const & ec) {
     NETWORK_MESSAGE("error: " << ec);
-    boost::system::system_error error(ec);
-    this->version_promise.set_exception(std::make_exception_ptr(error));
-    this->status_promise.set_exception(std::make_exception_ptr(error));
-    this->status_message_promise.set_exception(std::make_exception_ptr(error));
-    this->headers_promise.set_exception(std::make_exception_ptr(error));
-    this->source_promise.set_exception(std::make_exception_ptr(error));
-    this->destination_promise.set_exception(std::make_exception_ptr(error));
-    this->body_promise.set_exception(std::make_exception_ptr(error));
-    NETWORK_MESSAGE("promise+future exceptions set.");
-  }
-
-  void handle_resolved(boost::uint16_t port,
-                       bool get_body,
-                       body_callback_function_type callback,
+    fail(exchange_, std::make_exception_ptr(boost::system::system_error(ec)));
+  }
+
+  // Requests that may be sent again after a connection drops without their
+  // response, and that may have other requests pipelined behind them.
+  static bool is_idempotent(std::string const & method) {
+    return method == "GET" || method == "HEAD" || method == "PUT" ||
+        method == "DELETE" || method == "OPTIONS" || method == "TRACE";
+  }
+
+  static clock::time_point deadline_after(uint64_t milliseconds) {
+    return milliseconds ? clock::now() + std::chrono::milliseconds(milliseconds)
+                        : clock::time_point::max();
+  }
+
+  // Fails an exchange that ran out of time. A callback that is already
+  // getting the body is told as well, since it would otherwise never hear
+  // of the end of it.
+  void expire(exchange & exchange_, char const * message) {
+    NETWORK_MESSAGE("timed out: " << message);
+    exchange_.timed_out = true;
+    if (exchange_.callback && exchange_.body_started) {
+      buffer_type::const_iterator end = this->part.end();
+      exchange_.callback(boost::make_iterator_range(end, end), boost::asio::error::timed_out);
+    }
+    fail(exchange_, std::make_exception_ptr(errors::connection_timeout_exception(message)));
+  }
+
+  exchange & front() {
+    BOOST_ASSERT(!in_flight_.empty());
+    return *in_flight_.front();
+  }
+
+  // Tells whoever set the release callback that one more request is done
+  // with this connection.
+  void release(bool reusable) {
+    NETWORK_MESSAGE("http_async_connection_pimpl::release(" << reusable << ")");
+    http_async_connection::release_callback_type callback = release_callback_;
+    if (callback) callback(reusable);
+  }
+
+  void retire_front(bool reusable) {
+    in_flight_.pop_front();
+    release(reusable);
+  }
+
+  void enqueue(exchange_ptr exchange_) {
+    NETWORK_MESSAGE("http_async_connection_pimpl::enqueue(...)");
+    unsent_.push_back(exchange_);
+    resume();
+  }
+
+  // Gets the next queued request going: connects if need be, or writes as
+  // many requests as the pipeline depth allows.
+  void resume() {
+    send_next();
+    schedule_timeout();
+  }
+
+  void send_next() {
+    if (unsent_.empty() || connecting_ || writing_) return;
+    exchange const & next = *unsent_.front();
+    if (connected_ && (next.host != host_ || next.port != port_)) {
+      // The responses still coming in on this connection go first.
+      if (!in_flight_.empty()) return;
+      close();
+    }
+    if (!connected_) {
+      connect(next.host, next.port);
+      return;
+    }
+    flush();
+  }
+
+  void flush() {
+    std::size_t const depth = pipelining_ ? pipeline_depth_ : 1;
+    while (!unsent_.empty() && in_flight_.size() < depth) {
+      exchange_ptr next = unsent_.front();
+      if (next->host != host_ || next->port != port_) break;
+      // A request that is not idempotent cannot be sent again if the
+      // connection drops, so nothing is pipelined with it.
+      if (!in_flight_.empty() &&
+          !(is_idempotent(next->method) && is_idempotent(in_flight_.back()->method)))
+        break;
+      std::size_t size = boost::asio::buffer_copy(
+          command_streambuf.prepare(next->command.size()),
+          boost::asio::buffer(next->command));
+      command_streambuf.commit(size);
+      unsent_.pop_front();
+      in_flight_.push_back(next);
+      // Its body follows the request, so nothing goes out behind it until
+      // the body is done.
+      if (next->producer) {
+        uploading_ = next;
+        break;
+      }
+    }
+    if (command_streambuf.size() == 0) return;
+    NETWORK_MESSAGE("scheduling write of " << in_flight_.size() << " request(s)...");
+    writing_ = true;
+    connection_delegate_->write(command_streambuf,
+                     request_strand_.wrap(
+                         boost::bind(
+                             &this_type::handle_sent_request,
+                             this_type::shared_from_this(),
+                             generation_,
+                             boost::asio::placeholders::error,
+                             boost::asio::placeholders::bytes_transferred)));
+  }
+
+  void connect(std::string const & host, boost::uint16_t port) {
+    NETWORK_MESSAGE("connecting to " << host << ":" << port);
+    connecting_ = true;
+    this->host_ = host;
+    this->port_ = port;
+    start_phase(resolve_phase, &request_options::resolve_timeout);
+    resolver_delegate_->resolve(
+        this->host_,
+        this->port_,
+        request_strand_.wrap(
+            boost::bind(
+                &this_type::handle_resolved,
+                this_type::shared_from_this(),
+                generation_,
+                this->port_,
+                boost::asio::placeholders::error,
+                boost::asio::placeholders::bytes_transferred)));
+  }
+
+  // Forgets the socket along with whatever reads and writes are still
+  // pending on it; their handlers find the generation changed and return.
+  void close() {
+    NETWORK_MESSAGE("http_async_connection_pimpl::close()");
+    ++generation_;
+    // Closing the socket also cancels a connection attempt in progress.
+    if (connected_ || connecting_) connection_delegate_->disconnect();
+    connecting_ = connected_ = writing_ = reading_ = false;
+    phase_ = no_phase;
+    command_streambuf.consume(command_streambuf.size());
+    uploading_.reset();
+    reset_response_state();
+  }
+
+  void reset_response_state() {
+    response_parser_.reset();
+    content_length_ = boost::none;
+    framing_ = framed_by_close;
+    body_remaining_ = 0;
+    chunked_parser_.reset();
+    keep_alive_ = false;
+    partial_parsed.clear();
+    part_begin = part.begin();
+    response_started_ = false;
+  }
+
+  void reset_if_idle() {
+    if (unsent_.empty() && in_flight_.empty() && !connecting_)
+      reset_response_state();
+  }
+
+  // The connection cannot carry anything more. The front request is handed
+  // back when `front_done` is set; the requests behind it are sent again on
+  // a new connection, one at a time if they had been pipelined.
+  void drop_connection(bool front_done, boost::system::error_code const & ec) {
+    NETWORK_MESSAGE("http_async_connection_pimpl::drop_connection(...)");
+    if (in_flight_.size() > 1) {
+      NETWORK_MESSAGE("connection closed in the middle of a pipeline");
+      pipelining_ = false;
+    }
+    close();
+    if (front_done) retire_front(false);
+    while (!in_flight_.empty()) {
+      exchange_ptr lost = in_flight_.back();
+      in_flight_.pop_back();
+      if (lost->timed_out) {
+        release(false);
+      } else if (!lost->retried && is_idempotent(lost->method) && !lost->upload_started) {
+        lost->retried = true;
+        unsent_.push_front(lost);
+      } else {
+        fail(*lost, ec);
+        release(false);
+      }
+    }
+    resume();
+  }
+
+  void connection_lost(boost::system::error_code const & ec) {
+    NETWORK_MESSAGE("http_async_connection_pimpl::connection_lost(" << ec << ")");
+    // A response that had started to arrive cannot be asked for again.
+    bool const started = !in_flight_.empty() && response_started_;
+    if (started) fail(front(), ec);
+    drop_connection(started, ec);
+  }
+
+  void connect_failed(boost::system::error_code const & ec) {
+    NETWORK_MESSAGE("error: " << ec);
+    connect_failed(std::make_exception_ptr(boost::system::system_error(ec)));
+  }
+
+  void connect_failed(std::exception_ptr error) {
+    NETWORK_MESSAGE("error encountered while connecting.");
+    connecting_ = false;
+    phase_ = no_phase;
+    std::deque<exchange_ptr> failed;
+    std::swap(failed, unsent_);
+    for (std::deque<exchange_ptr>::iterator it = failed.begin(); it != failed.end(); ++it) {
+      fail(**it, error);
+      release(false);
+    }
+    schedule_timeout();
+  }
+
+  // The phases with a deadline of their own, besides the deadline of each
+  // request as a whole.
+  enum phase_t {
+    no_phase, resolve_phase, connect_phase, handshake_phase, first_byte_phase
+  };
+
+  // Starts timing a phase against the deadline that the request it is for
+  // set: the next one to be sent while connecting, or the one whose
+  // response is awaited.
+  void start_phase(phase_t phase, uint64_t (request_options::*timeout)() const) {
+    exchange const * owner = 0;
+    if (phase == first_byte_phase)
+      owner = in_flight_.empty() ? 0 : in_flight_.front().get();
+    else
+      owner = unsent_.empty() ? 0 : unsent_.front().get();
+    phase_ = phase;
+    phase_deadline_ = owner ? deadline_after((owner->options.*timeout)())
+                            : clock::time_point::max();
+    schedule_timeout();
+  }
+
+  // Sets the timer for the earliest deadline there is, or stops it when
+  // there is none.
+  void schedule_timeout() {
+    clock::time_point earliest = clock::time_point::max();
+    if (phase_ != no_phase) earliest = phase_deadline_;
+    for (std::deque<exchange_ptr>::const_iterator it = unsent_.begin(); it != unsent_.end(); ++it)
+      earliest = std::min(earliest, (*it)->deadline);
+    for (std::deque<exchange_ptr>::const_iterator it = in_flight_.begin(); it != in_flight_.end(); ++it)
+      earliest = std::min(earliest, (*it)->deadline);
+    if (earliest == timer_expiry_) return;
+    timer_expiry_ = earliest;
+    if (earliest == clock::time_point::max()) {
+      boost::system::error_code ignored;
+      timer_.cancel(ignored);
+      return;
+    }
+    timer_.expires_at(earliest);
+    timer_.async_wait(
+        request_strand_.wrap(
+            boost::bind(&this_type::handle_timeout,
+                        this_type::shared_from_this(),
+                        boost::asio::placeholders::error)));
+  }
+
+  void handle_timeout(boost::system::error_code const & ec) {
+    if (ec == boost::asio::error::operation_aborted) return;
+    NETWORK_MESSAGE("http_async_connection_pimpl::handle_timeout(...)");
+    timer_expiry_ = clock::time_point::max();
+    clock::time_point const now = clock::now();
+    if (phase_ != no_phase && now >= phase_deadline_) {
+      phase_t const expired = phase_;
+      phase_ = no_phase;
+      if (expired == first_byte_phase) {
+        if (!in_flight_.empty()) {
+          expire(front(), "Timed out waiting for the response.");
+          connection_lost(boost::asio::error::timed_out);
+        }
+      } else {
+        close();
+        connect_failed(std::make_exception_ptr(errors::connection_timeout_exception(
+            expired == resolve_phase ? "Timed out resolving the host." :
+            expired == connect_phase ? "Timed out connecting to the host." :
+                                       "Timed out during the TLS handshake.")));
+      }
+    }
+    std::deque<exchange_ptr>::iterator it = unsent_.begin();
+    while (it != unsent_.end()) {
+      if ((*it)->deadline <= now) {
+        exchange_ptr expired = *it;
+        it = unsent_.erase(it);
+        expire(*expired, "Request timed out.");
+        release(false);
+      } else {
+        ++it;
+      }
+    }
+    // A response that is cut short leaves the rest of the stream unusable,
+    // so the connection goes and the others are sent again.
+    bool cut_short = false;
+    for (it = in_flight_.begin(); it != in_flight_.end(); ++it) {
+      if ((*it)->deadline <= now && !(*it)->timed_out) {
+        expire(**it, "Request timed out.");
+        cut_short = true;
+      }
+    }
+    if (cut_short) connection_lost(boost::asio::error::timed_out);
+    if (unsent_.empty() && connecting_) {
+      // Nobody is waiting for the connection any more.
+      close();
+    }
+    schedule_timeout();
+  }
+
+  void handle_resolved(std::size_t generation,
+                       boost::uint16_t port,
                        boost::system::error_code const & ec,
                        resolver_iterator_pair endpoint_range) {
     NETWORK_MESSAGE("http_async_connection_pimpl::handle_resolved(...)");
+    if (generation != generation_) return;
     if (!ec && !boost::empty(endpoint_range)) {
       // Here we deal with the case that there was no error encountered.
       NETWORK_MESSAGE("resolved endpoint successfully");
-      resolver_iterator iter = boost::begin(endpoint_range);
-      NETWORK_MESSAGE("trying connection to: "
-                            << iter->endpoint().address() << ":" << port);
-      boost::asio::ip::tcp::endpoint endpoint(iter->endpoint().address(), port);
-      
-      connection_delegate_->connect(
-          endpoint,
+      std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+      for (resolver_iterator iter = boost::begin(endpoint_range);
+           iter != boost::end(endpoint_range);
+           ++iter) {
+        NETWORK_MESSAGE("candidate: " << iter->endpoint().address() << ":" << port);
+        endpoints.push_back(boost::asio::ip::tcp::endpoint(iter->endpoint().address(), port));
+      }
+
+      start_phase(connect_phase, &request_options::connect_timeout);
+      connection_delegate_->connect_to_any(
+          endpoints,
           this->host_,
           request_strand_.wrap(
               boost::bind(
                   &this_type::handle_connected,
                   this_type::shared_from_this(),
-                  port,
-                  get_body,
-                  callback,
-                  std::make_pair(++iter,
-                                 resolver_iterator()),
+                  generation,
                   boost::asio::placeholders::error)));
     } else {
-      NETWORK_MESSAGE("error encountered while resolving.");
-      set_errors(ec ? ec : boost::asio::error::host_not_found);
+      connect_failed(ec ? ec : boost::asio::error::host_not_found);
     }
   }
 
-  void handle_connected(boost::uint16_t port,
-                        bool get_body,
-                        body_callback_function_type callback,
-                        resolver_iterator_pair endpoint_range,
+  void handle_connected(std::size_t generation,
                         boost::system::error_code const & ec) {
     NETWORK_MESSAGE("http_async_connection_pimpl::handle_connected(...)");
+    if (generation != generation_) return;
     if (!ec) {
       NETWORK_MESSAGE("connected successfully");
       BOOST_ASSERT(connection_delegate_.get() != 0);
-      NETWORK_MESSAGE("scheduling write...");
-      
-      connection_delegate_->write(command_streambuf,
-                       request_strand_.wrap(
-                           boost::bind(
-                               &this_type::handle_sent_request,
-                               this_type::shared_from_this(),
-                               get_body,
-                               callback,
-                               boost::asio::placeholders::error,
-                               boost::asio::placeholders::bytes_transferred)));
+      start_phase(handshake_phase, &request_options::handshake_timeout);
+      connection_delegate_->handshake(
+          request_strand_.wrap(
+              boost::bind(
+                  &this_type::handle_handshake,
+                  this_type::shared_from_this(),
+                  generation,
+                  boost::asio::placeholders::error)));
     } else {
       NETWORK_MESSAGE("connection unsuccessful");
-      if (!boost::empty(endpoint_range)) {
-        resolver_iterator iter = boost::begin(endpoint_range);
-        NETWORK_MESSAGE("trying: " << iter->endpoint().address() << ":" << port);
-        boost::asio::ip::tcp::endpoint endpoint(iter->endpoint().address(), port);
-        
-        connection_delegate_->connect(endpoint,
-                           this->host_,
-                           request_strand_.wrap(
-                               boost::bind(
-                                   &this_type::handle_connected,
-                                   this_type::shared_from_this(),
-                                   port,
-                                   get_body,
-                                   callback,
-                                   std::make_pair(++iter,
-                                                  resolver_iterator()),
-                                   boost::asio::placeholders::error)));
-      } else {
-        set_errors(ec ? ec : boost::asio::error::host_not_found);
-      }
+      connect_failed(ec);
+    }
+  }
+
+  void handle_handshake(std::size_t generation, boost::system::error_code const & ec) {
+    NETWORK_MESSAGE("http_async_connection_pimpl::handle_handshake(...)");
+    if (generation != generation_) return;
+    if (!ec) {
+      connecting_ = false;
+      connected_ = true;
+      phase_ = no_phase;
+      resume();
+    } else {
+      NETWORK_MESSAGE("handshake unsuccessful");
+      close();
+      connect_failed(ec);
     }
   }
 
@@ -210,31 +574,129 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
     version, status, status_message, headers, body
   };
 
-  void handle_sent_request(bool get_body,
-                           body_callback_function_type callback,
+  void handle_sent_request(std::size_t generation,
                            boost::system::error_code const & ec,
                            std::size_t bytes_transferred) {
     NETWORK_MESSAGE("http_async_connection_pimpl::handle_sent_request(...)");
+    if (generation != generation_) return;
+    writing_ = false;
     if (!ec) {
-      NETWORK_MESSAGE("request sent successfuly; scheduling partial read...");
-      
-      connection_delegate_->read_some(
-          boost::asio::mutable_buffers_1(this->part.c_array(),
-                                         this->part.size()),
-          request_strand_.wrap(
-              boost::bind(&this_type::handle_received_data,
-                          this_type::shared_from_this(),
-                          version, get_body, callback,
-                          boost::asio::placeholders::error,
-                          boost::asio::placeholders::bytes_transferred)));
+      NETWORK_MESSAGE("request sent successfuly");
+      if (uploading_) {
+        send_body_piece();
+        if (generation != generation_) return;
+      }
+      // The wait for the response starts once the body is out.
+      if (!reading_ && !in_flight_.empty() && !uploading_) {
+        NETWORK_MESSAGE("scheduling partial read...");
+        reading_ = true;
+        start_phase(first_byte_phase, &request_options::first_byte_timeout);
+        read_more(version);
+      }
+      resume();
+    } else {
+      NETWORK_MESSAGE("request sent unsuccessfully");
+      connection_lost(ec);
+    }
+  }
+
+  // Writes the next piece of the body being streamed, chunked when its
+  // length is not known. The producer fills the write buffer directly, after
+  // the room left for the chunk size, and is only called again once the
+  // piece has been written.
+  void send_body_piece() {
+    exchange & upload = *uploading_;
+    // An upload that is still moving gets its full timeout again, so a long
+    // body only times out when a piece of it stalls; the last piece starts
+    // the wait for the response.
+    request_options const & options = upload.options;
+    upload.deadline = deadline_after(options.timeout());
+    bool const chunked = !upload.upload_left;
+    std::size_t room = upload_piece_size;
+    if (!chunked && *upload.upload_left < room)
+      room = static_cast<std::size_t>(*upload.upload_left);
+    std::size_t const prefix = chunked ? chunk_prefix_size : 0;
+    std::size_t produced = 0;
+    if (room) {
+      char * data = boost::asio::buffer_cast<char *>(
+          command_streambuf.prepare(prefix + room + 2)) + prefix;
+      upload.upload_started = true;
+      try {
+        produced = upload.producer(data, room);
+      } catch (...) {
+        return upload_failed(std::current_exception());
+      }
+      if (produced > room)
+        return upload_failed(std::make_exception_ptr(
+            std::length_error("The request body producer overran its buffer.")));
+      if (chunked && produced) {
+        // The chunk size goes right before the data; the room left for it
+        // that it does not use is dropped from the front.
+        char size[chunk_prefix_size + 1];
+        int const size_length = std::sprintf(size, "%lx\r\n", static_cast<unsigned long>(produced));
+        std::memcpy(data - size_length, size, size_length);
+        std::memcpy(data + produced, "\r\n", 2);
+        command_streambuf.commit(prefix + produced + 2);
+        command_streambuf.consume(prefix - size_length);
+      } else {
+        command_streambuf.commit(produced);
+      }
+    }
+    if (chunked) {
+      if (!produced) {
+        std::size_t const size = boost::asio::buffer_copy(
+            command_streambuf.prepare(5), boost::asio::buffer("0\r\n\r\n", 5));
+        command_streambuf.commit(size);
+        uploading_.reset();
+      }
     } else {
-      NETWORK_MESSAGE("request sent unsuccessfully; setting errors");
-      set_errors(ec);
+      if (room && !produced)
+        return upload_failed(std::make_exception_ptr(
+            std::length_error("The request body ended before its Content-Length.")));
+      *upload.upload_left -= produced;
+      if (!*upload.upload_left) uploading_.reset();
     }
+    if (command_streambuf.size() == 0) return;
+    writing_ = true;
+    connection_delegate_->write(command_streambuf,
+                     request_strand_.wrap(
+                         boost::bind(
+                             &this_type::handle_sent_request,
+                             this_type::shared_from_this(),
+                             generation_,
+                             boost::asio::placeholders::error,
+                             boost::asio::placeholders::bytes_transferred)));
+  }
+
+  // A body that cannot be sent in full leaves the connection in the middle
+  // of a request.
+  void upload_failed(std::exception_ptr error) {
+    NETWORK_MESSAGE("request body failed");
+    command_streambuf.consume(command_streambuf.size());
+    fail(*uploading_, error);
+    connection_lost(boost::asio::error::operation_aborted);
+  }
+
+  read_callback_type reader(state_t state) {
+    return request_strand_.wrap(
+        boost::bind(&this_type::handle_received_data,
+                    this_type::shared_from_this(),
+                    generation_,
+                    state,
+                    boost::asio::placeholders::error,
+                    boost::asio::placeholders::bytes_transferred));
+  }
+
+  void read_more(state_t state) {
+    connection_delegate_->read_some(
+        boost::asio::mutable_buffers_1(this->part.c_array(),
+                                       this->part.size()),
+        reader(state));
   }
 
-  void handle_received_data(state_t state, bool get_body, body_callback_function_type callback, boost::system::error_code const & ec, std::size_t bytes_transferred) {
+  void handle_received_data(std::size_t generation, state_t state, boost::system::error_code const & ec, std::size_t bytes_transferred) {
     NETWORK_MESSAGE("http_async_connection_pimpl::handle_received_data(...)");
+    if (generation != generation_) return;
     // Okay, there's some weirdness with Boost.Asio's handling of SSL errors
     // so we need to do some acrobatics to make sure that we're handling the
     // short-read errors correctly. This is such a PITA that we have to deal
@@ -248,51 +710,36 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
         false
 #endif
         ;
-    if (!ec || ec == boost::asio::error::eof || is_short_read_error) {
+    // An end of file before the headers are complete is an error: it is how a
+    // reused connection that the server had already closed shows up.
+    bool const end_of_stream =
+        state == body && (ec == boost::asio::error::eof || is_short_read_error);
+    if (!ec || end_of_stream) {
       NETWORK_MESSAGE("processing data chunk, no error encountered so far...");
+      if (bytes_transferred) {
+        response_started_ = true;
+        if (phase_ == first_byte_phase) phase_ = no_phase;
+      }
+      exchange & current = front();
       boost::logic::tribool parsed_ok;
-      
+
       size_t remainder;
       switch(state) {
         case version:
           NETWORK_MESSAGE("parsing version...");
-          parsed_ok =
-              this->parse_version(request_strand_.wrap(
-                                      boost::bind(
-                                          &this_type::handle_received_data,
-                                          this_type::shared_from_this(),
-                                          version, get_body, callback,
-                                          boost::asio::placeholders::error,
-                                          boost::asio::placeholders::bytes_transferred)),
-                                  bytes_transferred);
-          if (!parsed_ok || indeterminate(parsed_ok)) return;
+          parsed_ok = this->parse_version(reader(version), bytes_transferred);
+          if (!parsed_ok) return response_failed();
+          if (indeterminate(parsed_ok)) return;
         case status:
           NETWORK_MESSAGE("parsing status...");
-          parsed_ok =
-              this->parse_status(request_strand_.wrap(
-                                     boost::bind(
-                                         &this_type::handle_received_data,
-                                         this_type::shared_from_this(),
-                                         status, get_body, callback,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred)),
-                                 bytes_transferred);
-          if (!parsed_ok || indeterminate(parsed_ok)) return;
+          parsed_ok = this->parse_status(reader(status), bytes_transferred);
+          if (!parsed_ok) return response_failed();
+          if (indeterminate(parsed_ok)) return;
         case status_message:
           NETWORK_MESSAGE("parsing status message...");
-          parsed_ok =
-            this->parse_status_message(
-              request_strand_.wrap(
-                boost::bind(
-                  &this_type::handle_received_data,
-                  this_type::shared_from_this(),
-                  status_message, get_body, callback,
-                  boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred
-                  )
-                ),
-              bytes_transferred
-              );
-          if (!parsed_ok || indeterminate(parsed_ok)) return;
+          parsed_ok = this->parse_status_message(reader(status_message), bytes_transferred);
+          if (!parsed_ok) return response_failed();
+          if (indeterminate(parsed_ok)) return;
         case headers:
           NETWORK_MESSAGE("parsing headers...");
           // In the following, remainder is the number of bytes that remain
@@ -300,208 +747,95 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
           // that the data remaining in the buffer is dealt with before
           // another call to get more data for the body is scheduled.
           boost::fusion::tie(parsed_ok, remainder) =
-            this->parse_headers(
-              request_strand_.wrap(
-                boost::bind(
-                  &this_type::handle_received_data,
-                  this_type::shared_from_this(),
-                  headers, get_body, callback,
-                  boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred
-                  )
-                ),
-              bytes_transferred
-              );
+            this->parse_headers(reader(headers), bytes_transferred);
 
-          if (!parsed_ok || indeterminate(parsed_ok)) return;
+          if (!parsed_ok) return response_failed();
+          if (indeterminate(parsed_ok)) return;
 
-          if (!get_body) {
+          if (!current.get_body || framing_ == no_body) {
             NETWORK_MESSAGE("not getting body...");
             // We short-circuit here because the user does not
             // want to get the body (in the case of a HEAD
-            // request).
-            this->body_promise.set_value("");
-            this->destination_promise.set_value("");
-            this->source_promise.set_value("");
-            this->part.assign('\0');
-            this->response_parser_.reset();
+            // request), or the response does not have one.
+            current.state->set_body(std::string());
+            current.state->set_destination(std::string());
+            current.state->set_source(std::string());
             NETWORK_MESSAGE("processing done.");
+            buffer_type::const_iterator begin = this->part_begin;
+            complete_response(keep_alive_, begin, begin + remainder);
             return;
           }
 
-          if (callback) {
-            NETWORK_MESSAGE("callback provided, processing body...");
-            // Here we deal with the spill-over data from the
-            // headers processing. This means the headers data
-            // has already been parsed appropriately and we're
-            // looking to treat everything that remains in the
-            // buffer.
-            buffer_type::const_iterator begin = this->part_begin;
-            buffer_type::const_iterator end = begin;
-            std::advance(end, std::min(bytes_transferred, remainder));
-
-            // We're setting the body promise here to an empty string because
+          if (current.callback) {
+            // We're setting the body here to an empty string because
             // this can be used as a signaling mechanism for the user to
             // determine that the body is now ready for processing, even
             // though the callback is already provided.
-            this->body_promise.set_value("");
-
-            // The invocation of the callback is synchronous to allow us to
-            // wait before scheduling another read.
-            callback(boost::make_iterator_range(begin, end), ec);
-
-            connection_delegate_->read_some(
-                boost::asio::mutable_buffers_1(this->part.c_array(),
-                                               this->part.size()),
-                request_strand_.wrap(
-                    boost::bind(&this_type::handle_received_data,
-                                this_type::shared_from_this(),
-                                body,
-                                get_body,
-                                callback,
-                                boost::asio::placeholders::error,
-                                boost::asio::placeholders::bytes_transferred)));
-          } else {
-            NETWORK_MESSAGE("no callback provided, appending to body...");
-            // Here we handle the body data ourself and append to an
-            // ever-growing string buffer.
-            this->parse_body(
-              request_strand_.wrap(
-                boost::bind(
-                  &this_type::handle_received_data,
-                  this_type::shared_from_this(),
-                  body, get_body, callback,
-                  boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred
-                  )
-                ),
-              remainder);
+            current.state->set_body(std::string());
+            current.body_started = true;
+          }
+
+          // Here we deal with the spill-over data from the headers
+          // processing before another read is scheduled.
+          {
+            buffer_type::const_iterator begin = this->part_begin;
+            buffer_type::const_iterator end = begin;
+            std::advance(end, remainder);
+            this->handle_body(current.callback, begin, end, false);
           }
           return;
         case body:
           NETWORK_MESSAGE("parsing body...");
-          if (ec == boost::asio::error::eof || is_short_read_error) {
-            NETWORK_MESSAGE("end of the line.");
-            // Here we're handling the case when the connection has been
-            // closed from the server side, or at least that the end of file
-            // has been reached while reading the socket. This signals the end
-            // of the body processing chain.
-            if (callback) {
-              NETWORK_MESSAGE("callback provided, invoking callback...");
-              buffer_type::const_iterator begin =
-                  this->part.begin(),
-                  end = begin;
-              std::advance(end, bytes_transferred);
-
-              // We call the callback function synchronously passing the error
-              // condition (in this case, end of file) so that it can handle
-              // it appropriately.
-              callback(boost::make_iterator_range(begin, end), ec);
-            } else {
-              NETWORK_MESSAGE("no callback provided, appending to body...");
-              std::string body_string;
-              std::swap(body_string, this->partial_parsed);
-              body_string.append(
-                this->part.begin()
-                , bytes_transferred
-                );
-              this->body_promise.set_value(body_string);
-            }
-            // TODO set the destination value somewhere!
-            this->destination_promise.set_value("");
-            this->source_promise.set_value("");
-            this->part.assign('\0');
-            this->response_parser_.reset();
-          } else {
-            NETWORK_MESSAGE("connection still active...");
-            // This means the connection has not been closed yet and we want to get more
-            // data.
-            if (callback) {
-              NETWORK_MESSAGE("callback provided, invoking callback...");
-              // Here we have a body_handler callback. Let's invoke the
-              // callback from here and make sure we're getting more data
-              // right after.
-              buffer_type::const_iterator begin = this->part.begin();
-              buffer_type::const_iterator end = begin;
-              std::advance(end, bytes_transferred);
-              callback(boost::make_iterator_range(begin, end), ec);
-              connection_delegate_->read_some(
-                  boost::asio::mutable_buffers_1(
-                      this->part.c_array(),
-                      this->part.size()),
-                  request_strand_.wrap(
-                      boost::bind(
-                          &this_type::handle_received_data,
-                          this_type::shared_from_this(),
-                          body,
-                          get_body,
-                          callback,
-                          boost::asio::placeholders::error,
-                          boost::asio::placeholders::bytes_transferred)));
-            } else {
-              NETWORK_MESSAGE("no callback provided, appending to body...");
-              bool get_more = true;
-              if (content_length_) {
-                buffer_type::const_iterator begin = this->part.begin();
-                buffer_type::const_iterator end = begin;
-                std::advance(end, bytes_transferred);
-                get_more = (end - begin) < *content_length_;
-                NETWORK_MESSAGE("content_length = " << * content_length_ 
-                  << ", bytes read = " << (end - begin) << ", read more = " << get_more);
-              }
-              // Here we don't have a body callback. Let's
-              // make sure that we deal with the remainder
-              // from the headers part in case we do have data
-              // that's still in the buffer.
-              if (get_more) {
-                this->parse_body(request_strand_.wrap(
-                                     boost::bind(
-                                         &this_type::handle_received_data,
-                                         this_type::shared_from_this(),
-                                         body,
-                                         get_body,
-                                         callback,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred)),
-                                 bytes_transferred);
-              } else {
-                std::string body_string;
-                std::swap(body_string, this->partial_parsed);
-                body_string.append(
-                  this->part.begin()
-                  , bytes_transferred
-                  );
-                this->body_promise.set_value(body_string);                
-                // TODO set the destination value somewhere!
-                this->destination_promise.set_value("");
-                this->source_promise.set_value("");
-                this->part.assign('\0');
-                this->response_parser_.reset();
-              }
-            }
-          }
+          this->handle_body(current.callback,
+                            this->part.begin(),
+                            this->part.begin() + bytes_transferred,
+                            end_of_stream);
           return;
         default:
           BOOST_ASSERT(false && "Bug, report this to the developers!");
       }
     } else {
-      boost::system::system_error error(ec);
-      NETWORK_MESSAGE("error encountered: " << error.what() << " (" << ec << ")");
-      this->source_promise.set_exception(std::make_exception_ptr(error));
-      this->destination_promise.set_exception(std::make_exception_ptr(error));
-      switch (state) {
-        case version:
-          this->version_promise.set_exception(std::make_exception_ptr(error));
-        case status:
-          this->status_promise.set_exception(std::make_exception_ptr(error));
-        case status_message:
-          this->status_message_promise.set_exception(std::make_exception_ptr(error));
-        case headers:
-          this->headers_promise.set_exception(std::make_exception_ptr(error));
-        case body:
-          this->body_promise.set_exception(std::make_exception_ptr(error));
-          break;
-        default:
-          BOOST_ASSERT(false && "Bug, report this to the developers!");
-      }
+      NETWORK_MESSAGE("error encountered: " << boost::system::system_error(ec).what()
+                      << " (" << ec << ")");
+      connection_lost(ec);
+    }
+  }
+
+  // The parse functions have already failed the front response.
+  void response_failed() {
+    drop_connection(true, boost::system::errc::make_error_code(
+        boost::system::errc::protocol_error));
+  }
+
+  // The front response is complete; [begin, end) is whatever the server
+  // sent after it, which is the start of the next response when requests
+  // are pipelined.
+  void complete_response(bool keep_alive,
+                         buffer_type::const_iterator begin,
+                         buffer_type::const_iterator end) {
+    NETWORK_MESSAGE("http_async_connection_pimpl::complete_response(...)");
+    std::size_t const leftover = end - begin;
+    reset_response_state();
+    // A server that answers before it has the whole body leaves the rest of
+    // it unsent, and the connection unusable.
+    if (uploading_ && uploading_ == in_flight_.front()) keep_alive = false;
+    if (!keep_alive || (leftover && in_flight_.size() == 1)) {
+      drop_connection(true, boost::asio::error::connection_reset);
+      return;
+    }
+    retire_front(true);
+    if (in_flight_.empty()) {
+      reading_ = false;
+      resume();
+      return;
+    }
+    resume();
+    if (leftover) {
+      std::memmove(this->part.c_array(), &*begin, leftover);
+      handle_received_data(generation_, version, boost::system::error_code(), leftover);
+    } else {
+      start_phase(first_byte_phase, &request_options::first_byte_timeout);
+      read_more(version);
     }
   }
 
@@ -543,6 +877,17 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
     }
   };
 
+  // The parser takes empty input as an error, but here it only means that
+  // the last read ended right where the next part begins.
+  boost::fusion::tuple<boost::logic::tribool, boost::iterator_range<buffer_type::const_iterator> >
+  parse_part(response_parser::state_t stop_state,
+             boost::iterator_range<buffer_type::const_iterator> input_range) {
+    if (boost::empty(input_range))
+      return boost::fusion::make_tuple(boost::logic::tribool(boost::logic::indeterminate),
+                                       input_range);
+    return response_parser_.parse_until(stop_state, input_range);
+  }
+
   boost::logic::tribool parse_version(
       std::function<void(boost::system::error_code, size_t)> callback,
       size_t bytes) {
@@ -553,7 +898,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
     boost::iterator_range<buffer_type::const_iterator>
       result_range,
       input_range = boost::make_iterator_range(part_begin, part_end);
-    boost::fusion::tie(parsed_ok, result_range) = response_parser_.parse_until(
+    boost::fusion::tie(parsed_ok, result_range) = parse_part(
       response_parser::http_version_done,
       input_range);
     if (parsed_ok == true) {
@@ -562,7 +907,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
       version.append(boost::begin(result_range),
                boost::end(result_range));
       boost::algorithm::trim(version);
-      version_promise.set_value(version);
+      front().state->set_version(std::move(version));
       part_begin = boost::end(result_range);
     } else if (parsed_ok == false) {
 #ifdef NETWORK_DEBUG
@@ -576,14 +921,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
                   << "\"");
 #endif
       std::runtime_error error("Invalid Version Part.");
-      version_promise.set_exception(std::make_exception_ptr(error));
-      status_promise.set_exception(std::make_exception_ptr(error));
-      status_message_promise.set_exception(
-        std::make_exception_ptr(error));
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
+      fail(front(), std::make_exception_ptr(error));
     } else {
       partial_parsed.append(
         boost::begin(result_range),
@@ -607,18 +945,13 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
      boost::iterator_range< buffer_type::const_iterator>
       result_range,
       input_range = boost::make_iterator_range(part_begin, part_end);
-    boost::fusion::tie(parsed_ok, result_range) = response_parser_.parse_until(
+    boost::fusion::tie(parsed_ok, result_range) = parse_part(
       response_parser::http_status_done,
       input_range);
     if (parsed_ok == true) {
-      std::string status;
-      std::swap(status, partial_parsed);
-      status.append(boost::begin(result_range),
-              boost::end(result_range));
-      boost::trim(status);
-      boost::uint16_t status_int =
-        boost::lexical_cast<boost::uint16_t>(status);
-      status_promise.set_value(status_int);
+      // The parser has already read the digits.
+      partial_parsed.clear();
+      front().state->set_status(response_parser_.status());
       part_begin = boost::end(result_range);
     } else if (parsed_ok == false) {
 #ifdef NETWORK_DEBUG
@@ -632,13 +965,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
                   << "\"");
 #endif
       std::runtime_error error("Invalid status part.");
-      status_promise.set_exception(std::make_exception_ptr(error));
-      status_message_promise.set_exception(
-        std::make_exception_ptr(error));
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
+      fail(front(), std::make_exception_ptr(error));
     } else {
       partial_parsed.append(
         boost::begin(result_range),
@@ -662,7 +989,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
      boost::iterator_range< buffer_type::const_iterator>
       result_range,
       input_range = boost::make_iterator_range(part_begin, part_end);
-    boost::fusion::tie(parsed_ok, result_range) = response_parser_.parse_until(
+    boost::fusion::tie(parsed_ok, result_range) = parse_part(
       response_parser::http_status_message_done,
       input_range);
     if (parsed_ok == true) {
@@ -671,7 +998,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
       status_message.append(boost::begin(result_range),
                   boost::end(result_range));
       boost::algorithm::trim(status_message);
-      status_message_promise.set_value(status_message);
+      front().state->set_status_message(std::move(status_message));
       part_begin = boost::end(result_range);
     } else if (parsed_ok == false) {
 #ifdef NETWORK_DEBUG
@@ -685,12 +1012,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
                   << "\"");
 #endif
       std::runtime_error error("Invalid status message part.");
-      status_message_promise.set_exception(
-        std::make_exception_ptr(error));
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
+      fail(front(), std::make_exception_ptr(error));
     } else {
       partial_parsed.append(
         boost::begin(result_range),
@@ -704,59 +1026,61 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
     return parsed_ok;
   }
 
-  void parse_headers_real(std::string & headers_part) {
-     boost::iterator_range< std::string::const_iterator>
-      input_range = boost::make_iterator_range(headers_part)
-      , result_range;
-    boost::logic::tribool parsed_ok;
-    response_parser headers_parser(
-      response_parser::http_header_line_done);
-    std::multimap<std::string, std::string> headers;
-    std::pair<std::string,std::string> header_pair;
-    while (!boost::empty(input_range)) {
-      boost::fusion::tie(parsed_ok, result_range) =
-        headers_parser.parse_until(
-          response_parser::http_header_colon,
-          input_range);
-      if (headers_parser.state()
-        != response_parser::http_header_colon)
-        break;
-      header_pair.first = std::string(boost::begin(result_range),
-                      boost::end(result_range));
-      input_range.advance_begin(boost::distance(result_range));
-      boost::fusion::tie(parsed_ok, result_range) =
-        headers_parser.parse_until(
-          response_parser::http_header_line_done,
-          input_range);
-      header_pair.second = std::string(boost::begin(result_range),
-                       boost::end(result_range));
-      input_range.advance_begin(boost::distance(result_range));
-
-      boost::trim(header_pair.first);
-      if (header_pair.first.size() > 1) {
-        header_pair.first.erase(
-          header_pair.first.size() - 1
-        );
-      }
-      boost::trim(header_pair.second);
-      headers.insert(header_pair);
-    }
-    // Set content length
+  // Returns false, having failed the front response, when the headers
+  // cannot frame a body.
+  bool parse_headers_real(std::string & headers_part) {
+    // The parser recorded where every name and value is on its way through,
+    // so all that is left is to hand the block over and pick out the length.
+    header_block headers(headers_part, response_parser_.header_spans());
     content_length_ = boost::none;
-    auto it = headers.find("Content-Length");
-    if (it != headers.end()) {
-      try {
-        content_length_ = std::stoul(it->second);
+    // HTTP/1.1 connections persist unless the server says otherwise, and
+    // HTTP/1.0 ones only when it asks for it.
+    header_block::string_range connection = headers.find("Connection");
+    if (response_parser_.version_major() == 1 && response_parser_.version_minor() >= 1)
+      keep_alive_ = !impl::equals_token(boost::begin(connection), boost::end(connection), "close");
+    else
+      keep_alive_ = impl::equals_token(boost::begin(connection), boost::end(connection), "keep-alive");
+    header_block::string_range length = headers.find("Content-Length");
+    if (!boost::empty(length)) {
+      std::size_t value = 0;
+      header_block::string_range::const_iterator it = boost::begin(length);
+      for (; it != boost::end(length) && *it >= '0' && *it <= '9'; ++it) {
+        if (value > (std::numeric_limits<std::size_t>::max() - 9) / 10) break;
+        value = value * 10 + (*it - '0');
+      }
+      if (it == boost::end(length)) {
+        content_length_ = value;
         NETWORK_MESSAGE("Content-Length: " << *content_length_);
-      } catch(const std::invalid_argument&) {
-        NETWORK_MESSAGE("invalid argument exception while interpreting " 
-          << it->second << " as content length");
-      } catch(const std::out_of_range&) {
-        NETWORK_MESSAGE("out of range exception while interpreting " 
-          << it->second << " as content length");
+      } else {
+        // Reading up to the end of the stream instead would let a
+        // malformed length smuggle a second response in (RFC 9112, 6.3).
+        NETWORK_MESSAGE("invalid content length: "
+          << std::string(boost::begin(length), boost::end(length)));
+        fail(front(), std::make_exception_ptr(std::runtime_error("Invalid Content-Length.")));
+        return false;
       }
     }
-    headers_promise.set_value(headers);
+    // Transfer-Encoding wins over Content-Length; a body framed by neither
+    // ends when the server closes the connection.
+    boost::uint16_t status = response_parser_.status();
+    header_block::string_range encoding = headers.find("Transfer-Encoding");
+    if (status == 204 || status == 304) {
+      framing_ = no_body;
+    } else if (!boost::empty(encoding)) {
+      std::size_t const chunked = sizeof("chunked") - 1;
+      framing_ = boost::size(encoding) >= chunked &&
+                 impl::equals_token(boost::end(encoding) - chunked, boost::end(encoding), "chunked")
+          ? framed_by_chunks : framed_by_close;
+    } else if (content_length_) {
+      framing_ = *content_length_ ? framed_by_length : no_body;
+      body_remaining_ = *content_length_;
+      partial_parsed.reserve(std::min<std::size_t>(*content_length_, 1024 * 1024));
+    } else {
+      framing_ = framed_by_close;
+    }
+    if (framing_ == framed_by_close) keep_alive_ = false;
+    front().state->set_headers(std::move(headers));
+    return true;
   }
 
   boost::fusion::tuple<boost::logic::tribool, size_t> parse_headers(
@@ -768,7 +1092,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
     boost::iterator_range<buffer_type::const_iterator>
       result_range,
       input_range = boost::make_iterator_range(part_begin, part_end);
-    boost::fusion::tie(parsed_ok, result_range) = response_parser_.parse_until(
+    boost::fusion::tie(parsed_ok, result_range) = parse_part(
       response_parser::http_headers_done,
       input_range);
     if (parsed_ok == true) {
@@ -777,7 +1101,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
       headers_string.append(boost::begin(result_range),
                   boost::end(result_range));
       part_begin = boost::end(result_range);
-      this->parse_headers_real(headers_string);
+      if (!this->parse_headers_real(headers_string)) parsed_ok = false;
     } else if (parsed_ok == false) {
       // We want to output the contents of the buffer that caused
       // the error in debug builds.
@@ -793,10 +1117,7 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
                   << boost::distance(result_range));
 #endif
       std::runtime_error error("Invalid header part.");
-      headers_promise.set_exception(std::make_exception_ptr(error));
-      body_promise.set_exception(std::make_exception_ptr(error));
-      source_promise.set_exception(std::make_exception_ptr(error));
-      destination_promise.set_exception(std::make_exception_ptr(error));
+      fail(front(), std::make_exception_ptr(error));
     } else {
       partial_parsed.append(boost::begin(result_range),
                   boost::end(result_range));
@@ -815,37 +1136,158 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
       );
   }
 
-  void parse_body(std::function<void(boost::system::error_code, size_t)> callback, size_t bytes) {
-    // TODO: we should really not use a string for the partial body
-    // buffer.
-    partial_parsed.append(part_begin, bytes);
-    part_begin = part.begin();
-    connection_delegate_->read_some(
-      boost::asio::mutable_buffers_1(part.c_array(), part.size()),
-      callback
-      );
+  // How the end of the response body is found.
+  enum framing_t {
+    no_body,            // HEAD responses, 204 and 304
+    framed_by_length,   // Content-Length
+    framed_by_chunks,   // Transfer-Encoding: chunked
+    framed_by_close     // everything up to the end of the stream
+  };
+
+  // Takes the body data in [begin, end) -- the spill-over from the headers
+  // or a fresh read -- and either finishes the body or reads more of it.
+  // `end_of_stream` is set when the server closed the connection after
+  // sending the data.
+  void handle_body(body_callback_function_type const & callback,
+                   buffer_type::const_iterator begin,
+                   buffer_type::const_iterator end,
+                   bool end_of_stream) {
+    switch (framing_) {
+      case framed_by_length: {
+        std::size_t length = std::min<std::size_t>(end - begin, body_remaining_);
+        deliver_body(callback, begin, begin + length);
+        body_remaining_ -= length;
+        NETWORK_MESSAGE("content_length = " << *content_length_
+          << ", bytes left = " << body_remaining_);
+        if (body_remaining_ == 0) {
+          finish_body(callback, keep_alive_, begin + length, end);
+          return;
+        }
+        if (end_of_stream) {
+          fail_body(callback, "Incomplete body.");
+          return;
+        }
+        break;
+      }
+      case framed_by_chunks:
+        while (begin != end) {
+          boost::logic::tribool done;
+          boost::iterator_range<buffer_type::const_iterator> data;
+          boost::fusion::tie(done, begin, data) = chunked_parser_.parse(begin, end);
+          deliver_body(callback, boost::begin(data), boost::end(data));
+          if (done) {
+            finish_body(callback, keep_alive_, begin, end);
+            return;
+          }
+          if (!done) {
+            fail_body(callback, "Invalid chunked body.");
+            return;
+          }
+        }
+        if (end_of_stream) {
+          fail_body(callback, "Incomplete body.");
+          return;
+        }
+        break;
+      case framed_by_close:
+        deliver_body(callback, begin, end);
+        if (end_of_stream) {
+          finish_body(callback, false, end, end);
+          return;
+        }
+        break;
+      default:
+        BOOST_ASSERT(false && "Bug, report this to the developers!");
+    }
+    read_more(body);
+  }
+
+  void deliver_body(body_callback_function_type const & callback,
+                    buffer_type::const_iterator begin,
+                    buffer_type::const_iterator end) {
+    if (begin == end) return;
+    if (callback) {
+      // The invocation of the callback is synchronous to allow us to
+      // wait before scheduling another read.
+      callback(boost::make_iterator_range(begin, end), boost::system::error_code());
+    } else {
+      // TODO: we should really not use a string for the partial body
+      // buffer.
+      this->partial_parsed.append(begin, end);
+    }
+  }
+
+  // [begin, end) is what came after the body, as for complete_response.
+  void finish_body(body_callback_function_type const & callback,
+                   bool keep_alive,
+                   buffer_type::const_iterator begin,
+                   buffer_type::const_iterator end) {
+    NETWORK_MESSAGE("body complete.");
+    exchange & current = front();
+    if (callback) {
+      // Callbacks are told about the end of the body the way they always
+      // were: with an empty range and an end of file.
+      buffer_type::const_iterator part_end = this->part.end();
+      callback(boost::make_iterator_range(part_end, part_end), boost::asio::error::eof);
+    } else {
+      std::string body_string;
+      std::swap(body_string, this->partial_parsed);
+      current.state->set_body(std::move(body_string));
+    }
+    // TODO set the destination value somewhere!
+    current.state->set_destination(std::string());
+    current.state->set_source(std::string());
+    complete_response(keep_alive, begin, end);
+  }
+
+  void fail_body(body_callback_function_type const & callback, char const * message) {
+    NETWORK_MESSAGE("body failed: " << message);
+    std::runtime_error error(message);
+    if (callback) {
+      buffer_type::const_iterator end = this->part.end();
+      callback(boost::make_iterator_range(end, end),
+               boost::system::errc::make_error_code(boost::system::errc::protocol_error));
+    }
+    fail(front(), std::make_exception_ptr(error));
+    response_failed();
   }
 
   bool follow_redirect_;
+  std::size_t pipeline_depth_;
   boost::asio::io_service::strand request_strand_;
+  boost::asio::steady_timer timer_;
+  clock::time_point timer_expiry_;
+  phase_t phase_;
+  clock::time_point phase_deadline_;
   std::shared_ptr<resolver_delegate> resolver_delegate_;
   std::shared_ptr<connection_delegate> connection_delegate_;
   boost::asio::streambuf command_streambuf;
-  std::string method;
+  // The request whose body is being streamed, if any.
+  exchange_ptr uploading_;
+  // How much of a streamed body is written at a time, and the room left in
+  // front of each piece for its chunk size.
+  static std::size_t const upload_piece_size = 64 * 1024;
+  static std::size_t const chunk_prefix_size = 2 * sizeof(unsigned long) + 2;
+  std::deque<exchange_ptr> unsent_, in_flight_;
   response_parser response_parser_;
-  std::promise<std::string> version_promise;
-  std::promise<boost::uint16_t> status_promise;
-  std::promise<std::string> status_message_promise;
-  std::promise<std::multimap<std::string, std::string> > headers_promise;
   boost::optional<size_t> content_length_;
-  std::promise<std::string> source_promise;
-  std::promise<std::string> destination_promise;
-  std::promise<std::string> body_promise;
-  typedef boost::array<char, NETWORK_BUFFER_CHUNK> buffer_type;
+  framing_t framing_;
+  std::size_t body_remaining_;
+  chunked_parser chunked_parser_;
   buffer_type part;
   buffer_type::const_iterator part_begin;
   std::string partial_parsed;
+  bool keep_alive_;
+  bool response_started_;
   std::string host_;
+  boost::uint16_t port_;
+  // Bumped whenever the socket is closed, so that handlers of reads and
+  // writes on the old socket know to do nothing.
+  std::size_t generation_;
+  bool connecting_, connected_, writing_, reading_;
+  // Off once a server has closed a connection in the middle of a pipeline.
+  bool pipelining_;
+  http_async_connection::release_callback_type release_callback_;
 };
 
 // END OF PIMPL DEFINITION
@@ -853,11 +1295,13 @@ struct http_async_connection_pimpl : std::enable_shared_from_this<http_async_con
 http_async_connection::http_async_connection(std::shared_ptr<resolver_delegate> resolver_delegate,
                                              std::shared_ptr<connection_delegate> connection_delegate,
                                              boost::asio::io_service & io_service,
-                                             bool follow_redirects)
+                                             bool follow_redirects,
+                                             std::size_t pipeline_depth)
 : pimpl(new http_async_connection_pimpl(resolver_delegate,
                                                        connection_delegate,
                                                        io_service,
-                                                       follow_redirects)) {}
+                                                       follow_redirects,
+                                                       pipeline_depth)) {}
 
 http_async_connection::http_async_connection(std::shared_ptr<http_async_connection_pimpl> new_pimpl)
 : pimpl(new_pimpl) {}
@@ -881,6 +1325,14 @@ void http_async_connection::reset() {
   pimpl->reset();  // NOTE: We're not resetting the pimpl, just the internal state.
 }
 
+void http_async_connection::set_release_callback(release_callback_type callback) {
+  pimpl->set_release_callback(callback);
+}
+
+bool http_async_connection::is_open() {
+  return pimpl->is_open();
+}
+
 }  // namespace http
 }  // namespace network
   
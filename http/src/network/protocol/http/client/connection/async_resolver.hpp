@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <network/protocol/http/client/connection/resolver_delegate.hpp>
+#include <network/protocol/http/client/connection/resolver_cache.hpp>
 
 namespace network {
 namespace http {
@@ -19,6 +20,10 @@ struct async_resolver : resolver_delegate {
   using resolver_delegate::resolve_completion_function;
 
   async_resolver(boost::asio::io_service & service, bool cache_resolved);
+  // Resolves through `cache` when one is given, and asks the system
+  // resolver every time otherwise.
+  async_resolver(boost::asio::io_service & service,
+                 std::shared_ptr<resolver_cache> cache);
   virtual void resolve(std::string const & host,
                        uint16_t port,
                        resolve_completion_function once_resolved);  // override
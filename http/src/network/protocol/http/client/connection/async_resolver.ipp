@@ -10,56 +10,50 @@
 #include <string>
 #include <utility>
 #include <memory>
-#include <unordered_map>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/asio/strand.hpp>
 #include <functional>
 #include <boost/lexical_cast.hpp>
-#include <boost/unordered_map.hpp>
-#include <boost/algorithm/string/case_conv.hpp>
-#include <boost/fusion/tuple.hpp>
-#include <boost/fusion/adapted/std_pair.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <network/protocol/http/client/connection/async_resolver.hpp>
 
 namespace network { namespace http {
   struct async_resolver_pimpl : std::enable_shared_from_this<async_resolver_pimpl> {
     typedef resolver_delegate::resolve_completion_function resolve_completion_function;
-    async_resolver_pimpl(boost::asio::io_service & service, bool cache_resolved);
+    async_resolver_pimpl(boost::asio::io_service & service,
+                         std::shared_ptr<resolver_cache> cache);
     void resolve(std::string const & host,
                  uint16_t port,
                  resolve_completion_function once_resolved);
     void clear_resolved_cache();
   private:
+    boost::asio::io_service & service_;
     boost::asio::ip::udp::resolver resolver_;
-    bool cache_resolved_;
+    std::shared_ptr<resolver_cache> cache_;
     typedef boost::asio::ip::udp::resolver::iterator
     resolver_iterator;
-    typedef std::unordered_map<std::string, std::pair<resolver_iterator,resolver_iterator> >
-    endpoint_cache;
-    endpoint_cache endpoint_cache_;
     std::unique_ptr<boost::asio::io_service::strand> resolver_strand_;
 
-    void handle_resolve(std::string const & host,
-                        resolve_completion_function once_resolved,
+    void handle_resolve(resolve_completion_function once_resolved,
                         boost::system::error_code const & ec,
                         resolver_iterator endpoint_iterator);
   };
 
-  async_resolver_pimpl::async_resolver_pimpl(boost::asio::io_service & service, bool cache_resolved)
-  : resolver_(service),
-  cache_resolved_(cache_resolved),
-  endpoint_cache_(),
+  async_resolver_pimpl::async_resolver_pimpl(boost::asio::io_service & service,
+                                             std::shared_ptr<resolver_cache> cache)
+  : service_(service),
+  resolver_(service),
+  cache_(cache),
   resolver_strand_(new(std::nothrow) boost::asio::io_service::strand(service))
   {
     // Do nothing
   }
 
   void async_resolver_pimpl::clear_resolved_cache() {
-    if (cache_resolved_)
-      endpoint_cache().swap(endpoint_cache_);
+    if (cache_)
+      cache_->clear();
   }
 
   void async_resolver_pimpl::resolve(std::string const & host,
@@ -69,14 +63,9 @@ namespace network { namespace http {
       BOOST_THROW_EXCEPTION(std::runtime_error(
                                                "Uninitialized resolver strand, ran out of memory."));
 
-    if (cache_resolved_) {
-      endpoint_cache::iterator iter =
-      endpoint_cache_.find(boost::to_lower_copy(host));
-      if (iter != endpoint_cache_.end()) {
-        boost::system::error_code ignored;
-        once_resolved(ignored, iter->second);
-        return;
-      }
+    if (cache_) {
+      cache_->resolve(service_, host, port, once_resolved);
+      return;
     }
 
     std::string port_str = boost::lexical_cast<std::string>(port);
@@ -85,32 +74,26 @@ namespace network { namespace http {
     resolver_.async_resolve(query,
                             resolver_strand_->wrap(std::bind(&async_resolver_pimpl::handle_resolve,
                                                              async_resolver_pimpl::shared_from_this(),
-                                                             boost::to_lower_copy(host),
                                                              once_resolved,
                                                              _1,
                                                              _2)));
   }
 
-  void async_resolver_pimpl::handle_resolve(std::string const & host,
-                                            resolve_completion_function once_resolved,
+  void async_resolver_pimpl::handle_resolve(resolve_completion_function once_resolved,
                                             boost::system::error_code const & ec,
                                             resolver_iterator endpoint_iterator) {
-    endpoint_cache::iterator iter;
-    bool inserted = false;
-    if (!ec && cache_resolved_) {
-      boost::fusion::tie(iter, inserted) =
-      endpoint_cache_.insert(
-                             std::make_pair(host,
-                                            std::make_pair(endpoint_iterator,
-                                                           resolver_iterator())));
-      once_resolved(ec, iter->second);
-    } else {
-      once_resolved(ec, std::make_pair(endpoint_iterator,resolver_iterator()));
-    }
+    once_resolved(ec, std::make_pair(endpoint_iterator,resolver_iterator()));
   }
 
   async_resolver::async_resolver(boost::asio::io_service & service, bool cache_resolved)
-  : pimpl(new (std::nothrow) async_resolver_pimpl(service, cache_resolved))
+  : pimpl(new (std::nothrow) async_resolver_pimpl(
+      service,
+      cache_resolved ? resolver_cache::process_cache() : std::shared_ptr<resolver_cache>()))
+  {}
+
+  async_resolver::async_resolver(boost::asio::io_service & service,
+                                 std::shared_ptr<resolver_cache> cache)
+  : pimpl(new (std::nothrow) async_resolver_pimpl(service, cache))
   {}
 
   void async_resolver::resolve(std::string const & host,
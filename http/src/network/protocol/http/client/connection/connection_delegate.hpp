@@ -10,6 +10,9 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace network {
 namespace http {
@@ -18,11 +21,47 @@ struct connection_delegate {
   virtual void connect(boost::asio::ip::tcp::endpoint & endpoint,
                        std::string const & host,
                        std::function<void(boost::system::error_code const &)> handler) = 0;
+  // Connects to the first of a host's addresses that answers. Delegates that
+  // can race the addresses do; by default they are tried one at a time.
+  virtual void connect_to_any(std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+                              std::string const & host,
+                              std::function<void(boost::system::error_code const &)> handler) {
+    connect_in_turn(std::make_shared<std::vector<boost::asio::ip::tcp::endpoint> >(endpoints),
+                    0, host, handler);
+  }
+  // Runs once the socket is connected and before the first request goes
+  // out, so that it can be timed on its own. Only TLS has anything to do.
+  virtual void handshake(std::function<void(boost::system::error_code const &)> handler) {
+    handler(boost::system::error_code());
+  }
   virtual void write(boost::asio::streambuf & command_streambuf,
                      std::function<void(boost::system::error_code const &, size_t)> handler) = 0;
   virtual void read_some(boost::asio::mutable_buffers_1 const & read_buffer,
                          std::function<void(boost::system::error_code const &, size_t)> handler) = 0;
+  // Whether the connection can still carry a request: it is connected, and
+  // the server has neither closed it nor sent anything while it sat idle.
+  virtual bool is_open() = 0;
+  virtual void disconnect() = 0;
   virtual ~connection_delegate() {}
+
+ private:
+  void connect_in_turn(std::shared_ptr<std::vector<boost::asio::ip::tcp::endpoint> > endpoints,
+                       std::size_t index,
+                       std::string const & host,
+                       std::function<void(boost::system::error_code const &)> handler) {
+    if (index == endpoints->size()) {
+      handler(boost::asio::error::host_not_found);
+      return;
+    }
+    boost::asio::ip::tcp::endpoint endpoint = (*endpoints)[index];
+    connect(endpoint, host,
+            [this, endpoints, index, host, handler](boost::system::error_code const & ec) {
+              if (!ec || index + 1 == endpoints->size())
+                handler(ec);
+              else
+                connect_in_turn(endpoints, index + 1, host, handler);
+            });
+  }
 };
 
 }  // namespace http
@@ -7,7 +7,12 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_DELEGATE_FACTORY_HPP_20110819
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_DELEGATE_FACTORY_HPP_20110819
 
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 #include <boost/throw_exception.hpp>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 
@@ -15,6 +20,7 @@ namespace network {
   namespace http {
 
     class client_options;
+    struct tls_context;
 
     struct connection_delegate_factory {
       typedef std::shared_ptr<connection_delegate> connection_delegate_ptr;
@@ -29,6 +35,13 @@ namespace network {
       virtual ~connection_delegate_factory();
 
     private:
+      // Built for the first HTTPS connection whose options don't provide
+      // one, and shared by the later ones with the same certificate and
+      // verify paths.
+      typedef std::pair<std::list<std::string>, std::list<std::string> > tls_paths;
+      std::mutex tls_mutex_;
+      std::map<tls_paths, std::shared_ptr<tls_context> > tls_contexts_;
+
       connection_delegate_factory(connection_delegate_factory const &);  // = delete
       connection_delegate_factory& operator=(connection_delegate_factory);  // = delete
     };
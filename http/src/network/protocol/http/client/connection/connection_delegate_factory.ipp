@@ -10,6 +10,7 @@
 #include <network/protocol/http/client/connection/normal_delegate.hpp>
 #ifdef NETWORK_ENABLE_HTTPS
 #include <network/protocol/http/client/connection/ssl_delegate.hpp>
+#include <network/protocol/http/client/connection/tls_context.hpp>
 #endif /* NETWORK_ENABLE_HTTPS */
 
 #include <network/protocol/http/client/connection/connection_delegate_factory.hpp>
@@ -31,14 +32,24 @@ namespace network { namespace http {
     if (https) {
 #ifdef NETWORK_ENABLE_HTTPS
       NETWORK_MESSAGE("creating an SSL delegate");
-      delegate.reset(new ssl_delegate(service, options));
+      std::shared_ptr<tls_context> tls = options.tls_context();
+      if (!tls) {
+        tls_paths paths(options.openssl_certificate_paths(),
+                        options.openssl_verify_paths());
+        std::lock_guard<std::mutex> lock(tls_mutex_);
+        std::shared_ptr<tls_context> & shared = tls_contexts_[paths];
+        if (!shared)
+          shared = std::make_shared<tls_context>(options);
+        tls = shared;
+      }
+      delegate.reset(new ssl_delegate(service, options, tls));
 #else
       NETWORK_MESSAGE("creating an SSL delegate, but not supported");
       BOOST_THROW_EXCEPTION(std::runtime_error("HTTPS not supported."));
 #endif /* NETWORK_ENABLE_HTTPS */
     } else {
       NETWORK_MESSAGE("creating a normal delegate");
-      delegate.reset(new normal_delegate(service));
+      delegate.reset(new normal_delegate(service, options));
     }
     return delegate;
   }
@@ -0,0 +1,96 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_CONNECTION_RACE_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_CONNECTION_RACE_HPP_20121018
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+namespace network {
+namespace http {
+
+/** connection_race
+ *
+ *  Connects to whichever of a host's addresses answers first, the way
+ *  RFC 8305 ("Happy Eyeballs") describes: the addresses are tried in turn,
+ *  but each attempt only gets `attempt_delay` to itself before the next one
+ *  starts alongside it, and a failed attempt starts the next one right
+ *  away. The first socket to connect wins and the other attempts are
+ *  closed.
+ *
+ *  A race is started once and keeps itself alive until it is over.
+ */
+struct connection_race : std::enable_shared_from_this<connection_race> {
+  typedef std::function<void(boost::system::error_code const &,
+                             std::unique_ptr<boost::asio::ip::tcp::socket>)>
+      completion_function;
+
+  connection_race(boost::asio::io_service & service,
+                  std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+                  std::chrono::milliseconds attempt_delay);
+
+  /** start
+   *
+   * Begins connecting. `once_connected` gets the winning socket, or the
+   * error of the last attempt to fail and no socket.
+   */
+  void start(completion_function once_connected);
+
+  /** cancel
+   *
+   * Closes every attempt. `once_connected` is not called once this returns,
+   * and a call to it that was already running has returned by then, so
+   * whatever it refers to can go away right after.
+   */
+  void cancel();
+
+  /** interleave
+   *
+   * Orders resolved endpoints so that the address families alternate,
+   * starting with the family of the first one, and otherwise keeps the
+   * order the resolver gave.
+   */
+  static std::vector<boost::asio::ip::tcp::endpoint> interleave(
+      std::vector<boost::asio::ip::tcp::endpoint> const & endpoints);
+
+ private:
+  void attempt();
+  void handle_connected(std::size_t index, boost::system::error_code const & ec);
+  void handle_delay(std::size_t next, boost::system::error_code const & ec);
+  void finish(boost::system::error_code const & ec,
+              std::unique_ptr<boost::asio::ip::tcp::socket> winner);
+  void close_all();
+
+  boost::asio::io_service & service_;
+  boost::asio::io_service::strand strand_;
+  boost::asio::steady_timer delay_timer_;
+  std::vector<boost::asio::ip::tcp::endpoint> endpoints_;
+  std::vector<std::unique_ptr<boost::asio::ip::tcp::socket> > sockets_;
+  std::chrono::milliseconds attempt_delay_;
+  std::size_t next_, pending_;
+  bool done_;
+  boost::system::error_code last_error_;
+  // Guards once_connected_ and is held while it runs. Recursive so that
+  // the callback itself may cancel.
+  std::recursive_mutex callback_mutex_;
+  completion_function once_connected_;
+
+  connection_race(connection_race const &);  // = delete
+  connection_race& operator=(connection_race);  // = delete
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_CONNECTION_RACE_HPP_20121018 */
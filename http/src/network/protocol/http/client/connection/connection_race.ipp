@@ -0,0 +1,144 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_CONNECTION_RACE_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_CONNECTION_RACE_IPP_20121018
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/bind.hpp>
+#include <network/protocol/http/client/connection/connection_race.hpp>
+#include <network/detail/debug.hpp>
+
+namespace network { namespace http {
+
+connection_race::connection_race(
+    boost::asio::io_service & service,
+    std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+    std::chrono::milliseconds attempt_delay)
+: service_(service)
+, strand_(service)
+, delay_timer_(service)
+, endpoints_(endpoints)
+, sockets_(endpoints.size())
+, attempt_delay_(attempt_delay)
+, next_(0)
+, pending_(0)
+, done_(false)
+, callback_mutex_()
+{
+  NETWORK_MESSAGE("connection_race::connection_race(...)");
+}
+
+void connection_race::start(completion_function once_connected) {
+  NETWORK_MESSAGE("connection_race::start(...)");
+  once_connected_ = once_connected;
+  strand_.dispatch(boost::bind(&connection_race::attempt, shared_from_this()));
+}
+
+void connection_race::cancel() {
+  NETWORK_MESSAGE("connection_race::cancel()");
+  {
+    std::lock_guard<std::recursive_mutex> lock(callback_mutex_);
+    once_connected_ = completion_function();
+  }
+  std::shared_ptr<connection_race> self(shared_from_this());
+  strand_.dispatch([self]() {
+    self->done_ = true;
+    self->close_all();
+  });
+}
+
+std::vector<boost::asio::ip::tcp::endpoint> connection_race::interleave(
+    std::vector<boost::asio::ip::tcp::endpoint> const & endpoints) {
+  std::vector<boost::asio::ip::tcp::endpoint> first, second, result;
+  for (std::size_t i = 0; i < endpoints.size(); ++i) {
+    bool const same_family =
+        endpoints[i].address().is_v6() == endpoints[0].address().is_v6();
+    (same_family ? first : second).push_back(endpoints[i]);
+  }
+  for (std::size_t i = 0; i < first.size() || i < second.size(); ++i) {
+    if (i < first.size()) result.push_back(first[i]);
+    if (i < second.size()) result.push_back(second[i]);
+  }
+  return result;
+}
+
+void connection_race::attempt() {
+  if (done_) return;
+  if (next_ == endpoints_.size()) {
+    if (pending_ == 0)
+      finish(last_error_ ? last_error_ : boost::asio::error::host_not_found,
+             std::unique_ptr<boost::asio::ip::tcp::socket>());
+    return;
+  }
+  std::size_t const index = next_++;
+  NETWORK_MESSAGE("trying " << endpoints_[index]);
+  sockets_[index].reset(new boost::asio::ip::tcp::socket(service_));
+  ++pending_;
+  sockets_[index]->async_connect(
+      endpoints_[index],
+      strand_.wrap(boost::bind(&connection_race::handle_connected,
+                               shared_from_this(),
+                               index,
+                               boost::asio::placeholders::error)));
+  if (next_ < endpoints_.size()) {
+    delay_timer_.expires_from_now(attempt_delay_);
+    delay_timer_.async_wait(
+        strand_.wrap(boost::bind(&connection_race::handle_delay,
+                                 shared_from_this(),
+                                 next_,
+                                 boost::asio::placeholders::error)));
+  }
+}
+
+void connection_race::handle_connected(std::size_t index,
+                                       boost::system::error_code const & ec) {
+  --pending_;
+  if (done_) return;
+  if (!ec) {
+    NETWORK_MESSAGE("connected to " << endpoints_[index]);
+    std::unique_ptr<boost::asio::ip::tcp::socket> winner(std::move(sockets_[index]));
+    finish(ec, std::move(winner));
+    return;
+  }
+  NETWORK_MESSAGE("could not connect to " << endpoints_[index] << ": " << ec);
+  last_error_ = ec;
+  sockets_[index].reset();
+  // There is no point in waiting out the delay after a failure.
+  boost::system::error_code ignored;
+  delay_timer_.cancel(ignored);
+  attempt();
+}
+
+void connection_race::handle_delay(std::size_t next, boost::system::error_code const & ec) {
+  // A failed attempt may already have started the next one.
+  if (ec || done_ || next != next_) return;
+  NETWORK_MESSAGE("no connection after " << attempt_delay_.count() << "ms, trying another address");
+  attempt();
+}
+
+void connection_race::finish(boost::system::error_code const & ec,
+                             std::unique_ptr<boost::asio::ip::tcp::socket> winner) {
+  done_ = true;
+  close_all();
+  std::lock_guard<std::recursive_mutex> lock(callback_mutex_);
+  completion_function once_connected;
+  std::swap(once_connected, once_connected_);
+  if (once_connected) once_connected(ec, std::move(winner));
+}
+
+void connection_race::close_all() {
+  boost::system::error_code ignored;
+  delay_timer_.cancel(ignored);
+  for (std::size_t i = 0; i < sockets_.size(); ++i) {
+    if (sockets_[i]) sockets_[i]->close(ignored);
+  }
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_CONNECTION_RACE_IPP_20121018 */
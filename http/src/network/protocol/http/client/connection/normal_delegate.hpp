@@ -7,6 +7,7 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_NORMAL_DELEGATE_20110819
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_NORMAL_DELEGATE_20110819
 
+#include <chrono>
 #include <memory>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 
@@ -21,21 +22,32 @@ class io_service;
 namespace network {
 namespace http {
 
+class client_options;
+struct connection_race;
+
 struct normal_delegate : connection_delegate {
-  normal_delegate(boost::asio::io_service & service);
+  normal_delegate(boost::asio::io_service & service,
+                  client_options const &options);
 
   virtual void connect(boost::asio::ip::tcp::endpoint & endpoint,
                        std::string const &host,
                        std::function<void(boost::system::error_code const &)> handler);
+  virtual void connect_to_any(std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+                              std::string const & host,
+                              std::function<void(boost::system::error_code const &)> handler);
   virtual void write(boost::asio::streambuf & command_streambuf,
                      std::function<void(boost::system::error_code const &, size_t)> handler);
   virtual void read_some(boost::asio::mutable_buffers_1 const & read_buffer,
                          std::function<void(boost::system::error_code const &, size_t)> handler);
+  virtual bool is_open();
+  virtual void disconnect();
   ~normal_delegate();
 
  private:
   boost::asio::io_service & service_;
+  std::chrono::milliseconds attempt_delay_;
   std::unique_ptr<boost::asio::ip::tcp::socket> socket_;
+  std::shared_ptr<connection_race> race_;
 
   normal_delegate(normal_delegate const &);  // = delete
   normal_delegate& operator=(normal_delegate);  // = delete
@@ -13,10 +13,14 @@
 #include <functional>
 #include <boost/asio/buffer.hpp>
 #include <network/protocol/http/client/connection/normal_delegate.hpp>
+#include <network/protocol/http/client/connection/connection_race.hpp>
+#include <network/protocol/http/client/options.hpp>
 #include <network/detail/debug.hpp>
 
-network::http::normal_delegate::normal_delegate(boost::asio::io_service & service)
+network::http::normal_delegate::normal_delegate(boost::asio::io_service & service,
+                                                client_options const &options)
 : service_(service)
+, attempt_delay_(options.connection_attempt_delay())
 {}
 
 void network::http::normal_delegate::connect(boost::asio::ip::tcp::endpoint & endpoint,
@@ -26,6 +30,23 @@ void network::http::normal_delegate::connect(boost::asio::ip::tcp::endpoint & en
   socket_->async_connect(endpoint, handler);
 }
 
+void network::http::normal_delegate::connect_to_any(
+    std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+    std::string const &host,
+    std::function<void(boost::system::error_code const &)> handler) {
+  NETWORK_MESSAGE("normal_delegate::connect_to_any(...)");
+  socket_.reset();
+  race_ = std::make_shared<connection_race>(
+      service_, connection_race::interleave(endpoints), attempt_delay_);
+  race_->start(
+      [this, handler](boost::system::error_code const & ec,
+                      std::unique_ptr<boost::asio::ip::tcp::socket> winner) {
+        race_.reset();
+        socket_ = std::move(winner);
+        handler(ec);
+      });
+}
+
 void network::http::normal_delegate::write(boost::asio::streambuf & command_streambuf,
                                            std::function<void(boost::system::error_code const &, size_t)> handler) {
   NETWORK_MESSAGE("normal_delegate::write(...)");
@@ -41,6 +62,37 @@ void network::http::normal_delegate::read_some(boost::asio::mutable_buffers_1 co
   NETWORK_MESSAGE("scheduled asynchronous read some...");
 }
 
-network::http::normal_delegate::~normal_delegate() {}
+bool network::http::normal_delegate::is_open() {
+  if (!socket_.get() || !socket_->is_open()) return false;
+  // Peek without blocking: an idle connection has nothing to read, so either
+  // data or an end of file means it cannot be used for another request.
+  boost::system::error_code ec;
+  bool const non_blocking = socket_->non_blocking();
+  socket_->non_blocking(true, ec);
+  char byte;
+  socket_->receive(boost::asio::buffer(&byte, 1),
+                   boost::asio::ip::tcp::socket::message_peek,
+                   ec);
+  boost::system::error_code ignored;
+  socket_->non_blocking(non_blocking, ignored);
+  return ec == boost::asio::error::would_block;
+}
+
+void network::http::normal_delegate::disconnect() {
+  NETWORK_MESSAGE("normal_delegate::disconnect()");
+  if (race_) {
+    race_->cancel();
+    race_.reset();
+  }
+  if (!socket_.get()) return;
+  boost::system::error_code ignored;
+  socket_->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+  socket_->close(ignored);
+}
+
+network::http::normal_delegate::~normal_delegate() {
+  // The race calls back into this delegate.
+  if (race_) race_->cancel();
+}
 
 #endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_NORMAL_DELEGATE_IPP_20110819 */
@@ -0,0 +1,135 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_HPP_20121018
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <boost/asio/io_service.hpp>
+#include <network/protocol/http/client/connection/resolver_delegate.hpp>
+
+namespace network {
+namespace http {
+
+/// Forward declaration of resolver_cache_pimpl.
+struct resolver_cache_pimpl;
+
+/// Forward declaration of the client_options class.
+class client_options;
+
+/** resolver_cache_statistics
+ *
+ *  Counters kept by a resolver_cache since it was created.
+ */
+struct resolver_cache_statistics {
+  /// Resolutions answered from a cached list of endpoints.
+  std::size_t hits;
+  /// Resolutions answered from a cached "host not found".
+  std::size_t negative_hits;
+  /// Lookups sent to the system resolver, refreshes included.
+  std::size_t lookups;
+  /// Resolutions that waited for a lookup of the same name already running.
+  std::size_t coalesced;
+  /// Lookups started in the background for entries close to expiring.
+  std::size_t refreshes;
+  /// Names cached right now, positive and negative.
+  std::size_t entries;
+};
+
+/** resolver_cache
+ *
+ *  A thread-safe cache of resolved endpoints that can be shared by the
+ *  resolvers of any number of connections, io_services and clients.
+ *
+ *  Entries are kept per host and port for `ttl`; names the resolver reports
+ *  as not existing are remembered for `negative_ttl` so they fail fast.
+ *  Resolutions of a name that is already being looked up wait for that
+ *  lookup instead of starting their own. A name resolved again during the
+ *  last quarter of its ttl is looked up again in the background while the
+ *  cached endpoints are handed out, so names in steady use never expire.
+ *
+ *  The system resolver does not report the TTLs of the records it returns,
+ *  so the cache applies the same ones to every name. To use it:
+ *
+ *    client_options options;
+ *    options.resolver_cache(std::make_shared<resolver_cache>(
+ *        std::chrono::seconds(300), std::chrono::seconds(10)));
+ *    client client_(options);
+ */
+struct resolver_cache {
+  typedef resolver_delegate::resolver_iterator resolver_iterator;
+  typedef resolver_delegate::resolve_completion_function resolve_completion_function;
+
+  explicit resolver_cache(
+      std::chrono::milliseconds ttl = std::chrono::seconds(60),
+      std::chrono::milliseconds negative_ttl = std::chrono::seconds(5));
+
+  /** process_cache
+   *
+   * Returns the cache shared by every client in the process that sets
+   * cache_resolved without providing a cache of its own.
+   */
+  static std::shared_ptr<resolver_cache> process_cache();
+
+  /** for_options
+   *
+   * Returns the cache a client with the given options uses: its own
+   * resolver_cache, the process cache when cache_resolved is set, or a
+   * null pointer when nothing is cached.
+   */
+  static std::shared_ptr<resolver_cache> for_options(client_options const & options);
+
+  /** resolve
+   *
+   * Calls `once_resolved` with the endpoints of `host` and `port`, right
+   * away when they are cached and otherwise once a lookup on `service`
+   * finishes, from a thread running that io_service.
+   */
+  void resolve(boost::asio::io_service & service,
+               std::string const & host,
+               uint16_t port,
+               resolve_completion_function once_resolved);
+
+  /** clear
+   *
+   * Forgets every cached name. Lookups already running still complete.
+   */
+  void clear();
+
+  /** statistics
+   *
+   * Returns a snapshot of the cache's counters.
+   */
+  resolver_cache_statistics statistics() const;
+
+  virtual ~resolver_cache();
+
+ protected:
+  typedef std::function<void(boost::system::error_code const &, resolver_iterator)>
+      lookup_handler;
+
+  // Asks the system resolver for the endpoints of a name. This is called
+  // without any lock held and may complete before it returns.
+  virtual void lookup(boost::asio::io_service & service,
+                      std::string const & host,
+                      uint16_t port,
+                      lookup_handler handler);
+
+ private:
+  // Shared with the lookups in progress, which may outlive the cache.
+  std::shared_ptr<resolver_cache_pimpl> pimpl;
+
+  resolver_cache(resolver_cache const &);  // = delete
+  resolver_cache& operator=(resolver_cache);  // = delete
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_HPP_20121018 */
@@ -0,0 +1,244 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_IPP_20121018
+
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/lexical_cast.hpp>
+#include <network/protocol/http/client/connection/resolver_cache.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/detail/debug.hpp>
+
+namespace network {
+namespace http {
+
+struct resolver_cache_pimpl {
+  typedef resolver_cache::resolver_iterator resolver_iterator;
+  typedef resolver_cache::resolve_completion_function resolve_completion_function;
+  typedef std::chrono::steady_clock clock;
+
+  resolver_cache_pimpl(std::chrono::milliseconds ttl,
+                       std::chrono::milliseconds negative_ttl)
+  : ttl_(ttl)
+  , negative_ttl_(negative_ttl)
+  , statistics_() {
+    NETWORK_MESSAGE("resolver_cache_pimpl::resolver_cache_pimpl(...)");
+  }
+
+  // What resolve() found out while holding the lock.
+  enum outcome { answered, refresh, look_up, wait };
+
+  outcome find(std::string const & key,
+               boost::asio::io_service & service,
+               resolve_completion_function const & once_resolved,
+               boost::system::error_code & ec,
+               resolver_iterator & endpoints) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clock::time_point const now = clock::now();
+    entry_map::iterator cached = entries_.find(key);
+    if (cached != entries_.end()) {
+      if (now < cached->second.expires) {
+        ec = cached->second.error;
+        endpoints = cached->second.endpoints;
+        if (ec) {
+          ++statistics_.negative_hits;
+          return answered;
+        }
+        ++statistics_.hits;
+        if (now < cached->second.refresh_at || pending_.count(key))
+          return answered;
+        // Nobody waits for a refresh, but a resolution of the same name
+        // after the entry expires will wait for it rather than look it up
+        // again.
+        pending_[key];
+        ++statistics_.lookups;
+        ++statistics_.refreshes;
+        return refresh;
+      }
+      entries_.erase(cached);
+      statistics_.entries = entries_.size();
+    }
+    pending_map::iterator running = pending_.find(key);
+    if (running != pending_.end()) {
+      running->second.push_back(waiter(&service, once_resolved));
+      ++statistics_.coalesced;
+      return wait;
+    }
+    pending_[key].push_back(waiter(&service, once_resolved));
+    ++statistics_.lookups;
+    return look_up;
+  }
+
+  void complete(std::string const & key,
+                boost::system::error_code const & ec,
+                resolver_iterator endpoints) {
+    std::vector<waiter> waiters;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_map::iterator running = pending_.find(key);
+      if (running != pending_.end()) {
+        waiters.swap(running->second);
+        pending_.erase(running);
+      }
+      clock::time_point const now = clock::now();
+      if (!ec) {
+        entry & cached = entries_[key];
+        cached.endpoints = endpoints;
+        cached.error = ec;
+        cached.expires = now + ttl_;
+        cached.refresh_at = now + ttl_ * 3 / 4;
+      } else if (ec == boost::asio::error::host_not_found ||
+                 ec == boost::asio::error::no_data) {
+        entry & cached = entries_[key];
+        cached.endpoints = resolver_iterator();
+        cached.error = ec;
+        cached.expires = now + negative_ttl_;
+        cached.refresh_at = cached.expires;
+      }
+      // Other failures are taken to be passing ones. A failed refresh
+      // leaves the entry to expire; the next resolution after that tries
+      // again.
+      statistics_.entries = entries_.size();
+    }
+    NETWORK_MESSAGE("resolved " << key << ": " << ec << ", "
+                    << waiters.size() << " waiting");
+    for (std::size_t i = 0; i < waiters.size(); ++i) {
+      waiters[i].service->post(
+          std::bind(waiters[i].once_resolved,
+                    ec,
+                    std::make_pair(endpoints, resolver_iterator())));
+    }
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    statistics_.entries = 0;
+  }
+
+  resolver_cache_statistics statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+  }
+
+  ~resolver_cache_pimpl() {
+    NETWORK_MESSAGE("resolver_cache_pimpl::~resolver_cache_pimpl()");
+  }
+
+ private:
+  struct entry {
+    resolver_iterator endpoints;
+    boost::system::error_code error;
+    clock::time_point expires, refresh_at;
+  };
+
+  struct waiter {
+    waiter(boost::asio::io_service * service, resolve_completion_function once_resolved)
+    : service(service), once_resolved(once_resolved) {}
+    boost::asio::io_service * service;
+    resolve_completion_function once_resolved;
+  };
+
+  typedef std::unordered_map<std::string, entry> entry_map;
+  typedef std::unordered_map<std::string, std::vector<waiter> > pending_map;
+
+  std::chrono::milliseconds const ttl_, negative_ttl_;
+  mutable std::mutex mutex_;
+  entry_map entries_;
+  pending_map pending_;
+  resolver_cache_statistics statistics_;
+};
+
+namespace {
+
+void lookup_finished(std::shared_ptr<boost::asio::ip::udp::resolver>,
+                     std::function<void(boost::system::error_code const &,
+                                        resolver_cache::resolver_iterator)> handler,
+                     boost::system::error_code const & ec,
+                     resolver_cache::resolver_iterator endpoints) {
+  handler(ec, endpoints);
+}
+
+}  // namespace
+
+resolver_cache::resolver_cache(std::chrono::milliseconds ttl,
+                               std::chrono::milliseconds negative_ttl)
+: pimpl(new (std::nothrow) resolver_cache_pimpl(ttl, negative_ttl)) {
+  NETWORK_MESSAGE("resolver_cache::resolver_cache(...)");
+}
+
+std::shared_ptr<resolver_cache> resolver_cache::process_cache() {
+  static std::shared_ptr<resolver_cache> cache(new (std::nothrow) resolver_cache());
+  return cache;
+}
+
+std::shared_ptr<resolver_cache> resolver_cache::for_options(client_options const & options) {
+  std::shared_ptr<resolver_cache> cache = options.resolver_cache();
+  if (!cache && options.cache_resolved())
+    cache = process_cache();
+  return cache;
+}
+
+void resolver_cache::resolve(boost::asio::io_service & service,
+                             std::string const & host,
+                             uint16_t port,
+                             resolve_completion_function once_resolved) {
+  BOOST_ASSERT(pimpl.get() && "Uninitialized pimpl, probably ran out of memory.");
+  std::string const key =
+      boost::to_lower_copy(host) + ':' + boost::lexical_cast<std::string>(port);
+  boost::system::error_code ec;
+  resolver_iterator endpoints;
+  resolver_cache_pimpl::outcome const outcome =
+      pimpl->find(key, service, once_resolved, ec, endpoints);
+  if (outcome == resolver_cache_pimpl::answered ||
+      outcome == resolver_cache_pimpl::refresh) {
+    NETWORK_MESSAGE("cached " << key << ": " << ec);
+    once_resolved(ec, std::make_pair(endpoints, resolver_iterator()));
+  }
+  if (outcome == resolver_cache_pimpl::look_up ||
+      outcome == resolver_cache_pimpl::refresh) {
+    NETWORK_MESSAGE("looking up " << key);
+    using namespace std::placeholders;
+    lookup(service, host, port,
+           std::bind(&resolver_cache_pimpl::complete, pimpl, key, _1, _2));
+  }
+}
+
+void resolver_cache::clear() {
+  BOOST_ASSERT(pimpl.get() && "Uninitialized pimpl, probably ran out of memory.");
+  pimpl->clear();
+}
+
+resolver_cache_statistics resolver_cache::statistics() const {
+  BOOST_ASSERT(pimpl.get() && "Uninitialized pimpl, probably ran out of memory.");
+  return pimpl->statistics();
+}
+
+void resolver_cache::lookup(boost::asio::io_service & service,
+                            std::string const & host,
+                            uint16_t port,
+                            lookup_handler handler) {
+  std::shared_ptr<boost::asio::ip::udp::resolver> resolver =
+      std::make_shared<boost::asio::ip::udp::resolver>(service);
+  boost::asio::ip::udp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+  using namespace std::placeholders;
+  resolver->async_resolve(query, std::bind(&lookup_finished, resolver, handler, _1, _2));
+}
+
+resolver_cache::~resolver_cache() {
+  NETWORK_MESSAGE("resolver_cache::~resolver_cache()");
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_IPP_20121018 */
@@ -13,11 +13,13 @@
 
 namespace network { namespace http {
 
+class client_options;
+
 struct resolver_delegate_factory {
   resolver_delegate_factory();
   virtual std::shared_ptr<resolver_delegate> create_resolver_delegate(
       boost::asio::io_service & service,
-      bool cache_resolved);
+      client_options const & options);
   virtual ~resolver_delegate_factory();
  private:
   resolver_delegate_factory(resolver_delegate_factory const &);  // = delete
@@ -9,6 +9,7 @@
 
 #include <network/protocol/http/client/connection/resolver_delegate_factory.hpp>
 #include <network/protocol/http/client/connection/async_resolver.hpp>
+#include <network/protocol/http/client/options.hpp>
 #include <network/detail/debug.hpp>
 
 namespace network {
@@ -20,9 +21,9 @@ resolver_delegate_factory::resolver_delegate_factory() {
 
 std::shared_ptr<resolver_delegate>
 resolver_delegate_factory::create_resolver_delegate(boost::asio::io_service & service,
-                                                    bool cache_resolved) {
+                                                    client_options const & options) {
   NETWORK_MESSAGE("resolver_delegate_factory::create_resolver_delegate(...)");
-  return std::make_shared<async_resolver>(service, cache_resolved);
+  return std::make_shared<async_resolver>(service, resolver_cache::for_options(options));
 }
 
 resolver_delegate_factory::~resolver_delegate_factory() {
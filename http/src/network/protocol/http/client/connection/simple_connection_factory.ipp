@@ -42,10 +42,11 @@ struct simple_connection_factory_pimpl {
     NETWORK_MESSAGE("destination: " << uri_);
     bool https = boost::algorithm::to_lower_copy(std::string(*uri_.scheme())) == "https";
     return std::make_shared<http_async_connection>(
-      res_delegate_factory_->create_resolver_delegate(service, options.cache_resolved()),
+      res_delegate_factory_->create_resolver_delegate(service, options),
       conn_delegate_factory_->create_connection_delegate(service, https, options),
       service,
-      options.follow_redirects());
+      options.follow_redirects(),
+      options.pipeline_depth());
   }
 
  private:
@@ -7,7 +7,9 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_SSL_DELEGATE_20110819
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_SSL_DELEGATE_20110819
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <boost/asio/ssl.hpp>
 #include <network/protocol/http/client/connection/connection_delegate.hpp>
 #include <network/protocol/http/client/options.hpp>
@@ -22,30 +24,44 @@ class io_service;
 namespace network {
 namespace http {
 
+struct connection_race;
+struct tls_context;
+
 struct ssl_delegate : connection_delegate, boost::enable_shared_from_this<ssl_delegate> {
   ssl_delegate(boost::asio::io_service & service,
-               client_options const &options);
+               client_options const &options,
+               std::shared_ptr<tls_context> tls);
 
   virtual void connect(boost::asio::ip::tcp::endpoint & endpoint,
                        std::string const &host,
                        std::function<void(boost::system::error_code const &)> handler);
+  virtual void connect_to_any(std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+                              std::string const & host,
+                              std::function<void(boost::system::error_code const &)> handler);
+  virtual void handshake(std::function<void(boost::system::error_code const &)> handler);
   virtual void write(boost::asio::streambuf & command_streambuf,
                      std::function<void(boost::system::error_code const &, size_t)> handler);
   virtual void read_some(boost::asio::mutable_buffers_1 const & read_buffer,
                          std::function<void(boost::system::error_code const &, size_t)> handler);
+  virtual bool is_open();
+  virtual void disconnect();
   ~ssl_delegate();
 
  private:
   boost::asio::io_service & service_;
   client_options options_;
-  std::unique_ptr<boost::asio::ssl::context> context_;
+  std::chrono::milliseconds attempt_delay_;
+  // Both outlive the stream, which caches sessions under the key.
+  std::shared_ptr<tls_context> tls_;
+  std::string session_key_;
   std::unique_ptr<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>> socket_;
+  std::shared_ptr<connection_race> race_;
 
   ssl_delegate(ssl_delegate const &);  // = delete
   ssl_delegate& operator=(ssl_delegate);  // = delete
 
-  void handle_connected(boost::system::error_code const & ec,
-                        std::function<void(boost::system::error_code const &)> handler);
+  // Sets up a stream that is not connected yet.
+  void make_stream(std::string const &host, unsigned short port);
 };
 
 }  // namespace http
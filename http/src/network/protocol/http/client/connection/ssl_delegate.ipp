@@ -9,14 +9,43 @@
 
 #include <network/protocol/http/client/options.hpp>
 #include <network/protocol/http/client/connection/ssl_delegate.hpp>
+#include <network/protocol/http/client/connection/connection_race.hpp>
+#include <network/protocol/http/client/connection/tls_context.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <network/detail/debug.hpp>
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+namespace network { namespace http { namespace impl {
+
+// Whether the peer has shut down its side of the connection, even though
+// there is still data to read in front of the end of the stream. Only
+// Linux can tell; elsewhere this is always false.
+inline bool peer_shut_down(boost::asio::ip::tcp::socket & socket) {
+#if defined(__linux__) && defined(POLLRDHUP)
+  pollfd events = { socket.native_handle(), POLLRDHUP, 0 };
+  return ::poll(&events, 1, 0) > 0 && (events.revents & (POLLRDHUP | POLLHUP | POLLERR));
+#else
+  return false;
+#endif
+}
+
+}  // namespace impl
+}  // namespace http
+}  // namespace network
 
 network::http::ssl_delegate::ssl_delegate(boost::asio::io_service & service,
-                                          client_options const &options) :
+                                          client_options const &options,
+                                          std::shared_ptr<tls_context> tls) :
 service_(service),
-options_(options) {
+options_(options),
+attempt_delay_(options.connection_attempt_delay()),
+tls_(tls) {
   NETWORK_MESSAGE("ssl_delegate::ssl_delegate(...)");
 }
 
@@ -24,61 +53,50 @@ void network::http::ssl_delegate::connect(boost::asio::ip::tcp::endpoint & endpo
                                           std::string const &host,
                                           std::function<void(boost::system::error_code const &)> handler) {
   NETWORK_MESSAGE("ssl_delegate::connect(...)");
-  context_.reset(new boost::asio::ssl::context(boost::asio::ssl::context::sslv23));
-  std::list<std::string> const & certificate_paths =
-  options_.openssl_certificate_paths();
-  std::list<std::string> const & verifier_paths =
-  options_.openssl_verify_paths();
-  bool use_default_verification = certificate_paths.empty() && verifier_paths.empty();
-  if (!use_default_verification) {
-    for (std::list<std::string>::const_iterator it = certificate_paths.begin();
-         it != certificate_paths.end(); ++it) {
-      context_->load_verify_file(*it);
-    }
-    for (std::list<std::string>::const_iterator it = verifier_paths.begin();
-         it != verifier_paths.begin(); ++it) {
-      context_->add_verify_path(*it);
-    }
-    NETWORK_MESSAGE("verifying peer: " << host);
-    context_->set_verify_mode(boost::asio::ssl::context::verify_peer);
-    context_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
-  } else {
-    NETWORK_MESSAGE("not verifying peer");
-    context_->set_default_verify_paths();
-    context_->set_verify_mode(boost::asio::ssl::context::verify_peer);
-    context_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
-  }
-  socket_.reset(new boost::asio::ssl::stream<boost::asio::ip::tcp::socket>(service_, *context_));
+  make_stream(host, endpoint.port());
   NETWORK_MESSAGE("scheduling asynchronous connection...");
-  using namespace std::placeholders;
-  socket_->lowest_layer().async_connect(endpoint,
-                                        std::bind(&network::http::ssl_delegate::handle_connected,
-                                                  network::http::ssl_delegate::shared_from_this(),
-                                                  _1,
-                                                  handler));
+  socket_->lowest_layer().async_connect(endpoint, handler);
 }
 
+void network::http::ssl_delegate::connect_to_any(
+    std::vector<boost::asio::ip::tcp::endpoint> const & endpoints,
+    std::string const &host,
+    std::function<void(boost::system::error_code const &)> handler) {
+  NETWORK_MESSAGE("ssl_delegate::connect_to_any(...)");
+  make_stream(host, endpoints.empty() ? 0 : endpoints.front().port());
+  race_ = std::make_shared<connection_race>(
+      service_, connection_race::interleave(endpoints), attempt_delay_);
+  race_->start(
+      [this, handler](boost::system::error_code const & ec,
+                      std::unique_ptr<boost::asio::ip::tcp::socket> winner) {
+        race_.reset();
+        if (winner) socket_->next_layer() = std::move(*winner);
+        handler(ec);
+      });
+}
 
-void network::http::ssl_delegate::handle_connected(boost::system::error_code const & ec,
-                                                   std::function<void(boost::system::error_code const &)> handler) {
-  NETWORK_MESSAGE("ssl_delegate::handle_connected(...)");
-  if (!ec) {
-    NETWORK_MESSAGE("connected to endpoint.");
-    // Here we check if there's an existing session for the connection.
-    SSL_SESSION *existing_session = SSL_get1_session(socket_->impl()->ssl);
-    if (existing_session == NULL) {
-      NETWORK_MESSAGE("found no existing session, performing handshake.");
-      socket_->async_handshake(boost::asio::ssl::stream_base::client, handler);
-    } else {
-      NETWORK_MESSAGE("found existing session, bypassing handshake.");
-      SSL_set_session(socket_->impl()->ssl, existing_session);
-      SSL_connect(socket_->impl()->ssl);
-      handler(ec);
-    }
-  } else {
-    NETWORK_MESSAGE("encountered error: " << ec);
-    handler(ec);
-  }
+void network::http::ssl_delegate::make_stream(std::string const &host, unsigned short port) {
+  socket_.reset(new boost::asio::ssl::stream<boost::asio::ip::tcp::socket>(service_, tls_->context()));
+  NETWORK_MESSAGE("verifying peer: " << host);
+  socket_->set_verify_mode(boost::asio::ssl::verify_peer);
+  socket_->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
+  session_key_ = host + ':' + boost::lexical_cast<std::string>(port);
+  tls_->prepare(socket_->native_handle(), host, &session_key_);
+}
+
+void network::http::ssl_delegate::handshake(
+    std::function<void(boost::system::error_code const &)> handler) {
+  NETWORK_MESSAGE("ssl_delegate::handshake(...)");
+  SSL * ssl = socket_->native_handle();
+  socket_->async_handshake(
+      boost::asio::ssl::stream_base::client,
+      [this, ssl, handler](boost::system::error_code const & ec) {
+        // A stream closed in the meantime may already be gone.
+        if (ec != boost::asio::error::operation_aborted &&
+            socket_.get() && socket_->native_handle() == ssl)
+          tls_->handshake_finished(ssl, session_key_, !ec);
+        handler(ec);
+      });
 }
 
 void network::http::ssl_delegate::write(boost::asio::streambuf & command_streambuf,
@@ -95,8 +113,84 @@ void network::http::ssl_delegate::read_some(boost::asio::mutable_buffers_1 const
   socket_->async_read_some(read_buffer, handler);
 }
 
+bool network::http::ssl_delegate::is_open() {
+  if (!socket_.get() || !socket_->next_layer().is_open()) return false;
+  SSL * ssl = socket_->native_handle();
+  // A close_notify OpenSSL has seen already, or data nobody asked for.
+  if ((SSL_get_shutdown(ssl) & SSL_RECEIVED_SHUTDOWN) || SSL_pending(ssl) > 0)
+    return false;
+  // Records that arrived with the last read wait in the stream's BIO until
+  // OpenSSL gets to them; anything after that is still in the socket.
+  unsigned char records[512];
+  std::size_t available = 0;
+  char * buffered = 0;
+  int const pending = BIO_nread0(SSL_get_rbio(ssl), &buffered);
+  if (pending > 0) {
+    available = std::min<std::size_t>(pending, sizeof(records));
+    std::memcpy(records, buffered, available);
+  }
+  boost::asio::ip::tcp::socket & socket = socket_->next_layer();
+  boost::system::error_code ec;
+  bool const non_blocking = socket.non_blocking();
+  socket.non_blocking(true, ec);
+  std::size_t const peeked =
+      socket.receive(boost::asio::buffer(records + available, sizeof(records) - available),
+                     boost::asio::ip::tcp::socket::message_peek,
+                     ec);
+  boost::system::error_code ignored;
+  socket.non_blocking(non_blocking, ignored);
+  if (ec && ec != boost::asio::error::would_block) return false;
+  if (!ec && peeked == 0) return false;
+  if (!ec) available += peeked;
+  if (available == 0) return true;
+  // Nothing is expected after a response before TLS 1.3. TLS 1.3 servers
+  // may send session tickets or key updates, but a close_notify looks the
+  // same from out here: an application data record. An alert is the
+  // shortest such record there is, and a server that sent one has usually
+  // shut down its side of the TCP stream as well.
+#if defined(TLS1_3_VERSION)
+  bool const tls_1_3 = SSL_version(ssl) >= TLS1_3_VERSION;
+#else
+  bool const tls_1_3 = false;
+#endif
+  if (!tls_1_3 || impl::peer_shut_down(socket)) return false;
+  std::size_t const record_header_size = 5, encrypted_alert_size = 2 + 1 + 16;
+  unsigned char const application_data = 23;
+  for (std::size_t offset = 0; offset + record_header_size <= available; ) {
+    std::size_t const length = (records[offset + 3] << 8) | records[offset + 4];
+    if (records[offset] != application_data || length <= encrypted_alert_size)
+      return false;
+    offset += record_header_size + length;
+  }
+  return true;
+}
+
+void network::http::ssl_delegate::disconnect() {
+  NETWORK_MESSAGE("ssl_delegate::disconnect()");
+  if (race_) {
+    race_->cancel();
+    race_.reset();
+  }
+  if (!socket_.get()) return;
+  // OpenSSL stops resuming sessions of connections freed without a TLS
+  // shutdown. We don't wait for the server's close_notify any more than
+  // for the end of the TCP stream: HTTP's own framing tells us whether a
+  // response was complete.
+  SSL_set_shutdown(socket_->native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  boost::system::error_code ignored;
+  socket_->lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both,
+                                   ignored);
+  socket_->lowest_layer().close(ignored);
+}
+
 network::http::ssl_delegate::~ssl_delegate() {
   NETWORK_MESSAGE("ssl_delegate::~ssl_delegate()");
+  // The race calls back into this delegate.
+  if (race_) race_->cancel();
+  // Connections that are dropped rather than disconnected keep their
+  // sessions resumable too; see disconnect().
+  if (socket_.get())
+    SSL_set_shutdown(socket_->native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
 }
 
 #endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_SSL_DELEGATE_IPP_20110819 */
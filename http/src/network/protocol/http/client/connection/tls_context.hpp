@@ -0,0 +1,119 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_HPP_20121018
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/asio/ssl/context.hpp>
+
+namespace network {
+namespace http {
+
+/// Forward declaration of the client_options class.
+class client_options;
+
+/** tls_session_statistics
+ *
+ *  Counters kept by a tls_context since it was created.
+ */
+struct tls_session_statistics {
+  /// Handshakes that negotiated a new session.
+  std::size_t full_handshakes;
+  /// Handshakes that resumed a cached session.
+  std::size_t resumed_handshakes;
+  /// Handshakes that failed, resumption attempts included.
+  std::size_t failed_handshakes;
+  /// Sessions cached right now.
+  std::size_t cached_sessions;
+};
+
+/** tls_context
+ *
+ *  The TLS configuration shared by a client's HTTPS connections: one SSL
+ *  context with the certificates from the client_options loaded once, and
+ *  a cache of the sessions (session IDs and tickets) servers hand out, kept
+ *  per host and port so later connections resume them instead of doing a
+ *  full handshake.
+ *
+ *  By default every connection delegate factory builds one for each set of
+ *  certificate and verify paths it is asked to use. To share one between
+ *  clients, or to read its counters:
+ *
+ *    client_options options;
+ *    std::shared_ptr<tls_context> tls = std::make_shared<tls_context>(options);
+ *    options.tls_context(tls);
+ *    client client_(options);
+ */
+struct tls_context {
+  explicit tls_context(client_options const & options,
+                       std::size_t max_cached_sessions = 256);
+
+  boost::asio::ssl::context & context();
+
+  /** prepare
+   *
+   * Sets up a connection to `host` before its handshake: the server name
+   * to send, and the session to resume if one is cached for `key`.
+   * `key` must stay valid for as long as the connection does; sessions the
+   * server hands out on it are cached under it.
+   */
+  void prepare(SSL * ssl, std::string const & host, std::string const * key);
+
+  /** handshake_finished
+   *
+   * Counts a handshake, and forgets the session cached for `key` when a
+   * handshake that tried to resume it failed.
+   */
+  void handshake_finished(SSL * ssl, std::string const & key, bool succeeded);
+
+  /** clear
+   *
+   * Forgets every cached session.
+   */
+  void clear();
+
+  /** statistics
+   *
+   * Returns a snapshot of the counters.
+   */
+  tls_session_statistics statistics() const;
+
+  ~tls_context();
+
+ private:
+  typedef std::list<std::string> recency_list;
+  struct cached_session {
+    SSL_SESSION * session;
+    recency_list::iterator recency;
+  };
+  typedef std::unordered_map<std::string, cached_session> session_map;
+
+  static int context_index();
+  static int key_index();
+  static int new_session(SSL * ssl, SSL_SESSION * session);
+  void store(std::string const & key, SSL_SESSION * session);
+  void forget(session_map::iterator entry);
+
+  boost::asio::ssl::context context_;
+  std::size_t const max_cached_sessions_;
+  mutable std::mutex mutex_;
+  session_map sessions_;
+  // Most recently stored first; the last one goes when the cache is full.
+  recency_list recency_;
+  tls_session_statistics statistics_;
+
+  tls_context(tls_context const &);  // = delete
+  tls_context& operator=(tls_context);  // = delete
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_HPP_20121018 */
@@ -0,0 +1,146 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_IPP_20121018
+
+#include <boost/asio/ip/address.hpp>
+#include <network/protocol/http/client/connection/tls_context.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/detail/debug.hpp>
+
+namespace network {
+namespace http {
+
+tls_context::tls_context(client_options const & options,
+                         std::size_t max_cached_sessions)
+: context_(boost::asio::ssl::context::sslv23)
+, max_cached_sessions_(max_cached_sessions)
+, statistics_() {
+  NETWORK_MESSAGE("tls_context::tls_context(...)");
+  std::list<std::string> const & certificate_paths =
+  options.openssl_certificate_paths();
+  std::list<std::string> const & verifier_paths =
+  options.openssl_verify_paths();
+  if (certificate_paths.empty() && verifier_paths.empty()) {
+    context_.set_default_verify_paths();
+  } else {
+    for (std::list<std::string>::const_iterator it = certificate_paths.begin();
+         it != certificate_paths.end(); ++it) {
+      context_.load_verify_file(*it);
+    }
+    for (std::list<std::string>::const_iterator it = verifier_paths.begin();
+         it != verifier_paths.end(); ++it) {
+      context_.add_verify_path(*it);
+    }
+  }
+  context_.set_verify_mode(boost::asio::ssl::context::verify_peer);
+
+  // OpenSSL hands us the sessions as the servers issue them, which for
+  // TLS 1.3 tickets is after the handshake; we keep them ourselves, per
+  // host and port, rather than in the context's own cache.
+  SSL_CTX * ctx = context_.native_handle();
+  SSL_CTX_set_ex_data(ctx, context_index(), this);
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, &tls_context::new_session);
+}
+
+boost::asio::ssl::context & tls_context::context() {
+  return context_;
+}
+
+void tls_context::prepare(SSL * ssl, std::string const & host, std::string const * key) {
+  boost::system::error_code not_an_address;
+  boost::asio::ip::address::from_string(host, not_an_address);
+  // Servers are only told names, not addresses (RFC 6066).
+  if (not_an_address)
+    SSL_set_tlsext_host_name(ssl, host.c_str());
+  SSL_set_ex_data(ssl, key_index(), const_cast<std::string *>(key));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  session_map::iterator entry = sessions_.find(*key);
+  if (entry == sessions_.end()) return;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  if (!SSL_SESSION_is_resumable(entry->second.session)) {
+    forget(entry);
+    return;
+  }
+#endif
+  NETWORK_MESSAGE("resuming the session cached for " << *key);
+  SSL_set_session(ssl, entry->second.session);
+}
+
+void tls_context::handshake_finished(SSL * ssl, std::string const & key, bool succeeded) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!succeeded) {
+    ++statistics_.failed_handshakes;
+    session_map::iterator entry = sessions_.find(key);
+    if (entry != sessions_.end()) forget(entry);
+  } else if (SSL_session_reused(ssl)) {
+    ++statistics_.resumed_handshakes;
+  } else {
+    ++statistics_.full_handshakes;
+  }
+}
+
+void tls_context::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!sessions_.empty()) forget(sessions_.begin());
+}
+
+tls_session_statistics tls_context::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+tls_context::~tls_context() {
+  NETWORK_MESSAGE("tls_context::~tls_context()");
+  clear();
+}
+
+int tls_context::context_index() {
+  static int const index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+  return index;
+}
+
+int tls_context::key_index() {
+  static int const index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+  return index;
+}
+
+int tls_context::new_session(SSL * ssl, SSL_SESSION * session) {
+  std::string const * key = static_cast<std::string const *>(SSL_get_ex_data(ssl, key_index()));
+  tls_context * self = static_cast<tls_context *>(
+      SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+  if (!key || !self) return 0;
+  self->store(*key, session);
+  // The cache keeps the reference OpenSSL gave us.
+  return 1;
+}
+
+void tls_context::store(std::string const & key, SSL_SESSION * session) {
+  NETWORK_MESSAGE("caching a session for " << key);
+  std::lock_guard<std::mutex> lock(mutex_);
+  session_map::iterator entry = sessions_.find(key);
+  if (entry != sessions_.end()) forget(entry);
+  recency_.push_front(key);
+  cached_session cached = { session, recency_.begin() };
+  sessions_.insert(std::make_pair(key, cached));
+  while (sessions_.size() > max_cached_sessions_)
+    forget(sessions_.find(recency_.back()));
+  statistics_.cached_sessions = sessions_.size();
+}
+
+void tls_context::forget(session_map::iterator entry) {
+  SSL_SESSION_free(entry->second.session);
+  recency_.erase(entry->second.recency);
+  sessions_.erase(entry);
+  statistics_.cached_sessions = sessions_.size();
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_IPP_20121018 */
@@ -7,6 +7,9 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_MANAGER_HPP_20110930
 #define NETWORK_PROTOCOL_HTTP_CLIENT_CONNECTION_MANAGER_HPP_20110930
 
+#include <functional>
+#include <memory>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 
 namespace boost { namespace asio {
@@ -26,6 +29,15 @@ struct connection_manager {
       boost::asio::io_service & service,
       request_base const & request,
       client_options const & options) = 0;
+  // For clients that run several io_services: a connection bound to any of
+  // `services` will do, and `pick` is only called for the io_service a new
+  // connection is bound to. By default a connection is always asked for on
+  // the io_service `pick` returns.
+  virtual std::shared_ptr<client_connection> get_connection(
+      std::vector<boost::asio::io_service *> const & services,
+      std::function<boost::asio::io_service &()> const & pick,
+      request_base const & request,
+      client_options const & options);
   virtual void clear_resolved_cache() = 0;
   virtual void reset() = 0;
   virtual ~connection_manager() = 0;
@@ -12,6 +12,14 @@
 
 namespace network { namespace http {
 
+std::shared_ptr<client_connection> connection_manager::get_connection(
+    std::vector<boost::asio::io_service *> const & services,
+    std::function<boost::asio::io_service &()> const & pick,
+    request_base const & request,
+    client_options const & options) {
+  return get_connection(pick(), request, options);
+}
+
 connection_manager::~connection_manager() {
   NETWORK_MESSAGE("connection_manager::~connection_manager()");
   // default implementation, for linkage only.
@@ -9,6 +9,7 @@
 
 #include <network/protocol/http/request.hpp>
 #include <network/protocol/http/response.hpp>
+#include <network/protocol/http/response/response_state.hpp>
 #include <network/protocol/http/client/base.hpp>
 #include <network/protocol/http/client/options.hpp>
 
@@ -17,6 +18,9 @@ namespace http {
 
 struct basic_client_facade {
   typedef client_base::body_callback_function_type body_callback_function_type;
+  typedef response_state::headers_callback headers_callback_function_type;
+  typedef response_state::completion_callback completion_callback_function_type;
+  typedef request_options::body_producer_function_type body_producer_function_type;
 
   basic_client_facade();
   explicit basic_client_facade(client_options const &options);
@@ -38,6 +42,58 @@ struct basic_client_facade {
   response const delete_(request const & request,
                          body_callback_function_type body_handler = body_callback_function_type(),
                          request_options const & options = request_options());
+
+  // These stream the body from `producer` rather than holding all of it in
+  // memory; see request_options::body_producer. The body goes out with a
+  // Content-Length when `length` is given, and chunked otherwise. A body in
+  // the request itself is not sent.
+  response const post(request request,
+                      body_producer_function_type producer,
+                      boost::optional<uint64_t> length = boost::optional<uint64_t>(),
+                      boost::optional<std::string> content_type = boost::optional<std::string>(),
+                      body_callback_function_type body_handler = body_callback_function_type(),
+                      request_options const &options = request_options());
+  response const put(request request,
+                     body_producer_function_type producer,
+                     boost::optional<uint64_t> length = boost::optional<uint64_t>(),
+                     boost::optional<std::string> content_type = boost::optional<std::string>(),
+                     body_callback_function_type body_handler = body_callback_function_type(),
+                     request_options const &options = request_options());
+
+  // These send the request and return without waiting for the response.
+  // on_headers gets it once its status line and headers have been read, and
+  // on_complete once it has been read in full, with a null exception_ptr, or
+  // with the error it failed with. They are registered after the request
+  // has been sent, so whichever of them is due by then runs right away on
+  // the caller's thread, inside the call; the others run on the thread that
+  // reads the response. Either way they should hand off anything that takes
+  // long, and must not take locks the caller holds around the call. They
+  // have names of their own so that a callable taking any two arguments is
+  // not ambiguous between a body handler and on_complete.
+  void async_head(request const &request,
+                  completion_callback_function_type on_complete,
+                  headers_callback_function_type on_headers = headers_callback_function_type(),
+                  request_options const &options = request_options());
+  void async_get(request const &request,
+                 completion_callback_function_type on_complete,
+                 headers_callback_function_type on_headers = headers_callback_function_type(),
+                 request_options const &options = request_options());
+  void async_post(request request,
+                  completion_callback_function_type on_complete,
+                  headers_callback_function_type on_headers = headers_callback_function_type(),
+                  boost::optional<std::string> body = boost::optional<std::string>(),
+                  boost::optional<std::string> content_type = boost::optional<std::string>(),
+                  request_options const &options = request_options());
+  void async_put(request request,
+                 completion_callback_function_type on_complete,
+                 headers_callback_function_type on_headers = headers_callback_function_type(),
+                 boost::optional<std::string> body = boost::optional<std::string>(),
+                 boost::optional<std::string> content_type = boost::optional<std::string>(),
+                 request_options const &options = request_options());
+  void async_delete(request const &request,
+                    completion_callback_function_type on_complete,
+                    headers_callback_function_type on_headers = headers_callback_function_type(),
+                    request_options const &options = request_options());
   void clear_resolved_cache();
 
 
@@ -8,6 +8,7 @@
 #define NETWORK_PROTOCOL_HTTP_CLIENT_FACADE_IPP_20120303
 
 #include <network/protocol/http/client/facade.hpp>
+#include <network/protocol/http/impl/access.hpp>
 #include <network/detail/debug.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -106,6 +107,126 @@ response const basic_client_facade::delete_(request const & request,
   return base->request_skeleton(request, "DELETE", true, body_handler, options);
 }
 
+namespace {
+
+// Sets a request up to have its body streamed after it, and returns the
+// options that tell the connection where the body comes from.
+request_options stream_body(request &request,
+                            basic_client_facade::body_producer_function_type producer,
+                            boost::optional<uint64_t> length,
+                            boost::optional<std::string> content_type,
+                            request_options const &options) {
+  request << remove_header("Content-Length")
+          << remove_header("Transfer-Encoding")
+          << network::body(std::string());
+  if (length) {
+    NETWORK_MESSAGE("streaming a body of " << *length << " bytes.");
+    request << header("Content-Length", boost::lexical_cast<std::string>(*length));
+  } else {
+    NETWORK_MESSAGE("streaming a chunked body.");
+    request << header("Transfer-Encoding", "chunked");
+  }
+
+  headers_wrapper::container_type const & headers_ =
+      headers(request);
+  if (content_type) {
+    request << remove_header("Content-Type")
+            << header("Content-Type", *content_type);
+  } else if (boost::empty(headers_.equal_range("Content-Type"))) {
+    static char default_content_type[] = "x-application/octet-stream";
+    request << header("Content-Type", default_content_type);
+  }
+
+  request_options streamed(options);
+  streamed.body_producer(producer).body_length(length);
+  return streamed;
+}
+
+void when_ready(response const &response_,
+                basic_client_facade::headers_callback_function_type on_headers,
+                basic_client_facade::completion_callback_function_type on_complete) {
+  std::shared_ptr<response_state> state =
+      impl::setter_access().get_response_state(response_);
+  if (!state) {
+    // Not read by a connection; there is nothing to wait for.
+    if (on_headers) on_headers(response_);
+    if (on_complete) on_complete(response_, std::exception_ptr());
+    return;
+  }
+  if (on_headers) state->on_headers(on_headers);
+  if (on_complete) state->on_complete(on_complete);
+}
+
+}  // namespace
+
+response const basic_client_facade::post(request request,
+                                         body_producer_function_type producer,
+                                         boost::optional<uint64_t> length,
+                                         boost::optional<std::string> content_type,
+                                         body_callback_function_type body_handler,
+                                         request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::post(...) with a body producer");
+  request_options streamed = stream_body(request, producer, length, content_type, options);
+  return base->request_skeleton(request, "POST", true, body_handler, streamed);
+}
+
+response const basic_client_facade::put(request request,
+                                        body_producer_function_type producer,
+                                        boost::optional<uint64_t> length,
+                                        boost::optional<std::string> content_type,
+                                        body_callback_function_type body_handler,
+                                        request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::put(...) with a body producer");
+  request_options streamed = stream_body(request, producer, length, content_type, options);
+  return base->request_skeleton(request, "PUT", true, body_handler, streamed);
+}
+
+void basic_client_facade::async_head(request const &request,
+                                     completion_callback_function_type on_complete,
+                                     headers_callback_function_type on_headers,
+                                     request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::async_head(...)");
+  when_ready(head(request, options), on_headers, on_complete);
+}
+
+void basic_client_facade::async_get(request const &request,
+                                    completion_callback_function_type on_complete,
+                                    headers_callback_function_type on_headers,
+                                    request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::async_get(...)");
+  when_ready(get(request, body_callback_function_type(), options), on_headers, on_complete);
+}
+
+void basic_client_facade::async_post(request request,
+                                     completion_callback_function_type on_complete,
+                                     headers_callback_function_type on_headers,
+                                     boost::optional<std::string> body,
+                                     boost::optional<std::string> content_type,
+                                     request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::async_post(...)");
+  when_ready(post(request, body, content_type, body_callback_function_type(), options),
+             on_headers, on_complete);
+}
+
+void basic_client_facade::async_put(request request,
+                                    completion_callback_function_type on_complete,
+                                    headers_callback_function_type on_headers,
+                                    boost::optional<std::string> body,
+                                    boost::optional<std::string> content_type,
+                                    request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::async_put(...)");
+  when_ready(put(request, body, content_type, body_callback_function_type(), options),
+             on_headers, on_complete);
+}
+
+void basic_client_facade::async_delete(request const &request,
+                                       completion_callback_function_type on_complete,
+                                       headers_callback_function_type on_headers,
+                                       request_options const &options) {
+  NETWORK_MESSAGE("basic_client_facade::async_delete(...)");
+  when_ready(delete_(request, body_callback_function_type(), options), on_headers, on_complete);
+}
+
 void basic_client_facade::clear_resolved_cache() {
   NETWORK_MESSAGE("basic_client_facade::clear_resolved_cache()");
   base->clear_resolved_cache();
@@ -7,19 +7,25 @@
 #ifndef NETWORK_PROTOCOL_HTTP_CLIENT_OPTIONS_HPP
 #define NETWORK_PROTOCOL_HTTP_CLIENT_OPTIONS_HPP
 
+#include <functional>
 #include <list>
 #include <string>
 #include <memory>
 #include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
 #include <network/protocol/http/client/connection/connection_factory.hpp>
 #include <network/protocol/http/client/connection_manager.hpp>
 #include <network/protocol/http/client/client_connection.hpp>
+#include <network/protocol/http/client/connection/resolver_cache.hpp>
 
-namespace network { namespace http {
+namespace network {
+namespace http {
 
   // Forward-declare the pimpl.
   class client_options_pimpl;
 
+  struct tls_context;
+
   // This file defines all the options supported by the HTTP client
   // implementation.
   class client_options {
@@ -55,6 +61,14 @@ namespace network { namespace http {
     client_options& io_service(boost::asio::io_service *io_service);
     boost::asio::io_service* io_service() const;
 
+    // The following sets how many threads run the client's I/O: response
+    // parsing, TLS and body callbacks (default 1). When the client owns its
+    // io_service it creates one per thread and spreads new connections
+    // across them, so each connection stays on one thread; an io_service
+    // provided above is instead run by that many threads.
+    client_options& io_threads(std::size_t threads=1);
+    std::size_t io_threads() const;
+
     // The following option determines whether the client should follow
     // HTTP redirects when the implementation encounters them. The default
     // behavior is to return false.
@@ -63,10 +77,17 @@ namespace network { namespace http {
 
     // The following options determines whether the client should cache
     // resolved endpoints. The default behavior is to not cache resolved
-    // endpoints.
+    // endpoints. Clients that cache resolved endpoints without a
+    // resolver_cache of their own (see below) share one for the process.
     client_options& cache_resolved(bool setting=true);
     bool cache_resolved() const;
 
+    // The following provides the resolver_cache the client resolves host
+    // names through, which may be shared with other clients. Providing one
+    // turns caching on regardless of cache_resolved.
+    client_options& resolver_cache(std::shared_ptr<http::resolver_cache> cache);
+    std::shared_ptr<http::resolver_cache> resolver_cache() const;
+
     // The following options provide the OpenSSL certificate paths to use.
     // Setting these options without OpenSSL support is valid, but the client
     // may throw an exception when attempting to make SSL connections. The
@@ -82,6 +103,15 @@ namespace network { namespace http {
     client_options& add_openssl_verify_path(std::string const &path);
     std::list<std::string> const & openssl_verify_paths() const;
 
+    // The following provides the tls_context HTTPS connections use: the SSL
+    // context built from the certificate paths above, and the cache of TLS
+    // sessions that lets connections resume earlier handshakes. When un-set,
+    // each connection factory builds one per set of certificate and verify
+    // paths the first time it is needed, and shares it between the
+    // connections whose options have those paths.
+    client_options& tls_context(std::shared_ptr<http::tls_context> context);
+    std::shared_ptr<http::tls_context> tls_context() const;
+
     // The following options provide the connection manager shared pointer that
     // is what the client will use to manage connections.
     client_options& connection_manager(std::shared_ptr<http::connection_manager> manager);
@@ -92,6 +122,34 @@ namespace network { namespace http {
     client_options& connection_factory(std::shared_ptr<http::connection_factory> factory);
     std::shared_ptr<http::connection_factory> connection_factory() const;
 
+    // The following options control the pooling_connection_manager: how many
+    // idle connections it keeps for each scheme, host and port (default 8),
+    // how long an idle connection may wait before it is closed (default
+    // 30,000 milliseconds), and whether an idle connection is checked for
+    // having been closed by the server before it is reused (default true).
+    client_options& max_idle_connections_per_host(std::size_t connections=8);
+    std::size_t max_idle_connections_per_host() const;
+    client_options& idle_connection_timeout(uint64_t milliseconds = 30 * 1000);
+    uint64_t idle_connection_timeout() const;
+    client_options& check_idle_connections(bool setting=true);
+    bool check_idle_connections() const;
+
+    // The following sets how many requests may be sent on one connection
+    // before their responses come back (HTTP/1.1 pipelining). The default of
+    // 1 turns pipelining off. With a higher depth the pooling_connection_manager
+    // also queues requests on busy connections to the same host instead of
+    // opening new ones, and a connection that the server closes in the middle
+    // of a pipeline sends the rest of its requests again one at a time.
+    client_options& pipeline_depth(std::size_t depth=1);
+    std::size_t pipeline_depth() const;
+
+    // The following sets how long a connection attempt to one of a host's
+    // addresses gets before an attempt to the next address starts alongside
+    // it (default 250 milliseconds, as RFC 8305 recommends). Addresses are
+    // tried alternating between IPv6 and IPv4, and the first to connect wins.
+    client_options& connection_attempt_delay(uint64_t milliseconds = 250);
+    uint64_t connection_attempt_delay() const;
+
     // More options go here...
 
   private:
@@ -124,16 +182,49 @@ namespace network { namespace http {
     // See client_options above for a usage example in the same vein.
 
     // These determine the timeout when performing requests. The default timeout
-    // is 30,000 milliseconds (30 seconds).
+    // is 30,000 milliseconds (30 seconds). While a request streams its body
+    // from a body_producer (see below), the timeout starts over each time a
+    // piece of the body has been written.
     request_options& timeout(uint64_t milliseconds = 30 * 1000);
     uint64_t timeout() const;
 
+    // These set separate deadlines, in milliseconds, for the phases of a
+    // request: resolving the host, connecting to it, the TLS handshake, and
+    // the wait between sending the request and the first byte of the
+    // response. A phase with a deadline of 0 (the default) is only bounded
+    // by the overall timeout above, which covers the whole transfer. A
+    // request that runs out of time fails with an
+    // errors::connection_timeout_exception.
+    request_options& resolve_timeout(uint64_t milliseconds = 0);
+    uint64_t resolve_timeout() const;
+    request_options& connect_timeout(uint64_t milliseconds = 0);
+    uint64_t connect_timeout() const;
+    request_options& handshake_timeout(uint64_t milliseconds = 0);
+    uint64_t handshake_timeout() const;
+    request_options& first_byte_timeout(uint64_t milliseconds = 0);
+    uint64_t first_byte_timeout() const;
+
     // These determine the maximum number of redirects to follow. The default
     // implementation uses 10 as the maximum. A negative value means to keep
     // following redirects until they no longer redirect.
     request_options& max_redirects(int redirects=10);
     int max_redirects() const;
 
+    // These stream the request body from a producer instead of sending the
+    // body stored in the request. The connection calls the producer each
+    // time it is ready to send more, with room for `size` bytes at `data`;
+    // it returns how many bytes it put there, and 0 once the body is done.
+    // With a length, the body goes out with that Content-Length and must be
+    // exactly that long; without one it goes out chunked. Only one piece of
+    // the body is held at a time, however long it is. A request whose body
+    // has started to stream is not sent again when its connection drops.
+    typedef std::function<std::size_t(char * data, std::size_t size)> body_producer_function_type;
+    request_options& body_producer(
+        body_producer_function_type producer = body_producer_function_type());
+    body_producer_function_type body_producer() const;
+    request_options& body_length(boost::optional<uint64_t> length = boost::none);
+    boost::optional<uint64_t> body_length() const;
+
     // More options go here...
 
   private:
@@ -23,6 +23,14 @@ namespace network { namespace http {
     , openssl_verify_paths_()
     , connection_manager_()
     , connection_factory_()
+    , resolver_cache_()
+    , tls_context_()
+    , io_threads_(1)
+    , max_idle_connections_per_host_(8)
+    , idle_connection_timeout_ms_(30 * 1000)
+    , check_idle_connections_(true)
+    , pipeline_depth_(1)
+    , connection_attempt_delay_ms_(250)
     {
     }
 
@@ -86,6 +94,70 @@ namespace network { namespace http {
       return connection_factory_;
     }
 
+    void resolver_cache(std::shared_ptr<http::resolver_cache> cache) {
+      resolver_cache_ = cache;
+    }
+
+    std::shared_ptr<http::resolver_cache> resolver_cache() const {
+      return resolver_cache_;
+    }
+
+    void tls_context(std::shared_ptr<http::tls_context> context) {
+      tls_context_ = context;
+    }
+
+    std::shared_ptr<http::tls_context> tls_context() const {
+      return tls_context_;
+    }
+
+    void io_threads(std::size_t threads) {
+      io_threads_ = threads ? threads : 1;
+    }
+
+    std::size_t io_threads() const {
+      return io_threads_;
+    }
+
+    void max_idle_connections_per_host(std::size_t connections) {
+      max_idle_connections_per_host_ = connections;
+    }
+
+    std::size_t max_idle_connections_per_host() const {
+      return max_idle_connections_per_host_;
+    }
+
+    void idle_connection_timeout(uint64_t milliseconds) {
+      idle_connection_timeout_ms_ = milliseconds;
+    }
+
+    uint64_t idle_connection_timeout() const {
+      return idle_connection_timeout_ms_;
+    }
+
+    void check_idle_connections(bool setting) {
+      check_idle_connections_ = setting;
+    }
+
+    bool check_idle_connections() const {
+      return check_idle_connections_;
+    }
+
+    void pipeline_depth(std::size_t depth) {
+      pipeline_depth_ = depth ? depth : 1;
+    }
+
+    std::size_t pipeline_depth() const {
+      return pipeline_depth_;
+    }
+
+    void connection_attempt_delay(uint64_t milliseconds) {
+      connection_attempt_delay_ms_ = milliseconds;
+    }
+
+    uint64_t connection_attempt_delay() const {
+      return connection_attempt_delay_ms_;
+    }
+
   private:
     client_options_pimpl(client_options_pimpl const &other)
     : io_service_(other.io_service_)
@@ -95,6 +167,14 @@ namespace network { namespace http {
     , openssl_verify_paths_(other.openssl_verify_paths_)
     , connection_manager_(other.connection_manager_)
     , connection_factory_(other.connection_factory_)
+    , resolver_cache_(other.resolver_cache_)
+    , tls_context_(other.tls_context_)
+    , io_threads_(other.io_threads_)
+    , max_idle_connections_per_host_(other.max_idle_connections_per_host_)
+    , idle_connection_timeout_ms_(other.idle_connection_timeout_ms_)
+    , check_idle_connections_(other.check_idle_connections_)
+    , pipeline_depth_(other.pipeline_depth_)
+    , connection_attempt_delay_ms_(other.connection_attempt_delay_ms_)
     {}
 
     client_options_pimpl& operator=(client_options_pimpl);  // cannot assign
@@ -105,6 +185,14 @@ namespace network { namespace http {
     std::list<std::string> openssl_certificate_paths_, openssl_verify_paths_;
     std::shared_ptr<http::connection_manager> connection_manager_;
     std::shared_ptr<http::connection_factory> connection_factory_;
+    std::shared_ptr<http::resolver_cache> resolver_cache_;
+    std::shared_ptr<http::tls_context> tls_context_;
+    std::size_t io_threads_;
+    std::size_t max_idle_connections_per_host_;
+    uint64_t idle_connection_timeout_ms_;
+    bool check_idle_connections_;
+    std::size_t pipeline_depth_;
+    uint64_t connection_attempt_delay_ms_;
   };
 
   client_options::client_options()
@@ -199,13 +287,91 @@ namespace network { namespace http {
     return pimpl->connection_factory();
   }
 
+  client_options& client_options::resolver_cache(std::shared_ptr<http::resolver_cache> cache) {
+    pimpl->resolver_cache(cache);
+    return *this;
+  }
+
+  std::shared_ptr<http::resolver_cache> client_options::resolver_cache() const {
+    return pimpl->resolver_cache();
+  }
+
+  client_options& client_options::tls_context(std::shared_ptr<http::tls_context> context) {
+    pimpl->tls_context(context);
+    return *this;
+  }
+
+  std::shared_ptr<http::tls_context> client_options::tls_context() const {
+    return pimpl->tls_context();
+  }
+
+  client_options& client_options::io_threads(std::size_t threads) {
+    pimpl->io_threads(threads);
+    return *this;
+  }
+
+  std::size_t client_options::io_threads() const {
+    return pimpl->io_threads();
+  }
+
+  client_options& client_options::max_idle_connections_per_host(std::size_t connections) {
+    pimpl->max_idle_connections_per_host(connections);
+    return *this;
+  }
+
+  std::size_t client_options::max_idle_connections_per_host() const {
+    return pimpl->max_idle_connections_per_host();
+  }
+
+  client_options& client_options::idle_connection_timeout(uint64_t milliseconds) {
+    pimpl->idle_connection_timeout(milliseconds);
+    return *this;
+  }
+
+  uint64_t client_options::idle_connection_timeout() const {
+    return pimpl->idle_connection_timeout();
+  }
+
+  client_options& client_options::check_idle_connections(bool setting) {
+    pimpl->check_idle_connections(setting);
+    return *this;
+  }
+
+  bool client_options::check_idle_connections() const {
+    return pimpl->check_idle_connections();
+  }
+
+  client_options& client_options::pipeline_depth(std::size_t depth) {
+    pimpl->pipeline_depth(depth);
+    return *this;
+  }
+
+  std::size_t client_options::pipeline_depth() const {
+    return pimpl->pipeline_depth();
+  }
+
+  client_options& client_options::connection_attempt_delay(uint64_t milliseconds) {
+    pimpl->connection_attempt_delay(milliseconds);
+    return *this;
+  }
+
+  uint64_t client_options::connection_attempt_delay() const {
+    return pimpl->connection_attempt_delay();
+  }
+
   // End of client_options.
 
   class request_options_pimpl {
   public:
     request_options_pimpl()
     : timeout_ms_(30 * 1000)
+    , resolve_timeout_ms_(0)
+    , connect_timeout_ms_(0)
+    , handshake_timeout_ms_(0)
+    , first_byte_timeout_ms_(0)
     , max_redirects_(10)
+    , body_producer_()
+    , body_length_()
     {}
 
     request_options_pimpl *clone() const {
@@ -220,6 +386,38 @@ namespace network { namespace http {
       return timeout_ms_;
     }
 
+    void resolve_timeout(uint64_t milliseconds) {
+      resolve_timeout_ms_ = milliseconds;
+    }
+
+    uint64_t resolve_timeout() const {
+      return resolve_timeout_ms_;
+    }
+
+    void connect_timeout(uint64_t milliseconds) {
+      connect_timeout_ms_ = milliseconds;
+    }
+
+    uint64_t connect_timeout() const {
+      return connect_timeout_ms_;
+    }
+
+    void handshake_timeout(uint64_t milliseconds) {
+      handshake_timeout_ms_ = milliseconds;
+    }
+
+    uint64_t handshake_timeout() const {
+      return handshake_timeout_ms_;
+    }
+
+    void first_byte_timeout(uint64_t milliseconds) {
+      first_byte_timeout_ms_ = milliseconds;
+    }
+
+    uint64_t first_byte_timeout() const {
+      return first_byte_timeout_ms_;
+    }
+
     void max_redirects(int redirects) {
       max_redirects_ = redirects;
     }
@@ -228,13 +426,39 @@ namespace network { namespace http {
       return max_redirects_;
     }
 
+    void body_producer(request_options::body_producer_function_type producer) {
+      body_producer_ = producer;
+    }
+
+    request_options::body_producer_function_type body_producer() const {
+      return body_producer_;
+    }
+
+    void body_length(boost::optional<uint64_t> length) {
+      body_length_ = length;
+    }
+
+    boost::optional<uint64_t> body_length() const {
+      return body_length_;
+    }
+
   private:
     uint64_t timeout_ms_;
+    uint64_t resolve_timeout_ms_, connect_timeout_ms_, handshake_timeout_ms_,
+        first_byte_timeout_ms_;
     int max_redirects_;
+    request_options::body_producer_function_type body_producer_;
+    boost::optional<uint64_t> body_length_;
 
     request_options_pimpl(request_options_pimpl const &other)
     : timeout_ms_(other.timeout_ms_)
+    , resolve_timeout_ms_(other.resolve_timeout_ms_)
+    , connect_timeout_ms_(other.connect_timeout_ms_)
+    , handshake_timeout_ms_(other.handshake_timeout_ms_)
+    , first_byte_timeout_ms_(other.first_byte_timeout_ms_)
     , max_redirects_(other.max_redirects_)
+    , body_producer_(other.body_producer_)
+    , body_length_(other.body_length_)
     {}
 
     request_options_pimpl& operator=(request_options_pimpl);  // cannot be assigned.
@@ -269,6 +493,42 @@ namespace network { namespace http {
   uint64_t request_options::timeout() const {
     return pimpl->timeout();
   }
+
+  request_options& request_options::resolve_timeout(uint64_t milliseconds) {
+    pimpl->resolve_timeout(milliseconds);
+    return *this;
+  }
+
+  uint64_t request_options::resolve_timeout() const {
+    return pimpl->resolve_timeout();
+  }
+
+  request_options& request_options::connect_timeout(uint64_t milliseconds) {
+    pimpl->connect_timeout(milliseconds);
+    return *this;
+  }
+
+  uint64_t request_options::connect_timeout() const {
+    return pimpl->connect_timeout();
+  }
+
+  request_options& request_options::handshake_timeout(uint64_t milliseconds) {
+    pimpl->handshake_timeout(milliseconds);
+    return *this;
+  }
+
+  uint64_t request_options::handshake_timeout() const {
+    return pimpl->handshake_timeout();
+  }
+
+  request_options& request_options::first_byte_timeout(uint64_t milliseconds) {
+    pimpl->first_byte_timeout(milliseconds);
+    return *this;
+  }
+
+  uint64_t request_options::first_byte_timeout() const {
+    return pimpl->first_byte_timeout();
+  }
   
   request_options& request_options::max_redirects(int redirects) {
     pimpl->max_redirects(redirects);
@@ -278,6 +538,24 @@ namespace network { namespace http {
   int request_options::max_redirects() const {
     return pimpl->max_redirects();
   }
+
+  request_options& request_options::body_producer(body_producer_function_type producer) {
+    pimpl->body_producer(producer);
+    return *this;
+  }
+
+  request_options::body_producer_function_type request_options::body_producer() const {
+    return pimpl->body_producer();
+  }
+
+  request_options& request_options::body_length(boost::optional<uint64_t> length) {
+    pimpl->body_length(length);
+    return *this;
+  }
+
+  boost::optional<uint64_t> request_options::body_length() const {
+    return pimpl->body_length();
+  }
   
 }  // namespace http
 }  // namespace network
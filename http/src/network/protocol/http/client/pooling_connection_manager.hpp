@@ -0,0 +1,159 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_POOLING_CONNECTION_MANAGER_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_POOLING_CONNECTION_MANAGER_HPP_20121018
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <network/protocol/http/client/connection_manager.hpp>
+#include <network/protocol/http/client/connection/connection_factory.hpp>
+
+namespace network {
+namespace http {
+
+/// Forward declaration of pooling_connection_manager_pimpl.
+struct pooling_connection_manager_pimpl;
+
+/// Forward declaration of the client_options class.
+class client_options;
+
+/** connection_pool_statistics
+ *
+ *  Counters kept by the pooling_connection_manager since it was created.
+ */
+struct connection_pool_statistics {
+  /// Connections created because no idle one was available.
+  std::size_t created;
+  /// Requests that went out on an idle connection.
+  std::size_t reused;
+  /// Requests queued behind others on a busy connection (pipelining).
+  std::size_t pipelined;
+  /// Connections waiting in the pool right now.
+  std::size_t idle;
+  /// Connections carrying requests that have not been released yet.
+  std::size_t in_use;
+  /// Idle connections closed after waiting longer than the idle timeout.
+  std::size_t expired;
+  /// Idle connections the server had closed, found by the health check.
+  std::size_t failed_checks;
+  /// Released connections closed because their host already had the
+  /// maximum number of idle connections.
+  std::size_t overflowed;
+  /// Connections whose last request left them unable to carry another.
+  std::size_t not_reusable;
+};
+
+/** pooling_connection_manager
+ *
+ *  This connection manager keeps connections open after their response has
+ *  been read and hands them out again for later requests to the same scheme,
+ *  host and port. The most recently released connection is reused first so
+ *  that the ones in use stay warm and the rest age out.
+ *
+ *  The limits come from the client_options it is constructed with:
+ *  max_idle_connections_per_host, idle_connection_timeout,
+ *  check_idle_connections and pipeline_depth. With a pipeline_depth above 1,
+ *  a request for a host with no idle connection is queued on a busy one
+ *  that has fewer requests outstanding than the depth before a new
+ *  connection is opened. To use it:
+ *
+ *    client_options options;
+ *    options.connection_manager(
+ *        std::make_shared<pooling_connection_manager>(options));
+ *    client client_(options);
+ */
+struct pooling_connection_manager : connection_manager {
+  /** Constructor
+   *
+   *  Args:
+   *    options: A properly construction client_options instance.
+   */
+  explicit pooling_connection_manager(client_options const &options);
+
+  /** get_connection
+   *
+   * Args:
+   *   asio::io_service & service: The io_service instance to which the
+   *                               connection should be bound to.
+   *   request_base const & request: The request object that includes the
+   *                                 information required by the connection.
+   *   client_options const & options: The options relating to the client
+   *                                   options.
+   *
+   * Returns:
+   *   shared_ptr<client_connection> -- an idle connection to the request's
+   *   destination if there is one that is still open, a busy one with room
+   *   in its pipeline, or a newly constructed connection otherwise.
+   */
+  virtual std::shared_ptr<client_connection> get_connection(
+      boost::asio::io_service & service,
+      request_base const & request,
+      client_options const & options) override;
+
+  /** get_connection
+   *
+   * Args:
+   *   std::vector<asio::io_service *> const & services: The io_services the
+   *                               caller runs; an idle or busy connection
+   *                               bound to any of them may be handed out.
+   *   function<asio::io_service &()> const & pick: Called only when a new
+   *                               connection is needed, for the io_service
+   *                               it should be bound to.
+   *   request_base const & request: The request object that includes the
+   *                                 information required by the connection.
+   *   client_options const & options: The options relating to the client
+   *                                   options.
+   *
+   * Returns:
+   *   shared_ptr<client_connection> -- as above.
+   */
+  virtual std::shared_ptr<client_connection> get_connection(
+      std::vector<boost::asio::io_service *> const & services,
+      std::function<boost::asio::io_service &()> const & pick,
+      request_base const & request,
+      client_options const & options) override;
+
+  /** reset
+   *
+   * Closes all the idle connections. Connections that are in use are closed
+   * when they are released.
+   */
+  virtual void reset() override;
+
+  /** clear_resolved_cache
+   *
+   * Forgets the names cached by the resolver_cache the options use.
+   */
+  virtual void clear_resolved_cache() override;
+
+  /** statistics
+   *
+   * Returns a snapshot of the pool's counters.
+   */
+  connection_pool_statistics statistics() const;
+
+  /** Destructor.
+   */
+  virtual ~pooling_connection_manager() override;
+
+ protected:
+  // Shared with the connections that are in use, which hand themselves back
+  // to the pool for as long as it is alive.
+  std::shared_ptr<pooling_connection_manager_pimpl> pimpl;
+
+ private:
+  /// Disabled copy constructor.
+  pooling_connection_manager(pooling_connection_manager const &); // = delete
+  /// Disabled assignment operator.
+  pooling_connection_manager & operator=(pooling_connection_manager); // = delete
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_POOLING_CONNECTION_MANAGER_HPP_20121018 */
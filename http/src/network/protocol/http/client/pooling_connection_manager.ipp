@@ -0,0 +1,334 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_CLIENT_POOLING_CONNECTION_MANAGER_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_CLIENT_POOLING_CONNECTION_MANAGER_IPP_20121018
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <network/protocol/http/client/pooling_connection_manager.hpp>
+#include <network/protocol/http/client/connection/simple_connection_factory.hpp>
+#include <network/protocol/http/client/client_connection.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/protocol/http/message/wrappers/uri.hpp>
+#include <network/protocol/http/message/wrappers/host.hpp>
+#include <network/protocol/http/message/wrappers/port.hpp>
+#include <network/detail/debug.hpp>
+
+namespace network { namespace http {
+
+struct pooling_connection_manager_pimpl
+    : std::enable_shared_from_this<pooling_connection_manager_pimpl> {
+  typedef std::chrono::steady_clock clock;
+  // Connections are kept by scheme, host and port. Each is bound to the
+  // io_service it was created on, and is only handed to callers that run it.
+  typedef std::tuple<std::string, std::string, boost::uint16_t> key_type;
+  typedef std::vector<boost::asio::io_service *> service_list;
+
+  struct idle_connection {
+    std::shared_ptr<client_connection> connection;
+    boost::asio::io_service *service;
+    clock::time_point released;
+  };
+
+  // Oldest first: connections are reused from the back and expire from the
+  // front.
+  typedef std::vector<idle_connection> idle_list;
+  typedef std::map<key_type, idle_list> pool_type;
+  typedef std::vector<std::shared_ptr<client_connection> > closed_list;
+
+  // Connections carrying requests, with the number of requests that have
+  // not been released yet.
+  struct busy_connection {
+    std::shared_ptr<client_connection> connection;
+    boost::asio::io_service *service;
+    std::size_t outstanding;
+  };
+  typedef std::vector<busy_connection> busy_list;
+  typedef std::map<key_type, busy_list> busy_map;
+
+  pooling_connection_manager_pimpl(client_options const &options)
+  : options_(options)
+  , connection_factory_(options.connection_factory())
+  , idle_timeout_(std::chrono::milliseconds(options.idle_connection_timeout()))
+  , last_sweep_(clock::now())
+  , statistics_()
+  {
+    NETWORK_MESSAGE(
+        "pooling_connection_manager_pimpl::pooling_connection_manager_pimpl("
+        "client_options const &)");
+    if (!connection_factory_.get()) {
+      NETWORK_MESSAGE("creating simple connection factory");
+      connection_factory_.reset(
+          new (std::nothrow) simple_connection_factory());
+    }
+  }
+
+  std::shared_ptr<client_connection> get_connection(
+      service_list const & services,
+      std::function<boost::asio::io_service &()> const & pick,
+      request_base const & request,
+      client_options const &options) {
+    NETWORK_MESSAGE("pooling_connection_manager_pimpl::get_connection(...)");
+    key_type key = make_key(request);
+    boost::asio::io_service *service = 0;
+    // Connections that are dropped from the pool are closed after the lock
+    // is released.
+    closed_list closed;
+    std::shared_ptr<client_connection> connection;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      clock::time_point now = clock::now();
+      sweep(now, closed);
+      pool_type::iterator entry = idle_.find(key);
+      if (entry != idle_.end()) {
+        idle_list &idle = entry->second;
+        idle_list::iterator it = idle.end();
+        while (it != idle.begin() && !connection) {
+          --it;
+          if (!runs(services, it->service)) continue;
+          idle_connection candidate = *it;
+          it = idle.erase(it);
+          --statistics_.idle;
+          if (now - candidate.released >= idle_timeout_) {
+            ++statistics_.expired;
+            closed.push_back(candidate.connection);
+          } else if (options_.check_idle_connections() && !candidate.connection->is_open()) {
+            ++statistics_.failed_checks;
+            closed.push_back(candidate.connection);
+          } else {
+            connection = candidate.connection;
+            service = candidate.service;
+          }
+        }
+        if (idle.empty()) idle_.erase(entry);
+      }
+      if (connection) {
+        NETWORK_MESSAGE("reusing idle connection");
+        ++statistics_.reused;
+        checkout(key, service, connection);
+        return connection;
+      }
+      // With pipelining on, the request queues up on the least busy
+      // connection that still has room in its pipeline.
+      busy_connection *least_busy = 0;
+      busy_map::iterator busy = busy_.find(key);
+      if (busy != busy_.end()) {
+        std::size_t const depth = options_.pipeline_depth();
+        for (busy_list::iterator it = busy->second.begin(); it != busy->second.end(); ++it) {
+          if (it->outstanding < depth && runs(services, it->service) &&
+              (!least_busy || it->outstanding < least_busy->outstanding))
+            least_busy = &*it;
+        }
+      }
+      if (least_busy) {
+        NETWORK_MESSAGE("pipelining on a busy connection");
+        ++least_busy->outstanding;
+        ++statistics_.pipelined;
+        return least_busy->connection;
+      }
+    }
+    NETWORK_MESSAGE("creating connection");
+    service = &pick();
+    connection = connection_factory_->create_connection(*service, request, options_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++statistics_.created;
+    checkout(key, service, connection);
+    return connection;
+  }
+
+  void reset() {
+    closed_list closed;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (pool_type::iterator entry = idle_.begin(); entry != idle_.end(); ++entry) {
+      for (idle_list::iterator it = entry->second.begin(); it != entry->second.end(); ++it)
+        closed.push_back(it->connection);
+    }
+    idle_.clear();
+    statistics_.idle = 0;
+  }
+
+  void clear_resolved_cache() {
+    std::shared_ptr<resolver_cache> cache = resolver_cache::for_options(options_);
+    if (cache) cache->clear();
+  }
+
+  connection_pool_statistics statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+  }
+
+  ~pooling_connection_manager_pimpl() {
+    NETWORK_MESSAGE("pooling_connection_manager_pimpl::~pooling_connection_manager_pimpl()");
+  }
+
+ private:
+  key_type make_key(request_base const & request) {
+    ::network::uri uri_ = http::uri(request);
+    std::string scheme = boost::algorithm::to_lower_copy(std::string(*uri_.scheme()));
+    std::string host_ = boost::algorithm::to_lower_copy(std::string(host(request)));
+    boost::uint16_t port_ = port(request);
+    return key_type(scheme, host_, port_);
+  }
+
+  static bool runs(service_list const &services, boost::asio::io_service *service) {
+    return std::find(services.begin(), services.end(), service) != services.end();
+  }
+
+  // Called with the lock held. The pool holds on to the connection while it
+  // carries requests, and the connection reaches the pool for as long as
+  // both are alive.
+  void checkout(key_type const &key,
+                boost::asio::io_service *service,
+                std::shared_ptr<client_connection> connection) {
+    busy_connection entry = { connection, service, 1 };
+    busy_[key].push_back(entry);
+    ++statistics_.in_use;
+    std::weak_ptr<pooling_connection_manager_pimpl> pool(shared_from_this());
+    std::weak_ptr<client_connection> weak_connection(connection);
+    connection->set_release_callback(
+        [pool, key, service, weak_connection](bool reusable) {
+          std::shared_ptr<pooling_connection_manager_pimpl> self = pool.lock();
+          std::shared_ptr<client_connection> connection = weak_connection.lock();
+          if (self && connection) self->release(key, service, connection, reusable);
+        });
+  }
+
+  // Runs once for every request that went out on the connection. Once the
+  // last of them is done, the connection goes back to the idle pool if the
+  // last response left it reusable.
+  void release(key_type const &key,
+               boost::asio::io_service *service,
+               std::shared_ptr<client_connection> const &connection,
+               bool reusable) {
+    NETWORK_MESSAGE("pooling_connection_manager_pimpl::release(" << reusable << ")");
+    closed_list closed;
+    std::lock_guard<std::mutex> lock(mutex_);
+    busy_map::iterator busy = busy_.find(key);
+    if (busy == busy_.end()) return;
+    busy_list &list = busy->second;
+    busy_list::iterator it = list.begin();
+    while (it != list.end() && it->connection != connection) ++it;
+    if (it == list.end()) return;
+    if (--it->outstanding) return;
+    list.erase(it);
+    if (list.empty()) busy_.erase(busy);
+    --statistics_.in_use;
+    if (!reusable) {
+      ++statistics_.not_reusable;
+      return;
+    }
+    clock::time_point now = clock::now();
+    sweep(now, closed);
+    std::size_t const max_idle = options_.max_idle_connections_per_host();
+    if (max_idle == 0) {
+      ++statistics_.overflowed;
+      closed.push_back(connection);
+      return;
+    }
+    idle_list &idle = idle_[key];
+    if (idle.size() >= max_idle) {
+      ++statistics_.overflowed;
+      --statistics_.idle;
+      closed.push_back(idle.front().connection);
+      idle.erase(idle.begin());
+    }
+    idle_connection entry = { connection, service, now };
+    idle.push_back(entry);
+    ++statistics_.idle;
+  }
+
+  // Drops the expired connections of every host, at most once per idle
+  // timeout; in between, expired connections are only found when their
+  // host is asked for one.
+  void sweep(clock::time_point now, closed_list &closed) {
+    if (now - last_sweep_ < idle_timeout_) return;
+    last_sweep_ = now;
+    pool_type::iterator entry = idle_.begin();
+    while (entry != idle_.end()) {
+      idle_list &idle = entry->second;
+      idle_list::iterator fresh = idle.begin();
+      while (fresh != idle.end() && now - fresh->released >= idle_timeout_) {
+        closed.push_back(fresh->connection);
+        ++fresh;
+      }
+      std::size_t const expired = fresh - idle.begin();
+      statistics_.expired += expired;
+      statistics_.idle -= expired;
+      idle.erase(idle.begin(), fresh);
+      if (idle.empty())
+        idle_.erase(entry++);
+      else
+        ++entry;
+    }
+  }
+
+  client_options const options_;
+  std::shared_ptr<connection_factory> connection_factory_;
+  clock::duration idle_timeout_;
+  mutable std::mutex mutex_;
+  pool_type idle_;
+  busy_map busy_;
+  clock::time_point last_sweep_;
+  connection_pool_statistics statistics_;
+};
+
+pooling_connection_manager::pooling_connection_manager(client_options const &options)
+: pimpl(new (std::nothrow) pooling_connection_manager_pimpl(options))
+{
+  NETWORK_MESSAGE("pooling_connection_manager::pooling_connection_manager("
+                  "client_options const &)");
+}
+
+std::shared_ptr<client_connection> pooling_connection_manager::get_connection(
+    boost::asio::io_service & service,
+    request_base const & request,
+    client_options const &options) {
+  NETWORK_MESSAGE("pooling_connection_manager::get_connection(...)");
+  pooling_connection_manager_pimpl::service_list services(1, &service);
+  return pimpl->get_connection(
+      services, [&service]() -> boost::asio::io_service & { return service; },
+      request, options);
+}
+
+std::shared_ptr<client_connection> pooling_connection_manager::get_connection(
+    std::vector<boost::asio::io_service *> const & services,
+    std::function<boost::asio::io_service &()> const & pick,
+    request_base const & request,
+    client_options const &options) {
+  NETWORK_MESSAGE("pooling_connection_manager::get_connection(services, ...)");
+  return pimpl->get_connection(services, pick, request, options);
+}
+
+void pooling_connection_manager::reset() {
+  NETWORK_MESSAGE("pooling_connection_manager::reset()");
+  pimpl->reset();
+}
+
+void pooling_connection_manager::clear_resolved_cache() {
+  NETWORK_MESSAGE("pooling_connection_manager::clear_resolved_cache()");
+  pimpl->clear_resolved_cache();
+}
+
+connection_pool_statistics pooling_connection_manager::statistics() const {
+  return pimpl->statistics();
+}
+
+pooling_connection_manager::~pooling_connection_manager() {
+  NETWORK_MESSAGE("pooling_connection_manager::~pooling_connection_manager()");
+  pimpl->reset();
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_CLIENT_POOLING_CONNECTION_MANAGER_IPP_20121018 */
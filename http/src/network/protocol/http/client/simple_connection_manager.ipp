@@ -41,7 +41,8 @@ struct simple_connection_manager_pimpl {
   }
 
   void clear_resolved_cache() {
-    // TODO(deanberris): Make this happen!
+    std::shared_ptr<resolver_cache> cache = resolver_cache::for_options(options_);
+    if (cache) cache->clear();
   }
 
   ~simple_connection_manager_pimpl() {
@@ -7,14 +7,20 @@
 #ifndef NETWORK_PROTOCOL_HTTP_ERRORS_20080516_HPP
 #define NETWORK_PROTOCOL_HTTP_ERRORS_20080516_HPP
 
-#include <exception>
+#include <stdexcept>
+#include <string>
 
 namespace network {
 namespace http {
 namespace errors {
 
+// Reported through the response when a request runs out of time; the
+// message says which phase it was in.
 struct connection_timeout_exception : std::runtime_error
-{};
+{
+  explicit connection_timeout_exception(std::string const & what)
+  : std::runtime_error(what) {}
+};
 
 typedef connection_timeout_exception connection_timeout;
 
@@ -10,33 +10,12 @@ namespace network {
 namespace http {
 namespace impl {
 
-void setter_access::set_version_promise(response &r, std::promise<std::string> &p) {
-  return r.set_version_promise(p);
+void setter_access::set_response_state(response &r, std::shared_ptr<response_state> state) {
+  return r.set_state(state);
 }
 
-void setter_access::set_status_promise(response &r, std::promise<boost::uint16_t> &p) {
-  return r.set_status_promise(p);
-}
-
-void setter_access::set_status_message_promise(response &r, std::promise<std::string> &p) {
-  return r.set_status_message_promise(p);
-}
-
-void
-setter_access::set_headers_promise(response &r, std::promise<std::multimap<std::string, std::string> > &p) {
-  return r.set_headers_promise(p);
-}
-
-void setter_access::set_source_promise(response &r, std::promise<std::string> &p) {
-  return r.set_source_promise(p);
-}
-
-void setter_access::set_destination_promise(response &r, std::promise<std::string> &p) {
-  return r.set_destination_promise(p);
-}
-
-void setter_access::set_body_promise(response &r, std::promise<std::string> &p) {
-  return r.set_body_promise(p);
+std::shared_ptr<response_state> setter_access::get_response_state(response const &r) {
+  return r.get_state();
 }
 
 }  // namespace impl
@@ -0,0 +1,167 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_PARSER_CHUNKED_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_PARSER_CHUNKED_HPP_20121018
+
+#include <boost/range/iterator_range.hpp>
+#include <boost/fusion/tuple.hpp>
+#include <boost/logic/tribool.hpp>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#ifndef NETWORK_HTTP_CHUNKED_TRAILERS_MAX_SIZE
+#define NETWORK_HTTP_CHUNKED_TRAILERS_MAX_SIZE 8192
+#endif
+
+namespace network { namespace http {
+
+// Incremental decoder for bodies sent with "Transfer-Encoding: chunked".
+//
+// parse() consumes the chunk framing in [begin, end) up to the next run of
+// body data and returns that run as a sub-range of the input, so decoding
+// never copies the body. It returns:
+//
+//   - indeterminate, with the position to resume from and a (possibly
+//     empty) run of body data, while the body is not complete;
+//   - true, with the position just past the body, once the terminating
+//     zero-length chunk and any trailers have been consumed;
+//   - false on malformed input.
+//
+// Chunk extensions are skipped. Trailer lines are kept verbatim (including
+// their CRLFs) and are available through trailers() once parsing is done.
+struct chunked_parser {
+
+  enum state_t {
+      chunk_size_start,
+      chunk_size,
+      chunk_extension,
+      chunk_size_lf,
+      chunk_data,
+      chunk_data_cr,
+      chunk_data_lf,
+      trailer_line_start,
+      trailer_line,
+      trailer_line_lf,
+      trailers_lf,
+      chunked_done
+  };
+
+  chunked_parser()
+    : state_(chunk_size_start), chunk_remaining_(0), trailers_() {}
+
+  void reset() {
+    state_ = chunk_size_start;
+    chunk_remaining_ = 0;
+    trailers_.clear();
+  }
+
+  state_t state() const { return state_; }
+
+  std::string const & trailers() const { return trailers_; }
+
+  template <class Iterator>
+  boost::fusion::tuple<boost::logic::tribool, Iterator, boost::iterator_range<Iterator> >
+  parse(Iterator begin, Iterator end) {
+    typedef boost::fusion::tuple<boost::logic::tribool, Iterator, boost::iterator_range<Iterator> > result_type;
+    Iterator current = begin;
+    while (current != end) {
+      char c = *current;
+      switch (state_) {
+        case chunk_size_start:
+          if (hex_value(c) < 0) return result_type(false, current, boost::make_iterator_range(current, current));
+          chunk_remaining_ = hex_value(c);
+          state_ = chunk_size;
+          break;
+        case chunk_size:
+          if (hex_value(c) >= 0) {
+            if (chunk_remaining_ > (std::numeric_limits<std::size_t>::max() >> 4))
+              return result_type(false, current, boost::make_iterator_range(current, current));
+            chunk_remaining_ = (chunk_remaining_ << 4) | hex_value(c);
+          } else if (c == ';' || c == ' ' || c == '\t') {
+            state_ = chunk_extension;
+          } else if (c == '\r') {
+            state_ = chunk_size_lf;
+          } else {
+            return result_type(false, current, boost::make_iterator_range(current, current));
+          }
+          break;
+        case chunk_extension:
+          if (c == '\r') state_ = chunk_size_lf;
+          else if (c == '\n') return result_type(false, current, boost::make_iterator_range(current, current));
+          break;
+        case chunk_size_lf:
+          if (c != '\n') return result_type(false, current, boost::make_iterator_range(current, current));
+          state_ = (chunk_remaining_ == 0) ? trailer_line_start : chunk_data;
+          break;
+        case chunk_data: {
+          std::size_t available = std::distance(current, end);
+          std::size_t length = available < chunk_remaining_ ? available : chunk_remaining_;
+          Iterator data_end = current;
+          std::advance(data_end, length);
+          chunk_remaining_ -= length;
+          if (chunk_remaining_ == 0) state_ = chunk_data_cr;
+          return result_type(boost::logic::indeterminate, data_end, boost::make_iterator_range(current, data_end));
+        }
+        case chunk_data_cr:
+          if (c != '\r') return result_type(false, current, boost::make_iterator_range(current, current));
+          state_ = chunk_data_lf;
+          break;
+        case chunk_data_lf:
+          if (c != '\n') return result_type(false, current, boost::make_iterator_range(current, current));
+          state_ = chunk_size_start;
+          break;
+        case trailer_line_start:
+          if (c == '\r') {
+            state_ = trailers_lf;
+            break;
+          }
+          state_ = trailer_line;
+          // fall-through
+        case trailer_line:
+          if (trailers_.size() >= NETWORK_HTTP_CHUNKED_TRAILERS_MAX_SIZE)
+            return result_type(false, current, boost::make_iterator_range(current, current));
+          trailers_.push_back(c);
+          if (c == '\r') state_ = trailer_line_lf;
+          break;
+        case trailer_line_lf:
+          if (c != '\n') return result_type(false, current, boost::make_iterator_range(current, current));
+          trailers_.push_back(c);
+          state_ = trailer_line_start;
+          break;
+        case trailers_lf:
+          if (c != '\n') return result_type(false, current, boost::make_iterator_range(current, current));
+          state_ = chunked_done;
+          ++current;
+          return result_type(true, current, boost::make_iterator_range(current, current));
+        case chunked_done:
+          return result_type(true, current, boost::make_iterator_range(current, current));
+      }
+      ++current;
+    }
+    return result_type(state_ == chunked_done ? boost::logic::tribool(true) : boost::logic::indeterminate,
+                       current, boost::make_iterator_range(current, current));
+  }
+
+ private:
+  static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  state_t state_;
+  std::size_t chunk_remaining_;
+  std::string trailers_;
+};
+
+}  // namespace http
+
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_PARSER_CHUNKED_HPP_20121018
@@ -11,8 +11,11 @@
 #include <boost/range.hpp>
 #include <boost/fusion/tuple.hpp>
 #include <boost/logic/tribool.hpp>
-#include <boost/algorithm/string/classification.hpp>
+#include <boost/cstdint.hpp>
+#include <iterator>
 #include <utility>
+#include <vector>
+#include <network/protocol/http/server/impl/request_scan.hpp>
 
 namespace network { namespace http {
 
@@ -43,16 +46,43 @@ struct response_parser {
       http_headers_done
   };
 
+  // The location of one header line within the header block, which starts
+  // right after the status line's CRLF. Offsets count bytes from the start of
+  // that block, across all the calls to parse_until that it took to get
+  // through it. Names end at their colon and values at their CR, so either
+  // may carry trailing whitespace.
+  struct header_span {
+    std::size_t name_begin, name_end, value_begin, value_end;
+  };
+
   explicit response_parser (state_t state=http_response_begin)
-    : state_(state) {}
+    : state_(state)
+    , offset_(0)
+    , headers_begin_(0)
+    , status_(0)
+    , version_major_(0)
+    , version_minor_(0)
+    , header_spans_() {}
 
   response_parser (response_parser const & other)
-    : state_(other.state_) {}
+    : state_(other.state_)
+    , offset_(other.offset_)
+    , headers_begin_(other.headers_begin_)
+    , status_(other.status_)
+    , version_major_(other.version_major_)
+    , version_minor_(other.version_minor_)
+    , header_spans_(other.header_spans_) {}
 
   ~response_parser () {}
 
   void swap(response_parser & other) {
     std::swap(other.state_, this->state_);
+    std::swap(other.offset_, this->offset_);
+    std::swap(other.headers_begin_, this->headers_begin_);
+    std::swap(other.status_, this->status_);
+    std::swap(other.version_major_, this->version_major_);
+    std::swap(other.version_minor_, this->version_minor_);
+    other.header_spans_.swap(this->header_spans_);
   }
 
   response_parser & operator=(response_parser rhs) {
@@ -63,17 +93,28 @@ struct response_parser {
   template <class Range>
   boost::fusion::tuple<boost::logic::tribool,boost::iterator_range<typename Range::const_iterator> > parse_until(state_t stop_state, Range & range_) {
     boost::logic::tribool parsed_ok(boost::logic::indeterminate);
-    typename Range::const_iterator start = boost::begin(range_),
+    typename Range::const_iterator first = boost::begin(range_),
+      start = first,
       current = start,
       end = boost::end(range_);
     boost::iterator_range<typename Range::const_iterator>
       local_range = boost::make_iterator_range(start, end);
+    std::size_t const base = offset_;
     if (boost::empty(local_range)) parsed_ok = false;
     while (!boost::empty(local_range) && indeterminate(parsed_ok)) {
       current = boost::begin(local_range);
       if (state_ == stop_state) {
         parsed_ok = true;
       } else {
+      // Header names and values do not change the state until they end, so
+      // runs of them are skipped in bulk.
+      if (state_ == http_header_name_char || state_ == http_header_value_char) {
+        current = impl::scan_run(state_ == http_header_name_char
+                                 ? impl::scan_header_name
+                                 : impl::scan_header_value,
+                                 current, end);
+        if (current == end) break;
+      }
       switch(state_) {
         case http_response_begin:
           if (*current == ' ' || *current == '\r' || *current == '\n') {
@@ -121,7 +162,8 @@ struct response_parser {
           }
           break;
         case http_version_slash:
-          if (boost::algorithm::is_digit()(*current)) {
+          if (impl::is_digit(*current)) {
+            version_major_ = *current - '0';
             state_ = http_version_major;
             ++current;
           } else {
@@ -137,7 +179,8 @@ struct response_parser {
           }
           break;
         case http_version_dot:
-          if (boost::algorithm::is_digit()(*current)) {
+          if (impl::is_digit(*current)) {
+            version_minor_ = *current - '0';
             state_ = http_version_minor;
             ++current;
           } else {
@@ -153,7 +196,8 @@ struct response_parser {
           }
           break;
         case http_version_done:
-          if (boost::algorithm::is_digit()(*current)) {
+          if (impl::is_digit(*current)) {
+            status_ = *current - '0';
             state_ = http_status_digit;
             ++current;
           } else {
@@ -161,7 +205,8 @@ struct response_parser {
           }
           break;
         case http_status_digit:
-          if (boost::algorithm::is_digit()(*current)) {
+          if (impl::is_digit(*current) && status_ < 100) {
+            status_ = status_ * 10 + (*current - '0');
             ++current;
           } else if (*current == ' ') {
             state_ = http_status_done;
@@ -171,7 +216,7 @@ struct response_parser {
           }
           break;
         case http_status_done:
-          if (boost::algorithm::is_alnum()(*current)) {
+          if (impl::is_alnum(*current)) {
             state_ = http_status_message_char;
             ++current;
           } else {
@@ -179,7 +224,7 @@ struct response_parser {
           }
           break;
         case http_status_message_char:
-          if (boost::algorithm::is_alnum()(*current) || boost::algorithm::is_punct()(*current) || (*current == ' ')) {
+          if (impl::is_graph(*current) || (*current == ' ')) {
             ++current;
           } else if (*current == '\r') {
             state_ = http_status_message_cr;
@@ -192,13 +237,15 @@ struct response_parser {
           if (*current == '\n') {
             state_ = http_status_message_done;
             ++current;
+            headers_begin_ = base + std::distance(first, current);
           } else {
             parsed_ok = false;
           }
           break;
         case http_status_message_done:
         case http_header_line_done:
-          if (boost::algorithm::is_alnum()(*current)) {
+          if (impl::is_alnum(*current)) {
+            begin_header(base + std::distance(first, current));
             state_ = http_header_name_char;
             ++current;
           } else if (*current == '\r') {
@@ -210,18 +257,22 @@ struct response_parser {
           break;
         case http_header_name_char:
           if (*current == ':') {
+            header_spans_.back().name_end =
+              base + std::distance(first, current) - headers_begin_;
             state_ = http_header_colon;
             ++current;
-          } else if (boost::algorithm::is_alnum()(*current) || boost::algorithm::is_space()(*current) || boost::algorithm::is_punct()(*current)) {
+          } else if (impl::is_graph(*current) || impl::is_space(*current)) {
             ++current;
           } else {
             parsed_ok = false;
           }
           break;
         case http_header_colon:
-          if (boost::algorithm::is_space()(*current)) {
+          if (impl::is_space(*current)) {
             ++current;
-          } else if (boost::algorithm::is_alnum()(*current) || boost::algorithm::is_punct()(*current)) {
+          } else if (impl::is_graph(*current)) {
+            header_spans_.back().value_begin =
+              base + std::distance(first, current) - headers_begin_;
             state_ = http_header_value_char;
             ++current;
           } else {
@@ -230,9 +281,11 @@ struct response_parser {
           break;
         case http_header_value_char:
           if (*current == '\r') {
+            header_spans_.back().value_end =
+              base + std::distance(first, current) - headers_begin_;
             state_ = http_header_line_cr;
             ++current;
-          } else if (boost::algorithm::is_cntrl()(*current)) {
+          } else if (impl::is_cntrl(*current)) {
             parsed_ok = false;
           } else {
             ++current;
@@ -262,6 +315,7 @@ struct response_parser {
       local_range = boost::make_iterator_range(current, end);
     }
     if (state_ == stop_state) parsed_ok = true;
+    offset_ = base + std::distance(first, current);
     return boost::fusion::make_tuple(parsed_ok,boost::make_iterator_range(start, current));
   }
 
@@ -271,10 +325,36 @@ struct response_parser {
 
   void reset(state_t new_state = http_response_begin) {
     state_ = new_state;
+    offset_ = headers_begin_ = 0;
+    status_ = 0;
+    version_major_ = version_minor_ = 0;
+    // Keeps the capacity, so a connection stops allocating here once it has
+    // seen its largest response.
+    header_spans_.clear();
   }
 
+  // The HTTP version, once the parser is past http_version_dot.
+  unsigned short version_major() const { return version_major_; }
+  unsigned short version_minor() const { return version_minor_; }
+
+  // The status code, once the parser is past http_status_digit.
+  boost::uint16_t status() const { return status_; }
+
+  // The headers found so far. A span is complete once the parser has moved
+  // past its http_header_line_cr.
+  std::vector<header_span> const & header_spans() const { return header_spans_; }
+
  private:
+  void begin_header(std::size_t position) {
+    header_span span = { position - headers_begin_, 0, 0, 0 };
+    header_spans_.push_back(span);
+  }
+
   state_t state_;
+  std::size_t offset_, headers_begin_;
+  boost::uint16_t status_;
+  unsigned short version_major_, version_minor_;
+  std::vector<header_span> header_spans_;
 
 };
 
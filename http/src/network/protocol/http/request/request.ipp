@@ -9,6 +9,7 @@
 
 #include <network/protocol/http/request/request.hpp>
 #include <network/protocol/http/request/request_concept.hpp>
+#include <network/message/header_storage.hpp>
 #include <boost/scoped_array.hpp>
 
 #ifdef NETWORK_DEBUG
@@ -63,34 +64,31 @@ struct request_pimpl {
   }
 
   void append_header(std::string const & name, std::string const & value) {
-    headers_.insert(std::make_pair(name, value));
+    headers_.append(name, value);
+  }
+
+  void remove_headers(std::string const & name) {
+    headers_.remove(name);
+  }
+
+  void remove_headers() {
+    headers_.clear();
   }
 
   void get_headers(std::function<bool(std::string const &, std::string const &)> predicate,
                    std::function<void(std::string const &, std::string const &)> inserter) const {
-    headers_type::const_iterator it = headers_.begin();
-    for (; it != headers_.end(); ++it) {
-      if (predicate(it->first, it->second)) {
-        inserter(it->first, it->second);
-      }
-    }
+    headers_.for_each([&](std::string const &name, std::string const &value) {
+      if (predicate(name, value)) inserter(name, value);
+    });
   }
 
   void get_headers(std::function<void(std::string const &, std::string const &)> inserter) const {
-    headers_type::const_iterator it = headers_.begin();
-    for (; it != headers_.end(); ++it) {
-      inserter(it->first, it->second);
-    }
+    headers_.for_each(inserter);
   }
 
   void get_headers(std::string const &name,
                    std::function<void(std::string const &, std::string const &)> inserter) const {
-    headers_type::const_iterator it = headers_.begin();
-    for (; it != headers_.end(); ++it) {
-      if (it->first == name) {
-        inserter(it->first, it->second);
-      }
-    }
+    headers_.for_each(name, inserter);
   }
 
   void set_source(std::string const &source) {
@@ -122,7 +120,7 @@ struct request_pimpl {
            read_offset_ == other.read_offset_ &&
            source_ == other.source_ &&
            destination_ == other.destination_ &&
-           headers_ == other.headers_;
+           headers_.equals(other.headers_);
   }
 
   void set_version_major(unsigned short major_version) {
@@ -142,12 +140,10 @@ struct request_pimpl {
   }
 
  private:
-  typedef std::multimap<std::string, std::string> headers_type;
-
   ::network::uri uri_;
   size_t read_offset_;
   std::string source_, destination_;
-  headers_type headers_;
+  header_storage headers_;
   unsigned short version_major_, version_minor_;
 
   request_pimpl(request_pimpl const &other)
@@ -200,9 +196,11 @@ void request::append_header(std::string const & name,
 }
 
 void request::remove_headers(std::string const & name) {
+  pimpl_->remove_headers(name);
 }
 
 void request::remove_headers() {
+  pimpl_->remove_headers();
 }
 
 void request::set_body(std::string const & body) {
@@ -0,0 +1,63 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_RESPONSE_HEADER_BLOCK_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_RESPONSE_HEADER_BLOCK_HPP_20121018
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/range/iterator_range.hpp>
+#include <network/protocol/http/parser/incremental.hpp>
+
+namespace network { namespace http {
+
+// The header lines of a response as they came off the wire, along with where
+// each name and value sits in them. Nothing is copied out until someone asks
+// for it, so the client can look at a couple of headers (Content-Length,
+// Transfer-Encoding) without building a map of all of them; the map behind
+// headers(response) is only built when a user calls it.
+class header_block {
+ public:
+  typedef boost::iterator_range<char const *> string_range;
+  typedef response_parser::header_span span;
+
+  header_block();
+
+  // Takes over `data`, which holds the header lines starting with the first
+  // header's name, and the spans the parser recorded for them. Trailing
+  // whitespace is dropped from names and values.
+  header_block(std::string &data, std::vector<span> const &spans);
+
+  bool empty() const { return spans_.empty(); }
+  std::size_t size() const { return spans_.size(); }
+
+  string_range name(std::size_t index) const;
+  string_range value(std::size_t index) const;
+
+  // The value of the first header with the given name, compared without
+  // regard to case. Returns an empty range if there is no such header.
+  string_range find(char const *name) const;
+  bool contains(char const *name) const;
+
+  // Calls f(name, value) for every header, in the order they were received.
+  void for_each(std::function<void(std::string const &, std::string const &)> f) const;
+
+  // Calls f(name, value) for every header with the given name.
+  void for_each(std::string const &name,
+                std::function<void(std::string const &, std::string const &)> f) const;
+
+  bool equals(header_block const &other) const;
+
+ private:
+  std::string data_;
+  std::vector<span> spans_;
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_RESPONSE_HEADER_BLOCK_HPP_20121018
@@ -0,0 +1,117 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_RESPONSE_HEADER_BLOCK_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_RESPONSE_HEADER_BLOCK_IPP_20121018
+
+#include <cstring>
+#include <network/protocol/http/response/header_block.hpp>
+#include <boost/range/algorithm/equal.hpp>
+
+namespace network { namespace http {
+
+namespace {
+
+  std::size_t trim_back(std::string const &data, std::size_t begin, std::size_t end) {
+    while (end > begin && impl::is_space(data[end - 1])) --end;
+    return end;
+  }
+
+  inline char lower(char c) {
+    return impl::is_upper(c) ? c - 'A' + 'a' : c;
+  }
+
+  // Header names are ASCII, so this skips the locale that
+  // boost::algorithm::iequals would construct on every call.
+  template <class Range>
+  bool same_name(header_block::string_range name, Range const &other) {
+    if (boost::distance(name) != boost::distance(other)) return false;
+    typename boost::range_iterator<Range const>::type o = boost::begin(other);
+    for (char const *c = boost::begin(name); c != boost::end(name); ++c, ++o)
+      if (lower(*c) != lower(*o)) return false;
+    return true;
+  }
+
+}  // namespace
+
+header_block::header_block()
+: data_()
+, spans_()
+{}
+
+header_block::header_block(std::string &data, std::vector<span> const &spans)
+: data_()
+, spans_(spans) {
+  data_.swap(data);
+  for (std::vector<span>::iterator it = spans_.begin(); it != spans_.end(); ++it) {
+    it->name_end = trim_back(data_, it->name_begin, it->name_end);
+    it->value_end = trim_back(data_, it->value_begin, it->value_end);
+  }
+}
+
+header_block::string_range header_block::name(std::size_t index) const {
+  char const *data = data_.data();
+  return string_range(data + spans_[index].name_begin, data + spans_[index].name_end);
+}
+
+header_block::string_range header_block::value(std::size_t index) const {
+  char const *data = data_.data();
+  return string_range(data + spans_[index].value_begin, data + spans_[index].value_end);
+}
+
+header_block::string_range header_block::find(char const *name) const {
+  string_range wanted(name, name + std::strlen(name));
+  for (std::size_t index = 0; index < spans_.size(); ++index) {
+    if (same_name(this->name(index), wanted))
+      return value(index);
+  }
+  return string_range();
+}
+
+bool header_block::contains(char const *name) const {
+  string_range wanted(name, name + std::strlen(name));
+  for (std::size_t index = 0; index < spans_.size(); ++index) {
+    if (same_name(this->name(index), wanted))
+      return true;
+  }
+  return false;
+}
+
+void header_block::for_each(
+    std::function<void(std::string const &, std::string const &)> f) const {
+  std::string name, value;
+  for (std::size_t index = 0; index < spans_.size(); ++index) {
+    name.assign(this->name(index).begin(), this->name(index).end());
+    value.assign(this->value(index).begin(), this->value(index).end());
+    f(name, value);
+  }
+}
+
+void header_block::for_each(
+    std::string const &name,
+    std::function<void(std::string const &, std::string const &)> f) const {
+  std::string value;
+  for (std::size_t index = 0; index < spans_.size(); ++index) {
+    if (same_name(this->name(index), name)) {
+      value.assign(this->value(index).begin(), this->value(index).end());
+      f(std::string(this->name(index).begin(), this->name(index).end()), value);
+    }
+  }
+}
+
+bool header_block::equals(header_block const &other) const {
+  if (spans_.size() != other.spans_.size()) return false;
+  for (std::size_t index = 0; index < spans_.size(); ++index) {
+    if (!boost::equal(name(index), other.name(index))
+        || !boost::equal(value(index), other.value(index)))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_RESPONSE_HEADER_BLOCK_IPP_20121018
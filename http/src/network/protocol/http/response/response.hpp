@@ -13,6 +13,8 @@
 namespace network { namespace http {
 
   struct response_pimpl;
+  class header_block;
+  class response_state;
 
   struct response : response_base {
     response();
@@ -55,15 +57,11 @@ namespace network { namespace http {
 
   private:
     friend struct impl::setter_access;  // Hide access through accessor class.
-                                        // These methods are unique to the response type which will allow for creating
-                                        // promises that can be set appropriately.
-    void set_version_promise(std::promise<std::string>&);
-    void set_status_promise(std::promise<uint16_t>&);
-    void set_status_message_promise(std::promise<std::string>&);
-    void set_headers_promise(std::promise<std::multimap<std::string, std::string> >&);
-    void set_source_promise(std::promise<std::string>&);
-    void set_destination_promise(std::promise<std::string>&);
-    void set_body_promise(std::promise<std::string>&);
+    friend class response_state;        // Hands responses to callbacks.
+    // Responses read by a connection share the state it fills in as the
+    // response arrives.
+    void set_state(std::shared_ptr<response_state> state);
+    std::shared_ptr<response_state> get_state() const;
 
     response_pimpl *pimpl_;
   };
@@ -8,7 +8,10 @@
 #define NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_IPP_20111206
 
 #include <network/protocol/http/response/response.hpp>
+#include <network/protocol/http/response/header_block.hpp>
+#include <network/protocol/http/response/response_state.hpp>
 #include <set>
+#include <boost/optional.hpp>
 
 namespace network { namespace http {
 
@@ -20,32 +23,19 @@ struct response_pimpl {
   }
 
   void set_destination(std::string const &destination) {
-    std::promise<std::string> destination_promise;
-    destination_promise.set_value(destination);
-    std::future<std::string> tmp_future = destination_promise.get_future();
-    destination_future_ = std::move(tmp_future);
+    destination_ = destination;
   }
 
   void get_destination(std::string &destination) {
-    if (!destination_future_.valid()) {
-      destination = "";
-    } else {
-      destination = destination_future_.get();
-    }
+    destination = this->destination().get_value_or("");
   }
 
   void set_source(std::string const &source) {
-    std::promise<std::string> source_promise;
-    source_promise.set_value(source);
-    source_future_ = source_promise.get_future().share();
+    source_ = source;
   }
 
   void get_source(std::string &source) {
-    if (!source_future_.valid()) {
-      source = "";
-    } else {
-      source = source_future_.get();
-    }
+    source = this->source().get_value_or("");
   }
 
   void append_header(std::string const & name,
@@ -58,21 +48,17 @@ struct response_pimpl {
   }
 
   void remove_headers() {
-    if (!headers_future_.valid()) {
-      std::promise<std::multimap<std::string, std::string> > headers_promise;
-      headers_promise.set_value(std::multimap<std::string, std::string>());
-      std::future<std::multimap<std::string, std::string> > tmp =
-          headers_promise.get_future();
+    if (!has_headers()) {
+      headers_ = header_block();
       std::multimap<std::string, std::string>().swap(added_headers_);
       std::set<std::string>().swap(removed_headers_);
-      headers_future_ = std::move(tmp);
     }
   }
 
   void get_headers(
       std::function<void(std::string const &, std::string const &)> inserter) {
     std::multimap<std::string, std::string>::const_iterator it;
-    if (!headers_future_.valid()) {
+    if (!has_headers()) {
       it = added_headers_.begin();
       for (;it != added_headers_.end(); ++it) {
         if (removed_headers_.find(it->first) == removed_headers_.end()) {
@@ -80,38 +66,45 @@ struct response_pimpl {
         }
       }
     } else {
-      std::multimap<std::string, std::string> const & headers_ =
-          headers_future_.get();
-      it = headers_.begin();
-      for (;it != headers_.end(); ++it) {
-        if (removed_headers_.find(it->first) == removed_headers_.end()) {
-          inserter(it->first, it->second);
-        }
-      }
+      headers().for_each(
+          [&](std::string const &name, std::string const &value) {
+            if (removed_headers_.find(name) == removed_headers_.end()) {
+              inserter(name, value);
+            }
+          });
     }
   }
   void get_headers(
       std::string const & name,
-      std::function<void(std::string const &, std::string const &)> inserter) { /* FIXME: Do something! */ }
+      std::function<void(std::string const &, std::string const &)> inserter) {
+    if (removed_headers_.find(name) != removed_headers_.end()) return;
+    if (!has_headers()) {
+      std::multimap<std::string, std::string>::const_iterator it =
+          added_headers_.lower_bound(name);
+      for (; it != added_headers_.end() && it->first == name; ++it)
+        inserter(it->first, it->second);
+    } else {
+      // Goes straight to the received header lines instead of building the
+      // whole map just to look up one name.
+      headers().for_each(name, inserter);
+    }
+  }
   void get_headers(
       std::function<bool(std::string const &, std::string const &)> predicate,
-      std::function<void(std::string const &, std::string const &)> inserter) { /* FIXME: Do something! */ }
+      std::function<void(std::string const &, std::string const &)> inserter) {
+    get_headers([&](std::string const &name, std::string const &value) {
+      if (predicate(name, value)) inserter(name, value);
+    });
+  }
 
   void set_body(std::string const &body) {
-    std::promise<std::string> body_promise;
-    body_promise.set_value(body);
-    std::future<std::string> tmp_future = body_promise.get_future();
-    body_future_ = std::move(tmp_future);
+    body_ = body;
   }
 
   void append_body(std::string const & data) { /* FIXME: Do something! */ }
 
   void get_body(std::string &body) {
-    if (!body_future_.valid()) {
-      body = "";
-    } else {
-      body = body_future_.get();
-    }
+    body = this->body().get_value_or("");
   }
 
   void get_body(
@@ -119,175 +112,116 @@ struct response_pimpl {
       size_t size) { /* FIXME: Do something! */ }
 
   void set_status(boost::uint16_t status) {
-    std::promise<boost::uint16_t> status_promise;
-    status_promise.set_value(status);
-    std::future<boost::uint16_t> tmp_future = status_promise.get_future();
-    status_future_ = std::move(tmp_future);
+    status_ = status;
   }
 
   void get_status(boost::uint16_t &status) {
-    if (!status_future_.valid()) {
-      status = 0u;
-    } else {
-      status = status_future_.get();
-    }
+    status = this->status().get_value_or(0u);
   }
 
   void set_status_message(std::string const &status_message) {
-    std::promise<std::string> status_message_promise_;
-    status_message_promise_.set_value(status_message);
-    std::future<std::string> tmp_future = status_message_promise_.get_future();
-    status_message_future_ = std::move(tmp_future);
+    status_message_ = status_message;
   }
 
   void get_status_message(std::string &status_message) {
-    if (!status_message_future_.valid()) {
-      status_message = "";
-    } else {
-      status_message = status_message_future_.get();
-    }
+    status_message = this->status_message().get_value_or("");
   }
 
   void set_version(std::string const &version) {
-    std::promise<std::string> version_promise;
-    version_promise.set_value(version);
-    std::future<std::string> tmp_future = version_promise.get_future();
-    version_future_ = std::move(tmp_future);
+    version_ = version;
   }
 
   void get_version(std::string &version) {
-    if (!version_future_.valid()) {
-      version = "";
-    } else {
-      version = version_future_.get();
-    }
+    version = this->version().get_value_or("");
   }
 
-  void set_source_promise(std::promise<std::string> &promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    source_future_ = std::move(tmp_future);
+  void set_state(std::shared_ptr<response_state> state) {
+    state_ = state;
   }
 
-  void set_destination_promise(std::promise<std::string> &promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    destination_future_ = std::move(tmp_future);
+  std::shared_ptr<response_state> get_state() const {
+    return state_;
   }
 
-  void set_headers_promise(std::promise<std::multimap<std::string, std::string> > &promise_) {
-    std::future<std::multimap<std::string, std::string> > tmp_future = promise_.get_future();
-    headers_future_ = std::move(tmp_future);
+  bool equals(response_pimpl const &other) const {
+    if (source() != other.source() ||
+        destination() != other.destination() ||
+        status() != other.status() ||
+        status_message() != other.status_message() ||
+        version() != other.version() ||
+        body() != other.body())
+      return false;
+    if (has_headers() != other.has_headers())
+      return false;
+    if (has_headers() && !headers().equals(other.headers()))
+      return false;
+    if (other.added_headers_ != added_headers_ || other.removed_headers_ != removed_headers_)
+      return false;
+    return true;
   }
 
-  void set_status_promise(std::promise<boost::uint16_t> &promise_) {
-    std::future<boost::uint16_t> tmp_future = promise_.get_future();
-    status_future_ = std::move(tmp_future);
+ private:
+  // What was set on this response takes precedence over what the
+  // connection it came from read, if it came from one.
+  boost::optional<std::string> source() const {
+    if (source_ || !state_) return source_;
+    return state_->source();
   }
 
-  void set_status_message_promise(std::promise<std::string> &promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    status_message_future_ = std::move(tmp_future);
+  boost::optional<std::string> destination() const {
+    if (destination_ || !state_) return destination_;
+    return state_->destination();
   }
 
-  void set_version_promise(std::promise<std::string> &promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    version_future_ = std::move(tmp_future);
+  boost::optional<boost::uint16_t> status() const {
+    if (status_ || !state_) return status_;
+    return state_->status();
   }
 
-  void set_body_promise(std::promise<std::string> &promise_) {
-    std::future<std::string> tmp_future = promise_.get_future();
-    body_future_ = std::move(tmp_future);
+  boost::optional<std::string> status_message() const {
+    if (status_message_ || !state_) return status_message_;
+    return state_->status_message();
   }
 
-  bool equals(response_pimpl const &other) {
-    if (source_future_.valid()) {
-      if (!other.source_future_.valid())
-        return false;
-      if (source_future_.get() != other.source_future_.get())
-        return false;
-    } else {
-      if (other.source_future_.valid())
-        return false;
-    }
-    if (destination_future_.valid()) {
-      if (!other.destination_future_.valid())
-        return false;
-      if (destination_future_.get() != other.destination_future_.get())
-        return false;
-    } else {
-      if (other.destination_future_.valid())
-        return false;
-    }
-    if (headers_future_.valid()) {
-      if (!other.headers_future_.valid())
-        return false;
-      if (headers_future_.get() != other.headers_future_.get())
-        return false;
-    } else {
-      if (other.headers_future_.valid())
-        return false;
-    }
-    if (status_future_.valid()) {
-      if (!other.status_future_.valid())
-        return false;
-      if (status_future_.get() != other.status_future_.get())
-        return false;
-    } else {
-      if (other.status_future_.valid())
-        return false;
-    }
-    if (status_message_future_.valid()) {
-      if (!other.status_message_future_.valid())
-        return false;
-      if (status_message_future_.get() != other.status_message_future_.get())
-        return false;
-    } else {
-      if (other.status_message_future_.valid())
-        return false;
-    }
-    if (version_future_.valid()) {
-      if (!other.version_future_.valid())
-        return false;
-      if (version_future_.get() != other.version_future_.get())
-        return false;
-    } else {
-      if (other.version_future_.valid())
-        return false;
-    }
-    if (body_future_.valid()) {
-      if (!other.body_future_.valid())
-        return false;
-      if (body_future_.get() != other.body_future_.get())
-        return false;
-    } else {
-      if (other.body_future_.valid())
-        return false;
-    }
-    if (other.added_headers_ != added_headers_ || other.removed_headers_ != removed_headers_)
-      return false;
-    return true;
+  boost::optional<std::string> version() const {
+    if (version_ || !state_) return version_;
+    return state_->version();
   }
 
- private:
-  mutable std::shared_future<std::string> source_future_;
-  mutable std::shared_future<std::string> destination_future_;
-  mutable std::shared_future<std::multimap<std::string, std::string> >
-      headers_future_;
-  mutable std::shared_future<boost::uint16_t> status_future_;
-  mutable std::shared_future<std::string> status_message_future_;
-  mutable std::shared_future<std::string> version_future_;
-  mutable std::shared_future<std::string> body_future_;
+  boost::optional<std::string> body() const {
+    if (body_ || !state_) return body_;
+    return state_->body();
+  }
+
+  bool has_headers() const {
+    return headers_ || state_;
+  }
+
+  header_block const & headers() const {
+    return headers_ ? *headers_ : state_->headers();
+  }
+
+  std::shared_ptr<response_state> state_;
+  boost::optional<std::string> source_;
+  boost::optional<std::string> destination_;
+  boost::optional<header_block> headers_;
+  boost::optional<boost::uint16_t> status_;
+  boost::optional<std::string> status_message_;
+  boost::optional<std::string> version_;
+  boost::optional<std::string> body_;
   // TODO: use unordered_map and unordered_set here.
   std::multimap<std::string, std::string> added_headers_;
   std::set<std::string> removed_headers_;
 
   response_pimpl(response_pimpl const &other)
-  : source_future_(other.source_future_)
-  , destination_future_(other.destination_future_)
-  , headers_future_(other.headers_future_)
-  , status_future_(other.status_future_)
-  , status_message_future_(other.status_message_future_)
-  , version_future_(other.version_future_)
-  , body_future_(other.body_future_)
+  : state_(other.state_)
+  , source_(other.source_)
+  , destination_(other.destination_)
+  , headers_(other.headers_)
+  , status_(other.status_)
+  , status_message_(other.status_message_)
+  , version_(other.version_)
+  , body_(other.body_)
   , added_headers_(other.added_headers_)
   , removed_headers_(other.removed_headers_)
   {}
@@ -401,32 +335,12 @@ response::~response() {
   delete pimpl_;
 }
 
-void response::set_version_promise(std::promise<std::string> &promise) {
-  return pimpl_->set_version_promise(promise);
-}
-
-void response::set_status_promise(std::promise<boost::uint16_t> &promise) {
-  return pimpl_->set_status_promise(promise);
-}
-
-void response::set_status_message_promise(std::promise<std::string> &promise) {
-  return pimpl_->set_status_message_promise(promise);
-}
-
-void response::set_headers_promise(std::promise<std::multimap<std::string, std::string> > &promise) {
-  return pimpl_->set_headers_promise(promise);
-}
-
-void response::set_source_promise(std::promise<std::string> &promise) {
-  return pimpl_->set_source_promise(promise);
-}
-
-void response::set_destination_promise(std::promise<std::string> &promise) {
-  return pimpl_->set_destination_promise(promise);
+void response::set_state(std::shared_ptr<response_state> state) {
+  pimpl_->set_state(state);
 }
 
-void response::set_body_promise(std::promise<std::string> &promise) {
-  return pimpl_->set_body_promise(promise);
+std::shared_ptr<response_state> response::get_state() const {
+  return pimpl_->get_state();
 }
 
 }  // namespace http
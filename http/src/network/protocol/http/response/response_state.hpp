@@ -0,0 +1,102 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_STATE_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_STATE_HPP_20121018
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <network/protocol/http/response/header_block.hpp>
+
+namespace network { namespace http {
+
+struct response;
+
+// What a connection knows about one response while it is being read: each
+// part of it as it arrives, or the error that ended it. Responses handed out
+// for the request share it, so a connection sets every part in one place and
+// fails the whole response at once; readers of a part that has not arrived
+// yet block until it does.
+class response_state : public std::enable_shared_from_this<response_state> {
+ public:
+  typedef std::function<void(response const &)> headers_callback;
+  typedef std::function<void(response const &, std::exception_ptr)> completion_callback;
+
+  response_state();
+
+  // Set by the connection, each at most once. Once the body, source and
+  // destination are all set the response is complete.
+  void set_version(std::string version);
+  void set_status(boost::uint16_t status);
+  void set_status_message(std::string status_message);
+  void set_headers(header_block headers);
+  void set_body(std::string body);
+  void set_source(std::string source);
+  void set_destination(std::string destination);
+
+  // Fails every part that has not been set yet; those that were keep their
+  // values. Does nothing once the response is complete or has failed.
+  void fail(std::exception_ptr error);
+
+  // Each blocks until its part is set, and rethrows the error the response
+  // failed with if that came first.
+  std::string version() const;
+  boost::uint16_t status() const;
+  std::string status_message() const;
+  header_block const & headers() const;
+  std::string body() const;
+  std::string source() const;
+  std::string destination() const;
+
+  // Called once, on the thread that sets the headers, with a response
+  // sharing this state; right away if they already are. Not called if the
+  // response fails before its headers arrive.
+  void on_headers(headers_callback callback);
+
+  // Called once, on the thread that completes or fails the response, with
+  // the error or a null exception_ptr; right away if that already happened.
+  void on_complete(completion_callback callback);
+
+ private:
+  enum part {
+    version_part = 1 << 0,
+    status_part = 1 << 1,
+    status_message_part = 1 << 2,
+    headers_part = 1 << 3,
+    body_part = 1 << 4,
+    source_part = 1 << 5,
+    destination_part = 1 << 6,
+    all_parts = (1 << 7) - 1
+  };
+
+  template <class T>
+  void set(T & slot, T & value, part which);
+  void wait_for(part which) const;
+  response shared_response();
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable arrived_;
+  unsigned ready_;
+  bool finished_;
+  std::exception_ptr error_;
+  std::string version_, status_message_, body_, source_, destination_;
+  boost::uint16_t status_;
+  header_block headers_;
+  headers_callback on_headers_;
+  completion_callback on_complete_;
+
+  response_state(response_state const &);  // = delete
+  response_state& operator=(response_state);  // = delete
+};
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_STATE_HPP_20121018 */
@@ -0,0 +1,159 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_STATE_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_STATE_IPP_20121018
+
+#include <utility>
+#include <network/protocol/http/response/response_state.hpp>
+#include <network/protocol/http/response/response.hpp>
+
+namespace network { namespace http {
+
+response_state::response_state()
+: ready_(0)
+, finished_(false)
+, status_(0u) {}
+
+template <class T>
+void response_state::set(T & slot, T & value, part which) {
+  headers_callback headers_ready;
+  completion_callback completed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_ || (ready_ & which)) return;
+    slot = std::move(value);
+    ready_ |= which;
+    if (which == headers_part) headers_ready.swap(on_headers_);
+    if (ready_ == all_parts) {
+      finished_ = true;
+      completed.swap(on_complete_);
+    }
+  }
+  arrived_.notify_all();
+  // Callbacks run without the lock, so they can read the response.
+  if (headers_ready) headers_ready(shared_response());
+  if (completed) completed(shared_response(), std::exception_ptr());
+}
+
+void response_state::set_version(std::string version) {
+  set(version_, version, version_part);
+}
+
+void response_state::set_status(boost::uint16_t status) {
+  set(status_, status, status_part);
+}
+
+void response_state::set_status_message(std::string status_message) {
+  set(status_message_, status_message, status_message_part);
+}
+
+void response_state::set_headers(header_block headers) {
+  set(headers_, headers, headers_part);
+}
+
+void response_state::set_body(std::string body) {
+  set(body_, body, body_part);
+}
+
+void response_state::set_source(std::string source) {
+  set(source_, source, source_part);
+}
+
+void response_state::set_destination(std::string destination) {
+  set(destination_, destination, destination_part);
+}
+
+void response_state::fail(std::exception_ptr error) {
+  headers_callback never_called;
+  completion_callback completed;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_) return;
+    finished_ = true;
+    error_ = error;
+    never_called.swap(on_headers_);
+    completed.swap(on_complete_);
+  }
+  arrived_.notify_all();
+  if (completed) completed(shared_response(), error);
+}
+
+void response_state::wait_for(part which) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!(ready_ & which) && !finished_) arrived_.wait(lock);
+  if (!(ready_ & which)) std::rethrow_exception(error_);
+  // Parts are set once, so they can be read without the lock from here on.
+}
+
+std::string response_state::version() const {
+  wait_for(version_part);
+  return version_;
+}
+
+boost::uint16_t response_state::status() const {
+  wait_for(status_part);
+  return status_;
+}
+
+std::string response_state::status_message() const {
+  wait_for(status_message_part);
+  return status_message_;
+}
+
+header_block const & response_state::headers() const {
+  wait_for(headers_part);
+  return headers_;
+}
+
+std::string response_state::body() const {
+  wait_for(body_part);
+  return body_;
+}
+
+std::string response_state::source() const {
+  wait_for(source_part);
+  return source_;
+}
+
+std::string response_state::destination() const {
+  wait_for(destination_part);
+  return destination_;
+}
+
+void response_state::on_headers(headers_callback callback) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!(ready_ & headers_part)) {
+      if (!finished_) on_headers_.swap(callback);
+      return;
+    }
+  }
+  callback(shared_response());
+}
+
+void response_state::on_complete(completion_callback callback) {
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!finished_) {
+      on_complete_.swap(callback);
+      return;
+    }
+    error = error_;
+  }
+  callback(shared_response(), error);
+}
+
+response response_state::shared_response() {
+  response shared;
+  shared.set_state(shared_from_this());
+  return shared;
+}
+
+}  // namespace http
+}  // namespace network
+
+#endif /* NETWORK_PROTOCOL_HTTP_RESPONSE_RESPONSE_STATE_IPP_20121018 */
@@ -11,14 +11,8 @@
 #define NETWORK_HTTP_SERVER_HPP_
 
 #include <boost/shared_ptr.hpp>
-
-namespace network { namespace utils {
-
-struct thread_pool;
-
-}  // namespace utils
-
-}  // namespace network
+#include <cstddef>
+#include <network/utils/thread_pool.hpp>
 
 namespace network { namespace http {
 
@@ -28,6 +22,7 @@ class async_server_impl;
 class async_server_connection;
 struct request;
 struct response;
+class request_view;
 
 
 template <class SyncHandler>
@@ -47,6 +42,9 @@ class sync_server {
   sync_server& operator=(sync_server other);  // = delete
 };
 
+// AsyncHandler is called either as handler(request const &, connection_ptr)
+// or, if it accepts one, as handler(request_view const &, connection_ptr);
+// see request_view for what the latter saves and what it costs.
 template <class AsyncHandler>
 class async_server {
  public:
@@ -54,6 +52,8 @@ class async_server {
   void run();
   void stop();
   void listen();
+  std::size_t connection_pool_hits() const;
+  std::size_t connection_pool_misses() const;
   ~async_server();
 
   typedef http::request request;
@@ -7,22 +7,24 @@
 #ifndef NETWORK_PROTOCOL_HTTP_SERVER_ASYNC_IMPL_20120318
 #define NETWORK_PROTOCOL_HTTP_SERVER_ASYNC_IMPL_20120318
 
+#include <atomic>
 #include <functional>
 #include <mutex>
+#include <vector>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <network/protocol/http/server/options.hpp>
 #include <network/protocol/http/server/impl/socket_options_setter.hpp>
-
-namespace network { namespace utils {
-struct thread_pool;
-}  // namespace util
-}  // namespace network
+#include <network/utils/thread_pool.hpp>
+#include <network/concurrency/timer_wheel.hpp>
 
 namespace network { namespace http {
 
 struct request;
 
+class request_view;
 class async_server_connection;
+class async_server_connection_pool;
 
 class async_server_impl : protected socket_options_setter {
  public:
@@ -30,25 +32,64 @@ class async_server_impl : protected socket_options_setter {
   async_server_impl(server_options const &options,
                     std::function<void(request const &, connection_ptr)> handler,
                     utils::thread_pool &thread_pool);
+  // Handlers taking a request_view get requests without copying them out of
+  // the connection, see request_view.
+  async_server_impl(server_options const &options,
+                    std::function<void(request_view const &, connection_ptr)> handler,
+                    utils::thread_pool &thread_pool);
   ~async_server_impl();
   void run();
   void stop();
   void listen();
 
+  // Connection pool counters, see server_options::connection_pool_size.
+  std::size_t connection_pool_hits() const;
+  std::size_t connection_pool_misses() const;
+
  private:
+  // A reactor is an io_service together with the connections pinned to it.
+  // There is always at least one; reactor 0 uses the io_service from the
+  // options if one was provided. Only reactors that accept connections
+  // themselves have an acceptor, and only servers with timeouts configured
+  // have a timer wheel per reactor.
+  //
+  // Each acceptor keeps server_options::pending_accepts() accepts in
+  // flight, one per slot. A slot owns the connection it is accepting into
+  // and the timer it waits on when accepting fails for lack of resources.
+  struct accept_slot {
+    connection_ptr connection;
+    std::shared_ptr<boost::asio::steady_timer> retry;
+  };
+
+  struct reactor {
+    boost::asio::io_service *service;
+    boost::asio::ip::tcp::acceptor *acceptor;
+    std::shared_ptr<concurrency::timer_wheel> timers;
+    std::shared_ptr<async_server_connection_pool> connections;
+    std::vector<accept_slot> accepts;
+    bool owned_service;
+  };
+
   server_options options_;
   std::string address_, port_;
-  boost::asio::io_service *service_;
-  boost::asio::ip::tcp::acceptor *acceptor_;
-  std::shared_ptr<async_server_connection> new_connection_;
+  std::vector<reactor> reactors_;
   std::mutex listening_mutex_, stopping_mutex_;
   std::function<void(request const &, connection_ptr)> handler_;
+  std::function<void(request_view const &, connection_ptr)> view_handler_;
   utils::thread_pool &pool_;
-  bool listening_, owned_service_, stopping_;
+  std::atomic<std::size_t> next_reactor_;
+  bool listening_, stopping_, round_robin_;
 
+  void init();
   void handle_stop();
   void start_listening();
-  void handle_accept(boost::system::error_code const &ec);
+  bool is_stopping();
+  std::size_t next_target(std::size_t index);
+  void start_accept(std::size_t index, std::size_t slot);
+  void handle_accept(std::size_t index, std::size_t slot, boost::system::error_code const &ec);
+  void handle_accept_retry(std::size_t index, std::size_t slot, boost::system::error_code const &ec);
+  void drain_accepts(std::size_t index);
+  void start_connection(connection_ptr const &connection);
 };
 
 }  // namespace http
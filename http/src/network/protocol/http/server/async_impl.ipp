@@ -9,10 +9,15 @@
 
 #include <network/protocol/http/server/async_impl.hpp>
 #include <network/protocol/http/server/connection/async.hpp>
+#include <network/protocol/http/server/connection/pool.hpp>
+#include <network/protocol/http/server/request_view.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <algorithm>
 #include <functional>
+#include <thread>
+#include <utility>
 #include <network/detail/debug.hpp>
 
 namespace network { namespace http {
@@ -23,33 +28,106 @@ async_server_impl::async_server_impl(server_options const &options,
 : options_(options)
 , address_(options.address())
 , port_(options.port())
-, service_(options.io_service())
-, acceptor_(0)
-, new_connection_()
+, reactors_()
 , listening_mutex_()
 , stopping_mutex_()
 , handler_(handler)
+, view_handler_()
 , pool_(thread_pool)
+, next_reactor_(0)
 , listening_(false)
-, owned_service_(false)
-, stopping_(false) {
-  if (service_ == 0) {
-    service_ = new boost::asio::io_service;
-    owned_service_ = true;
+, stopping_(false)
+, round_robin_(false) {
+  init();
+}
+
+async_server_impl::async_server_impl(server_options const &options,
+                                     std::function<void(request_view const &, connection_ptr)> handler,
+                                     utils::thread_pool &thread_pool)
+: options_(options)
+, address_(options.address())
+, port_(options.port())
+, reactors_()
+, listening_mutex_()
+, stopping_mutex_()
+, handler_()
+, view_handler_(handler)
+, pool_(thread_pool)
+, next_reactor_(0)
+, listening_(false)
+, stopping_(false)
+, round_robin_(false) {
+  init();
+}
+
+void async_server_impl::init() {
+  server_options const &options = options_;
+  std::size_t count = std::max<std::size_t>(options.reactors(), 1);
+  bool reuse_port = count > 1 && options.reuse_port();
+  if (reuse_port && !reuse_port_supported()) {
+    NETWORK_MESSAGE("SO_REUSEPORT is not supported, distributing connections round-robin");
+    reuse_port = false;
+  }
+  round_robin_ = count > 1 && !reuse_port;
+  reactors_.resize(count);
+  for (std::size_t index = 0; index < count; ++index) {
+    reactor &current = reactors_[index];
+    current.service = (index == 0) ? options.io_service() : 0;
+    current.owned_service = false;
+    if (current.service == 0) {
+      current.service = new boost::asio::io_service;
+      current.owned_service = true;
+    }
+    BOOST_ASSERT(current.service != 0);
+    current.acceptor = 0;
+    if (index == 0 || !round_robin_) {
+      current.acceptor = new boost::asio::ip::tcp::acceptor(*current.service);
+      BOOST_ASSERT(current.acceptor != 0);
+    }
+    if (options.idle_timeout() > 0 || options.header_read_timeout() > 0 ||
+        options.body_read_timeout() > 0 || options.write_timeout() > 0)
+      current.timers = std::make_shared<concurrency::timer_wheel>(std::ref(*current.service));
+    current.connections = std::make_shared<async_server_connection_pool>(
+        options, *current.service, handler_, pool_, current.timers.get(), view_handler_);
+    if (current.acceptor) {
+      current.accepts.resize(std::max<std::size_t>(options.pending_accepts(), 1));
+      for (std::vector<accept_slot>::iterator slot = current.accepts.begin();
+           slot != current.accepts.end();
+           ++slot)
+        slot->retry = std::make_shared<boost::asio::steady_timer>(*current.service);
+    }
   }
-  BOOST_ASSERT(service_ != 0);
-  acceptor_ = new boost::asio::ip::tcp::acceptor(*service_);
-  BOOST_ASSERT(acceptor_ != 0);
 }
 
 async_server_impl::~async_server_impl() {
-  if (owned_service_) delete service_;
-  delete acceptor_;
+  for (std::vector<reactor>::iterator it = reactors_.begin();
+       it != reactors_.end();
+       ++it) {
+    it->accepts.clear();
+    it->connections.reset();
+    it->timers.reset();
+    delete it->acceptor;
+    if (it->owned_service) delete it->service;
+  }
 }
 
 void async_server_impl::run() {
   listen();
-  service_->run();
+  // Every reactor but the first runs on its own thread; the first one runs
+  // on the caller's. Reactors that do not accept connections would run out
+  // of work right away without the work guards.
+  std::vector<std::shared_ptr<boost::asio::io_service::work> > guards;
+  std::vector<std::thread> threads;
+  for (std::size_t index = 1; index < reactors_.size(); ++index) {
+    boost::asio::io_service *service = reactors_[index].service;
+    guards.push_back(std::make_shared<boost::asio::io_service::work>(std::ref(*service)));
+    threads.push_back(std::thread([service] { service->run(); }));
+  }
+  reactors_[0].service->run();
+  for (std::vector<std::thread>::iterator it = threads.begin();
+       it != threads.end();
+       ++it)
+    it->join();
 }
 
 void async_server_impl::stop() {
@@ -58,9 +136,12 @@ void async_server_impl::stop() {
     std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
     stopping_ = true;
     boost::system::error_code ignored;
-    acceptor_->close(ignored);
+    for (std::vector<reactor>::iterator it = reactors_.begin();
+         it != reactors_.end();
+         ++it)
+      if (it->acceptor) it->acceptor->close(ignored);
     listening_ = false;
-    service_->post(
+    reactors_[0].service->post(
         boost::bind(&async_server_impl::handle_stop, this));
   }
 }
@@ -75,41 +156,145 @@ void async_server_impl::listen() {
   }
 }
 
+std::size_t async_server_impl::connection_pool_hits() const {
+  std::size_t hits = 0;
+  for (std::vector<reactor>::const_iterator it = reactors_.begin();
+       it != reactors_.end();
+       ++it)
+    hits += it->connections->hits();
+  return hits;
+}
+
+std::size_t async_server_impl::connection_pool_misses() const {
+  std::size_t misses = 0;
+  for (std::vector<reactor>::const_iterator it = reactors_.begin();
+       it != reactors_.end();
+       ++it)
+    misses += it->connections->misses();
+  return misses;
+}
+
 void async_server_impl::handle_stop() {
   std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
   // A user may have stopped listening again before the stop command is
   // reached.
-  if (stopping_) service_->stop();
+  if (stopping_) {
+    for (std::vector<reactor>::iterator it = reactors_.begin();
+         it != reactors_.end();
+         ++it)
+      it->service->stop();
+  }
 }
 
-void async_server_impl::handle_accept(boost::system::error_code const & ec) {
-  {
-    std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
-    // We dont want to add another handler instance, and we dont want to know
-    // about errors for a socket we dont need anymore.
-    if (stopping_) return;
-  }
+bool async_server_impl::is_stopping() {
+  std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
+  return stopping_;
+}
+
+std::size_t async_server_impl::next_target(std::size_t index) {
+  // In round-robin mode the only acceptor hands each new socket to the next
+  // reactor in turn; otherwise connections stay on the accepting reactor.
+  if (!round_robin_) return index;
+  return next_reactor_++ % reactors_.size();
+}
+
+void async_server_impl::start_accept(std::size_t index, std::size_t slot) {
+  reactor &current = reactors_[index];
+  accept_slot &accepting = current.accepts[slot];
+  // A slot whose last accept failed still has its connection.
+  if (!accepting.connection)
+    accepting.connection = reactors_[next_target(index)].connections->acquire();
+  current.acceptor->async_accept(
+      accepting.connection->socket(),
+      boost::bind(
+          &async_server_impl::handle_accept,
+          this,
+          index,
+          slot,
+          boost::asio::placeholders::error));
+}
+
+void async_server_impl::start_connection(connection_ptr const &connection) {
+  set_socket_options(options_, connection->socket());
+  connection->start();
+}
+
+void async_server_impl::handle_accept(std::size_t index, std::size_t slot, boost::system::error_code const & ec) {
+  // We dont want to add another handler instance, and we dont want to know
+  // about errors for a socket we dont need anymore.
+  if (is_stopping()) return;
+  reactor &current = reactors_[index];
+  accept_slot &accepting = current.accepts[slot];
   if (!ec) {
-    set_socket_options(options_, new_connection_->socket());
-    new_connection_->start();
-    new_connection_.reset(
-        new async_server_connection(*service_, handler_, pool_));
-    acceptor_->async_accept(
-        new_connection_->socket(),
+    connection_ptr connection;
+    connection.swap(accepting.connection);
+    start_connection(connection);
+    drain_accepts(index);
+    start_accept(index, slot);
+    return;
+  }
+  // The slot keeps its connection for the next attempt, so that retries do
+  // not count against the connection pool.
+  if (ec == boost::asio::error::operation_aborted || !current.acceptor->is_open())
+    return;
+  if (ec == boost::system::errc::too_many_files_open ||
+      ec == boost::system::errc::too_many_files_open_in_system ||
+      ec == boost::system::errc::no_buffer_space ||
+      ec == boost::system::errc::not_enough_memory) {
+    // Accepting again right away would fail the same way until some
+    // connections have been closed, so back off instead of spinning; the
+    // pending connections wait in the listen backlog meanwhile.
+    NETWORK_MESSAGE("Out of resources accepting connections, retrying in "
+                    << options_.accept_retry_delay() << "ms, reason: " << ec);
+    accepting.retry->expires_from_now(
+        std::chrono::milliseconds(std::max(options_.accept_retry_delay(), 0)));
+    accepting.retry->async_wait(
         boost::bind(
-            &async_server_impl::handle_accept,
+            &async_server_impl::handle_accept_retry,
             this,
+            index,
+            slot,
             boost::asio::placeholders::error));
-  } else {
-    NETWORK_MESSAGE("Error accepting connection, reason: " << ec);
+    return;
+  }
+  // Errors like ECONNABORTED only concern the connection that was being
+  // accepted, so the slot goes right back to accepting.
+  NETWORK_MESSAGE("Error accepting connection, reason: " << ec);
+  start_accept(index, slot);
+}
+
+void async_server_impl::handle_accept_retry(std::size_t index, std::size_t slot, boost::system::error_code const &ec) {
+  if (ec || is_stopping() || !reactors_[index].acceptor->is_open()) return;
+  start_accept(index, slot);
+}
+
+void async_server_impl::drain_accepts(std::size_t index) {
+  // The acceptor is non-blocking when batching is enabled, so this stops at
+  // the first would_block (or any other error, which the asynchronous
+  // accepts will report). Sockets are accepted on their own and only get a
+  // connection from the pool once there is one to serve.
+  boost::asio::ip::tcp::acceptor &acceptor = *reactors_[index].acceptor;
+  for (std::size_t accepted = 1; accepted < options_.accept_batch_size(); ++accepted) {
+    reactor &target = reactors_[next_target(index)];
+    boost::asio::ip::tcp::socket socket(*target.service);
+    boost::system::error_code error;
+    acceptor.accept(socket, error);
+    if (error) break;
+    connection_ptr connection = target.connections->acquire();
+    connection->socket() = std::move(socket);
+    start_connection(connection);
   }
 }
 
 void async_server_impl::start_listening() {
   using boost::asio::ip::tcp;
   boost::system::error_code error;
-  service_->reset();  // allows repeated cycles of run->stop->run
-  tcp::resolver resolver(*service_);
+  // allows repeated cycles of run->stop->run
+  for (std::vector<reactor>::iterator it = reactors_.begin();
+       it != reactors_.end();
+       ++it)
+    it->service->reset();
+  tcp::resolver resolver(*reactors_[0].service);
   tcp::resolver::query query(address_, port_);
   tcp::resolver::iterator endpoint_iterator = resolver.resolve(query, error);
   if (error) {
@@ -117,29 +302,34 @@ void async_server_impl::start_listening() {
     BOOST_THROW_EXCEPTION(std::runtime_error("Error resolving address:port combination."));
   }
   tcp::endpoint endpoint = *endpoint_iterator;
-  acceptor_->open(endpoint.protocol(), error);
-  if (error) {
-    NETWORK_MESSAGE("error opening socket: " << address_ << ":" << port_);
-    BOOST_THROW_EXCEPTION(std::runtime_error("Error opening socket."));
-  }
-  set_acceptor_options(options_, *acceptor_);
-  acceptor_->bind(endpoint, error);
-  if (error) {
-    NETWORK_MESSAGE("error binding socket: " << address_ << ":" << port_);
-    BOOST_THROW_EXCEPTION(std::runtime_error("Error binding socket."));
+  for (std::size_t index = 0; index < reactors_.size(); ++index) {
+    tcp::acceptor *acceptor = reactors_[index].acceptor;
+    if (acceptor == 0) continue;
+    acceptor->open(endpoint.protocol(), error);
+    if (error) {
+      NETWORK_MESSAGE("error opening socket: " << address_ << ":" << port_);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Error opening socket."));
+    }
+    set_acceptor_options(options_, *acceptor);
+    acceptor->bind(endpoint, error);
+    if (error) {
+      NETWORK_MESSAGE("error binding socket: " << address_ << ":" << port_);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Error binding socket."));
+    }
+    acceptor->listen(boost::asio::socket_base::max_connections, error);
+    if (error) {
+      NETWORK_MESSAGE("error listening on socket: '" << error << "' on " << address_ << ":" << port_);
+      BOOST_THROW_EXCEPTION(std::runtime_error("Error listening on socket."));
+    }
+    if (options_.accept_batch_size() > 1) acceptor->non_blocking(true, error);
+    for (std::size_t slot = 0; slot < reactors_[index].accepts.size(); ++slot) {
+      // Retries left over from a previous run must not start a second
+      // accept on a slot that is accepting again.
+      boost::system::error_code ignored;
+      reactors_[index].accepts[slot].retry->cancel(ignored);
+      start_accept(index, slot);
+    }
   }
-  acceptor_->listen(boost::asio::socket_base::max_connections, error);
-  if (error) {
-    NETWORK_MESSAGE("error listening on socket: '" << error << "' on " << address_ << ":" << port_);
-    BOOST_THROW_EXCEPTION(std::runtime_error("Error listening on socket."));
-  }
-  new_connection_.reset(new async_server_connection(*service_, handler_, pool_));
-  acceptor_->async_accept(
-      new_connection_->socket(),
-      boost::bind(
-          &async_server_impl::handle_accept,
-          this,
-          boost::asio::placeholders::error));
   listening_ = true;
   std::lock_guard<std::mutex> stopping_lock(stopping_mutex_);
   stopping_ = false; // if we were in the process of stopping, we revoke that command and continue listening
@@ -11,7 +11,12 @@
 #include <boost/scope_exit.hpp>
 #include <network/protocol/http/request.hpp>
 #include <network/protocol/http/algorithms/linearize.hpp>
+#include <network/protocol/http/message/header.hpp>
+#include <network/message/header_storage.hpp>
 #include <network/utils/thread_pool.hpp>
+#include <network/concurrency/timer_wheel.hpp>
+#include <network/protocol/http/server/options.hpp>
+#include <network/detail/debug.hpp>
 #include <boost/range/adaptor/sliced.hpp>
 #include <boost/range/algorithm/transform.hpp>
 #include <boost/range/algorithm/copy.hpp>
@@ -23,17 +28,30 @@
 #include <boost/asio/write.hpp>
 #include <memory>
 #include <network/protocol/http/server/request_parser.hpp>
+#include <network/protocol/http/server/request_view.hpp>
+#include <network/protocol/http/parser/chunked.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/typed_in_place_factory.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/lexical_cast.hpp>
 #include <thread>
 #include <type_traits>
 #include <list>
 #include <vector>
 #include <iterator>
+#include <limits>
 #include <mutex>
 #include <boost/bind.hpp>
 #include <network/constants.hpp>
+#include <cerrno>
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 #ifndef NETWORK_HTTP_SERVER_CONNECTION_HEADER_BUFFER_MAX_SIZE
 /** Here we define a page's worth of header connection buffer data.
@@ -58,10 +76,15 @@
 #define NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE 4096uL
 #endif
 
-namespace network { namespace http {
+#ifndef NETWORK_HTTP_SERVER_CONNECTION_FILE_BUFFER_SIZE
+/** The size of the buffer used to copy file contents to the socket when
+ *  write_file cannot use sendfile(2), either because the platform lacks it
+ *  or because the file descriptor does not support it.
+ */
+#define NETWORK_HTTP_SERVER_CONNECTION_FILE_BUFFER_SIZE 65536uL
+#endif
 
-  extern void parse_version(std::string const & partial_parsed, boost::fusion::tuple<uint8_t,uint8_t> & version_pair);
-  extern void parse_headers(std::string const & input, std::vector<std::pair<std::string,std::string> > & container);
+namespace network { namespace http {
 
   class async_server_connection : public std::enable_shared_from_this<async_server_connection> {
    public:
@@ -141,16 +164,43 @@ namespace network { namespace http {
           boost::asio::io_service & io_service
           , std::function<void(request const &, connection_ptr)> handler
           , utils::thread_pool & thread_pool
+          , std::function<void(request_view const &, connection_ptr)> view_handler
+              = std::function<void(request_view const &, connection_ptr)>()
           )
       : socket_(io_service)
       , strand(io_service)
       , handler(handler)
+      , view_handler(view_handler)
       , thread_pool_(thread_pool)
       , headers_already_sent(false)
       , headers_in_progress(false)
       , headers_buffer(NETWORK_HTTP_SERVER_CONNECTION_HEADER_BUFFER_MAX_SIZE)
+      , status(ok)
+      , request_(std::make_shared<request>())
+      , head_()
+      , view_()
+      , keep_alive_(false)
+      , http_1_0_(false)
+      , head_request_(false)
+      , timers_(0)
+      , deadline_()
+      , idle_timeout_(0)
+      , header_read_timeout_(0)
+      , body_read_timeout_(0)
+      , write_timeout_(0)
+      , idle_(false)
+      , writes_in_flight_(0)
+      , body_framing_(no_body)
+      , body_length_remaining_(0)
+      , body_parser_()
+      , body_done_(true)
+      , raw_read_(false)
+      , chunked_response_(false)
+      , body_finished_()
+      , in_view_handler_(false)
+      , response_done_deferred_(false)
       {
-          new_start = read_buffer_.begin();
+          new_start = data_end = read_buffer_.begin();
       }
 
       ~async_server_connection() throw () {
@@ -167,6 +217,20 @@ namespace network { namespace http {
        *  A call to set_headers takes a Range where each element models the
        *  Header concept. This Range will be linearized onto a buffer, which is
        *  then sent as soon as the first call to `write` or `flush` commences.
+       *
+       *  The headers also determine whether the connection can be re-used for
+       *  the next request: a response can only be followed by another one if
+       *  its body is delimited by a Content-Length header (or has no body at
+       *  all), and neither the request nor the response asked for the
+       *  connection to be closed. A Connection header is added to the
+       *  response when the handler did not provide one and the outcome
+       *  differs from the default for the request's HTTP version.
+       *
+       *  Including a "Transfer-Encoding: chunked" header turns every
+       *  subsequent write into a chunk of the body; call finish() to send the
+       *  terminating chunk and any trailers. HTTP/1.0 clients do not
+       *  understand chunking, so for them the header is left out and the
+       *  body is delimited by closing the connection instead.
        */
       template <class Range>
       void set_headers(Range headers) {
@@ -183,13 +247,53 @@ namespace network { namespace http {
                   << constants::http_slash() << 1<< constants::dot() << 1 << constants::space()
                   << status << constants::space() << status_message(status)
                   << constants::crlf();
-              if (!boost::empty(headers)) {
-                  typedef typename Range::const_iterator iterator;
-                  boost::transform(headers,
-                      std::ostream_iterator<std::string>(stream),
-                      linearize_header());
-              } else {
-                  stream << constants::crlf();
+              bool has_connection_header = false;
+              body_remaining_ = boost::none;
+              chunked_response_ = false;
+              typedef typename boost::range_iterator<Range const>::type iterator;
+              for (iterator it = boost::begin(headers); it != boost::end(headers); ++it) {
+                  well_known_header const id = lookup_header(name(*it));
+                  std::string const & header_value = value(*it);
+                  char const * value_begin = header_value.data();
+                  char const * value_end = value_begin + header_value.size();
+                  if (id == transfer_encoding_header
+                      && impl::contains_token(value_begin, value_end, "chunked")) {
+                      if (http_1_0_) {
+                          keep_alive_ = false;
+                          continue;
+                      }
+                      chunked_response_ = true;
+                  }
+                  stream << linearize_header()(*it);
+                  if (id == connection_header) {
+                      has_connection_header = true;
+                      if (impl::contains_token(value_begin, value_end, "close"))
+                          keep_alive_ = false;
+                  } else if (id == content_length_header) {
+                      try {
+                          body_remaining_ = boost::lexical_cast<std::size_t>(value(*it));
+                      } catch (boost::bad_lexical_cast const &) {
+                          body_remaining_ = boost::none;
+                      }
+                  }
+              }
+              // A chunked body ends with its last chunk, whatever the
+              // Content-Length says.
+              if (chunked_response_) body_remaining_ = boost::none;
+              if (head_request_ || status == no_content || status == not_modified) {
+                  body_remaining_ = 0;
+                  chunked_response_ = false;
+              }
+              // Without a delimited body the only way to tell the client that
+              // the response is done is to close the connection.
+              if (!body_remaining_ && !chunked_response_) keep_alive_ = false;
+              if (!has_connection_header) {
+                  if (keep_alive_ && http_1_0_)
+                      stream << constants::connection() << constants::colon()
+                             << constants::space() << "keep-alive" << constants::crlf();
+                  else if (!keep_alive_ && !http_1_0_)
+                      stream << constants::connection() << constants::colon()
+                             << constants::space() << constants::close() << constants::crlf();
               }
               stream << constants::crlf();
           }
@@ -213,15 +317,9 @@ namespace network { namespace http {
       void write(Range const & range) {
           lock_guard lock(headers_mutex);
           if (error_encountered) boost::throw_exception(boost::system::system_error(*error_encountered));
-          std::function<void(boost::system::error_code)> f =
-              std::bind(
-                  &async_server_connection::default_error
-                  , async_server_connection::shared_from_this()
-                  , std::placeholders::_1);
-
           write_impl(
               boost::make_iterator_range(range)
-              , f
+              , default_error_handler()
               );
       }
 
@@ -237,9 +335,169 @@ namespace network { namespace http {
       typename std::enable_if<std::is_base_of<boost::asio::const_buffer, typename ConstBufferSeq::value_type>::value>::type
       write(ConstBufferSeq const & seq, Callback const & callback)
       {
-          write_vec_impl(seq, callback, shared_array_list(), shared_buffers());
+          write_body(seq, callback, shared_array_list(), shared_buffers());
+      }
+
+      /** Zero-copy writes.
+       *
+       *  These overloads take ownership of the caller's buffers instead of
+       *  copying them into connection-owned chunks. The data is handed to
+       *  the socket as-is and kept alive only until the write completes, at
+       *  which point the callback is invoked from the thread pool.
+       *
+       *  A vector of shared buffers is sent as a single gather write.
+       */
+      void write(std::string && data) {
+          write(std::move(data), default_error_handler());
+      }
+
+      void write(std::vector<char> && data) {
+          write(std::move(data), default_error_handler());
+      }
+
+      template <class Callback>
+      void write(std::string && data, Callback const & callback) {
+          write(std::shared_ptr<std::string const>(
+                    std::make_shared<std::string>(std::move(data))),
+                callback);
+      }
+
+      template <class Callback>
+      void write(std::vector<char> && data, Callback const & callback) {
+          write(std::shared_ptr<std::vector<char> const>(
+                    std::make_shared<std::vector<char> >(std::move(data))),
+                callback);
+      }
+
+      template <class Buffer, class Callback>
+      void write(std::shared_ptr<Buffer const> const & data, Callback const & callback) {
+          write(std::vector<std::shared_ptr<Buffer const> >(1, data), callback);
+      }
+
+      template <class Buffer, class Callback>
+      void write(std::vector<std::shared_ptr<Buffer const> > const & data, Callback const & callback) {
+          lock_guard lock(headers_mutex);
+          if (error_encountered) boost::throw_exception(boost::system::system_error(*error_encountered));
+          std::shared_ptr<std::vector<std::shared_ptr<Buffer const> > > owners =
+              std::make_shared<std::vector<std::shared_ptr<Buffer const> > >(data);
+          shared_buffers buffers =
+              std::make_shared<std::vector<boost::asio::const_buffer> >(0);
+          buffers->reserve(owners->size());
+          for (typename std::vector<std::shared_ptr<Buffer const> >::const_iterator it = owners->begin();
+               it != owners->end();
+               ++it) {
+              if (*it && boost::asio::buffer_size(boost::asio::buffer(**it)) != 0)
+                  buffers->push_back(boost::asio::buffer(**it));
+          }
+          if (buffers->empty()) {
+              // Nothing to send, but the caller still expects to hear back.
+              std::function<void(boost::system::error_code)> callback_function = callback;
+              thread_pool().post(boost::bind(callback_function, boost::system::error_code()));
+              return;
+          }
+          write_body(*buffers, callback, owners, buffers);
+      }
+
+      /** Function: finish(Range trailers, Callback callback)
+       *
+       *  Ends the response body. For a chunked response this sends the
+       *  zero-length terminating chunk followed by the given trailers (a
+       *  Range of Header elements, like set_headers takes), after which the
+       *  connection can go on with the next request. A body delimited by
+       *  closing the connection gets the sending side shut down once the
+       *  writes issued so far have completed. Responses with a
+       *  Content-Length complete on their own.
+       *
+       *  For chunked responses this must be called after the last write has
+       *  completed.
+       */
+      template <class Range, class Callback>
+      void finish(Range const & trailers, Callback const & callback) {
+          lock_guard lock(headers_mutex);
+          if (error_encountered) boost::throw_exception(boost::system::system_error(*error_encountered));
+          std::function<void(boost::system::error_code)> callback_function = callback;
+          if (!chunked_response_) {
+              // Like the last chunk, this waits for the headers to go out.
+              std::function<void()> continuation = boost::bind(
+                  &async_server_connection::finish_body
+                  , async_server_connection::shared_from_this()
+                  , callback_function);
+              if (!headers_already_sent && !headers_in_progress) {
+                  write_headers_only(continuation);
+                  return;
+              } else if (headers_in_progress && !headers_already_sent) {
+                  pending_actions.push_back(continuation);
+                  return;
+              }
+              finish_body(callback_function);
+              return;
+          }
+          std::shared_ptr<std::string> last_chunk = std::make_shared<std::string>("0\r\n");
+          typedef typename boost::range_iterator<Range const>::type iterator;
+          for (iterator it = boost::begin(trailers); it != boost::end(trailers); ++it)
+              last_chunk->append(linearize_header()(*it));
+          last_chunk->append(constants::crlf());
+          shared_buffers buffers =
+              std::make_shared<std::vector<boost::asio::const_buffer> >(
+                  1, boost::asio::buffer(*last_chunk));
+          std::function<void(boost::system::error_code)> completion =
+              boost::bind(
+                  &async_server_connection::handle_last_chunk
+                  , async_server_connection::shared_from_this()
+                  , callback_function
+                  , _1);
+          write_vec_impl(*buffers, completion, last_chunk, buffers, 0);
+      }
+
+      template <class Callback>
+      void finish(Callback const & callback) {
+          finish(std::vector<response_header>(), callback);
+      }
+
+      void finish() {
+          finish(default_error_handler());
+      }
+
+#if !defined(_WIN32)
+      /** Function: write_file(int fd, off_t offset, std::size_t length, Callback callback)
+       *
+       *  Sends `length` bytes of the file open as `fd`, starting at `offset`,
+       *  as (part of) the response body. On Linux the data goes from the page
+       *  cache straight to the socket with sendfile(2); elsewhere, or for
+       *  descriptors sendfile does not support, it is copied through a
+       *  buffer with pread. The transfer is queued behind the headers like
+       *  any other write and is framed as a single chunk for chunked
+       *  responses. The descriptor is not closed and must stay open until
+       *  the callback is invoked.
+       */
+      template <class Callback>
+      void write_file(int fd, off_t offset, std::size_t length, Callback const & callback) {
+          lock_guard lock(headers_mutex);
+          if (error_encountered) boost::throw_exception(boost::system::system_error(*error_encountered));
+          std::shared_ptr<file_transfer> transfer = std::make_shared<file_transfer>();
+          transfer->fd = fd;
+          transfer->offset = offset;
+          transfer->remaining = length;
+          transfer->callback = callback;
+          std::function<void()> continuation = boost::bind(
+              &async_server_connection::start_file_transfer
+              , async_server_connection::shared_from_this()
+              , transfer);
+          if (!headers_already_sent && !headers_in_progress) {
+              write_headers_only(continuation);
+              return;
+          } else if (headers_in_progress && !headers_already_sent) {
+              pending_actions.push_back(continuation);
+              return;
+          }
+          start_file_transfer(transfer);
       }
 
+      void write_file(int fd, off_t offset, std::size_t length) {
+          write_file(fd, offset, length, default_error_handler());
+      }
+#endif
+
   private:
       typedef boost::array<char, NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE> buffer_type;
 
@@ -249,9 +507,15 @@ namespace network { namespace http {
 
       void read(read_callback_function callback) {
           if (error_encountered) boost::throw_exception(boost::system::system_error(*error_encountered));
-          if (new_start != read_buffer_.begin())
           {
-              input_range input = boost::make_iterator_range(new_start, read_buffer_.end());
+              // Raw reads bypass body framing, so we can no longer tell
+              // where the next request starts.
+              lock_guard lock(headers_mutex);
+              raw_read_ = true;
+          }
+          if (new_start != data_end)
+          {
+              input_range input = boost::make_iterator_range(new_start, data_end);
               thread_pool().post(
                   boost::bind(
                       callback
@@ -260,10 +524,11 @@ namespace network { namespace http {
                       , std::distance(new_start, data_end)
                       , async_server_connection::shared_from_this())
               );
-              new_start = read_buffer_.begin();
+              new_start = data_end = read_buffer_.begin();
               return;
           }
 
+          arm_deadline(body_read_timeout_);
           socket().async_read_some(
               boost::asio::buffer(read_buffer_)
               , strand.wrap(
@@ -274,6 +539,30 @@ namespace network { namespace http {
                       , boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)));
       }
 
+      typedef std::function<void(input_range, boost::system::error_code, bool, connection_ptr)> body_callback_function;
+
+      /** Function: read_body(body_callback_function callback)
+       *
+       *  Reads the next piece of the request body, decoded according to its
+       *  Content-Length or chunked Transfer-Encoding. The callback gets the
+       *  decoded data, an error code, and whether this was the end of the
+       *  body. The data stays valid until the next call to read_body.
+       *
+       *  Nothing is read from the socket until read_body is called again, so
+       *  a slow consumer holds back the client instead of having the body
+       *  buffered. Requests without a body complete right away with an empty
+       *  range. Whatever is left of the body once the response is complete
+       *  is read and discarded, so that the connection can be re-used for
+       *  the next request; the handler must not read it concurrently.
+       */
+      void read_body(body_callback_function callback) {
+          strand.post(
+              boost::bind(
+                  &async_server_connection::read_body_impl
+                  , async_server_connection::shared_from_this()
+                  , callback));
+      }
+
       boost::asio::ip::tcp::socket & socket()    { return socket_;               }
       utils::thread_pool & thread_pool()  { return thread_pool_;          }
       bool has_error()                    { return (!!error_encountered); }
@@ -284,6 +573,10 @@ namespace network { namespace http {
 
       void wrap_read_handler(read_callback_function callback, boost::system::error_code const & ec, std::size_t bytes_transferred) {
           if (ec) error_encountered = boost::in_place<boost::system::system_error>(ec);
+          {
+              lock_guard lock(headers_mutex);
+              if (writes_in_flight_ == 0) cancel_deadline();
+          }
           buffer_type::const_iterator data_start = read_buffer_.begin()
                                      ,data_end   = read_buffer_.begin();
           std::advance(data_end, bytes_transferred);
@@ -297,12 +590,22 @@ namespace network { namespace http {
       }
 
       void default_error(boost::system::error_code const & ec) {
-          error_encountered = boost::in_place<boost::system::system_error>(ec);
+          if (ec) error_encountered = boost::in_place<boost::system::system_error>(ec);
+      }
+
+      std::function<void(boost::system::error_code)> default_error_handler() {
+          return std::bind(
+              &async_server_connection::default_error
+              , async_server_connection::shared_from_this()
+              , std::placeholders::_1);
       }
 
       typedef boost::array<char, NETWORK_HTTP_SERVER_CONNECTION_BUFFER_SIZE> array;
       typedef std::list<std::shared_ptr<array> > array_list;
       typedef std::shared_ptr<array_list> shared_array_list;
+      // Whatever owns the memory behind the buffers of an in-flight write;
+      // either connection-owned chunks or buffers handed over by the caller.
+      typedef std::shared_ptr<void const> buffer_owner;
       typedef std::shared_ptr<std::vector<boost::asio::const_buffer> > shared_buffers;
       typedef std::lock_guard<std::recursive_mutex> lock_guard;
       typedef std::list<std::function<void()> > pending_actions_list;
@@ -310,6 +613,9 @@ namespace network { namespace http {
       boost::asio::ip::tcp::socket socket_;
       boost::asio::io_service::strand strand;
       std::function<void(request const &, connection_ptr)> handler;
+      // When set, requests go to this handler as a request_view instead, and
+      // request_ is left alone.
+      std::function<void(request_view const &, connection_ptr)> view_handler;
       utils::thread_pool & thread_pool_;
       volatile bool headers_already_sent, headers_in_progress;
       boost::asio::streambuf headers_buffer;
@@ -318,13 +624,276 @@ namespace network { namespace http {
       buffer_type read_buffer_;
       status_t status;
       request_parser parser;
-      request request_;
+      std::shared_ptr<request> request_;
+      // For view handlers, the request line and headers of the current
+      // request, and the view over them. The read buffer cannot back the
+      // view because the handler may read the body into it while it still
+      // looks at the request.
+      std::string head_;
+      request_view view_;
+      std::string peer_;
       buffer_type::iterator new_start, data_end;
       std::string partial_parsed;
       boost::optional<boost::system::system_error> error_encountered;
       pending_actions_list pending_actions;
+      // Whether the connection is re-used after the current response, whether
+      // the current request came in as HTTP/1.0 (or older), and whether it is
+      // a HEAD request. The number of response body bytes left to write is
+      // only known when the handler provides a Content-Length header.
+      bool keep_alive_, http_1_0_, head_request_;
+      boost::optional<std::size_t> body_remaining_;
+      // A single deadline covers whatever the connection is waiting on: the
+      // next request while idle, the rest of the request headers, a body read
+      // or outstanding writes. Timeouts are in milliseconds, 0 disables them.
+      concurrency::timer_wheel *timers_;
+      concurrency::timer_wheel::timer deadline_;
+      int idle_timeout_, header_read_timeout_, body_read_timeout_, write_timeout_;
+      bool idle_;
+      std::size_t writes_in_flight_;
+      // How the body of the current request is delimited, and how far along
+      // read_body is with it. Bodies with an unknown transfer coding run
+      // until the client closes its side of the connection.
+      enum body_framing_t { no_body, length_body, chunked_body, unframed_body };
+      body_framing_t body_framing_;
+      std::size_t body_length_remaining_;
+      chunked_parser body_parser_;
+      bool body_done_, raw_read_;
+      // Whether response writes are being framed as chunks.
+      bool chunked_response_;
+      // A finish() waiting for outstanding writes of a body that is not
+      // chunked.
+      std::function<void()> body_finished_;
+      // Whether the view handler is running, and whether the response
+      // completed meanwhile.
+      bool in_view_handler_, response_done_deferred_;
 
       friend class async_server_impl;
+      friend class async_server_connection_pool;
+
+      void set_timeouts(server_options const &options, concurrency::timer_wheel *timers) {
+          timers_ = timers;
+          idle_timeout_ = options.idle_timeout();
+          header_read_timeout_ = options.header_read_timeout();
+          body_read_timeout_ = options.body_read_timeout();
+          write_timeout_ = options.write_timeout();
+      }
+
+      // The deadline callback holds on to the connection weakly. It is built
+      // once for every socket the connection serves, as it starts, so that
+      // re-arming the deadline afterwards only re-links the timer.
+      void bind_deadline() {
+          if (!timers_) return;
+          std::weak_ptr<async_server_connection> self = async_server_connection::shared_from_this();
+          deadline_.set_callback(std::bind(&async_server_connection::deadline_expired, self));
+      }
+
+      void arm_deadline(int timeout) {
+          if (!timers_) return;
+          if (timeout <= 0) {
+              cancel_deadline();
+              return;
+          }
+          timers_->schedule(deadline_, std::chrono::milliseconds(timeout));
+      }
+
+      void cancel_deadline() {
+          if (timers_) timers_->cancel(deadline_);
+      }
+
+      static void deadline_expired(std::weak_ptr<async_server_connection> self) {
+          if (connection_ptr connection = self.lock())
+              connection->strand.post(
+                  boost::bind(&async_server_connection::handle_deadline, connection));
+      }
+
+      void handle_deadline() {
+          NETWORK_MESSAGE("connection to " << peer_ << " timed out, closing.");
+          lock_guard lock(headers_mutex);
+          if (!error_encountered)
+              error_encountered = boost::in_place<boost::system::system_error>(
+                  boost::system::error_code(boost::asio::error::timed_out));
+          boost::system::error_code ignored;
+          socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+          socket_.close(ignored);
+      }
+
+      void begin_write() {
+          ++writes_in_flight_;
+          arm_deadline(write_timeout_);
+      }
+
+      void end_write() {
+          if (writes_in_flight_ > 0) --writes_in_flight_;
+          if (writes_in_flight_ > 0) {
+              arm_deadline(write_timeout_);
+              return;
+          }
+          cancel_deadline();
+          if (body_finished_) {
+              std::function<void()> finished;
+              finished.swap(body_finished_);
+              thread_pool().post(finished);
+          }
+      }
+
+      // Brings a connection whose last reference went away back to the state
+      // it was in right after construction, so that the pool can hand it out
+      // for the next accepted socket.
+      void recycle() {
+          boost::system::error_code ignored;
+          socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+          socket_.close(ignored);
+          headers_already_sent = false;
+          headers_in_progress = false;
+          headers_buffer.consume(headers_buffer.size());
+          status = ok;
+          parser.reset();
+          request_ = std::make_shared<request>();
+          head_.clear();
+          view_.clear();
+          peer_.clear();
+          new_start = data_end = read_buffer_.begin();
+          partial_parsed.clear();
+          error_encountered = boost::none;
+          pending_actions.clear();
+          keep_alive_ = http_1_0_ = head_request_ = false;
+          body_remaining_ = boost::none;
+          cancel_deadline();
+          idle_ = false;
+          writes_in_flight_ = 0;
+          reset_body();
+          chunked_response_ = false;
+          body_finished_ = std::function<void()>();
+          in_view_handler_ = response_done_deferred_ = false;
+      }
+
+      // Reads a Content-Length value: decimal digits, optionally surrounded
+      // by whitespace, that fit in a std::size_t.
+      static bool parse_content_length(boost::iterator_range<char const *> value, std::size_t & length) {
+          char const * current = value.begin(), * end = value.end();
+          while (current != end && (*current == ' ' || *current == '\t')) ++current;
+          while (end != current && (end[-1] == ' ' || end[-1] == '\t')) --end;
+          if (current == end) return false;
+          length = 0;
+          for (; current != end; ++current) {
+              if (*current < '0' || *current > '9') return false;
+              std::size_t digit = *current - '0';
+              if (length > (std::numeric_limits<std::size_t>::max() - digit) / 10) return false;
+              length = length * 10 + digit;
+          }
+          return true;
+      }
+
+      void reset_body() {
+          body_framing_ = no_body;
+          body_length_remaining_ = 0;
+          body_parser_.reset();
+          body_done_ = true;
+          raw_read_ = false;
+      }
+
+      void read_body_impl(body_callback_function callback) {
+          if (error_encountered) {
+              thread_pool().post(
+                  boost::bind(callback, input_range(), error_encountered->code(), false,
+                              async_server_connection::shared_from_this()));
+              return;
+          }
+          if (body_done_) {
+              thread_pool().post(
+                  boost::bind(callback, input_range(), boost::system::error_code(), true,
+                              async_server_connection::shared_from_this()));
+              return;
+          }
+          if (new_start != data_end) {
+              decode_body(callback);
+              return;
+          }
+          new_start = data_end = read_buffer_.begin();
+          arm_deadline(body_read_timeout_);
+          socket_.async_read_some(
+              boost::asio::buffer(read_buffer_)
+              , strand.wrap(
+                  boost::bind(
+                      &async_server_connection::handle_body_read
+                      , async_server_connection::shared_from_this()
+                      , callback
+                      , boost::asio::placeholders::error
+                      , boost::asio::placeholders::bytes_transferred)));
+      }
+
+      void handle_body_read(body_callback_function callback, boost::system::error_code const & ec, std::size_t bytes_transferred) {
+          {
+              lock_guard lock(headers_mutex);
+              if (writes_in_flight_ == 0) cancel_deadline();
+          }
+          if (ec == boost::asio::error::eof && body_framing_ == unframed_body) {
+              body_done_ = true;
+              thread_pool().post(
+                  boost::bind(callback, input_range(), boost::system::error_code(), true,
+                              async_server_connection::shared_from_this()));
+              return;
+          }
+          if (ec) {
+              error_encountered = boost::in_place<boost::system::system_error>(ec);
+              thread_pool().post(
+                  boost::bind(callback, input_range(), ec, false,
+                              async_server_connection::shared_from_this()));
+              return;
+          }
+          data_end = read_buffer_.begin();
+          std::advance(data_end, bytes_transferred);
+          decode_body(callback);
+      }
+
+      // Hands the next run of body data in [new_start, data_end) to the
+      // callback, reading more from the socket if the buffered data only
+      // held chunk framing.
+      void decode_body(body_callback_function callback) {
+          input_range data;
+          switch (body_framing_) {
+              case length_body: {
+                  std::size_t available = std::distance(new_start, data_end);
+                  std::size_t length = std::min(available, body_length_remaining_);
+                  data = input_range(new_start, new_start + length);
+                  new_start += length;
+                  body_length_remaining_ -= length;
+                  body_done_ = (body_length_remaining_ == 0);
+                  break;
+              }
+              case chunked_body: {
+                  boost::logic::tribool parsed_ok = boost::logic::indeterminate;
+                  while (boost::logic::indeterminate(parsed_ok) && new_start != data_end && boost::empty(data)) {
+                      boost::iterator_range<buffer_type::iterator> chunk;
+                      boost::fusion::tie(parsed_ok, new_start, chunk) = body_parser_.parse(new_start, data_end);
+                      data = input_range(boost::begin(chunk), boost::end(chunk));
+                  }
+                  if (!parsed_ok) {
+                      keep_alive_ = false;
+                      boost::system::error_code ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+                      error_encountered = boost::in_place<boost::system::system_error>(ec);
+                      thread_pool().post(
+                          boost::bind(callback, input_range(), ec, false,
+                                      async_server_connection::shared_from_this()));
+                      return;
+                  }
+                  if (parsed_ok) {
+                      body_done_ = true;
+                  } else if (boost::empty(data)) {
+                      read_body_impl(callback);
+                      return;
+                  }
+                  break;
+              }
+              default:
+                  data = input_range(new_start, data_end);
+                  new_start = data_end;
+                  break;
+          }
+          thread_pool().post(
+              boost::bind(callback, data, boost::system::error_code(), body_done_,
+                          async_server_connection::shared_from_this()));
+      }
 
       enum state_t {
           method, uri, version, headers
@@ -334,7 +903,10 @@ namespace network { namespace http {
           std::ostringstream ip_stream;
           ip_stream << socket_.remote_endpoint().address().to_string() << ':'
               << socket_.remote_endpoint().port();
-          request_.set_source(ip_stream.str());
+          peer_ = ip_stream.str();
+          request_->set_source(peer_);
+          bind_deadline();
+          arm_deadline(header_read_timeout_);
           read_more(method);
       }
 
@@ -355,129 +927,318 @@ namespace network { namespace http {
 
       void handle_read_data(state_t state, boost::system::error_code const & ec, std::size_t bytes_transferred) {
           if (!ec) {
-              boost::logic::tribool parsed_ok;
-              boost::iterator_range<buffer_type::iterator> result_range, input_range;
+              if (idle_) {
+                  idle_ = false;
+                  arm_deadline(header_read_timeout_);
+              }
               data_end = read_buffer_.begin();
               std::advance(data_end, bytes_transferred);
-              switch (state) {
-                  case method:
-                      input_range = boost::make_iterator_range(
-                          new_start, data_end);
-                      boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
-                          request_parser::method_done, input_range);
-                      if (!parsed_ok) {
-                          client_error();
-                          break;
-                      } else if (parsed_ok == true) {
-                        std::string method;
-                        swap(partial_parsed, method);
-                        method.append(boost::begin(result_range),
-                                      boost::end(result_range));
-                        boost::trim(method);
-                        request_.set_method(method);
-                        new_start = boost::end(result_range);
-                      } else {
-                        partial_parsed.append(
-                            boost::begin(result_range),
-                            boost::end(result_range));
-                        new_start = read_buffer_.begin();
-                        read_more(method);
-                        break;
-                      }
-                  case uri:
-                      input_range = boost::make_iterator_range(
-                          new_start, data_end);
-                      boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
-                          request_parser::uri_done,
-                          input_range);
-                      if (!parsed_ok) {
-                          client_error();
-                          break;
-                      } else if (parsed_ok == true) {
-                        std::string destination;
-                        swap(partial_parsed, destination);
-                        destination.append(boost::begin(result_range),
-                                           boost::end(result_range));
-                        boost::trim(destination);
-                        request_.set_destination(destination);
-                        new_start = boost::end(result_range);
-                      } else {
-                        partial_parsed.append(
-                            boost::begin(result_range),
-                            boost::end(result_range));
-                        new_start = read_buffer_.begin();
-                        read_more(uri);
-                        break;
+              parse_input(state);
+          } else {
+              error_encountered = boost::in_place<boost::system::system_error>(ec);
+          }
+      }
+
+      // Parses whatever is in [new_start, data_end), which may be data that
+      // was just read from the socket or a pipelined request that arrived
+      // together with the previous one.
+      void parse_input(state_t state) {
+          boost::logic::tribool parsed_ok;
+          boost::iterator_range<buffer_type::iterator> result_range, input_range;
+          switch (state) {
+              case method:
+                  input_range = boost::make_iterator_range(
+                      new_start, data_end);
+                  boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
+                      request_parser::method_done, input_range);
+                  if (view_handler) head_.append(boost::begin(result_range), boost::end(result_range));
+                  if (!parsed_ok) {
+                      client_error();
+                      break;
+                  } else if (parsed_ok == true) {
+                    if (!view_handler) {
+                      std::string method;
+                      swap(partial_parsed, method);
+                      method.append(boost::begin(result_range),
+                                    boost::end(result_range));
+                      boost::trim(method);
+                      request_->set_method(method);
+                      head_request_ = (method == "HEAD");
+                    }
+                    partial_parsed.clear();
+                    new_start = boost::end(result_range);
+                  } else {
+                    partial_parsed.append(
+                        boost::begin(result_range),
+                        boost::end(result_range));
+                    new_start = read_buffer_.begin();
+                    read_more(method);
+                    break;
+                  }
+              case uri:
+                  input_range = boost::make_iterator_range(
+                      new_start, data_end);
+                  boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
+                      request_parser::uri_done,
+                      input_range);
+                  if (view_handler) head_.append(boost::begin(result_range), boost::end(result_range));
+                  if (!parsed_ok) {
+                      client_error();
+                      break;
+                  } else if (parsed_ok == true) {
+                    if (!view_handler) {
+                      std::string destination;
+                      swap(partial_parsed, destination);
+                      destination.append(boost::begin(result_range),
+                                         boost::end(result_range));
+                      boost::trim(destination);
+                      request_->set_destination(destination);
+                    }
+                    partial_parsed.clear();
+                    new_start = boost::end(result_range);
+                  } else {
+                    partial_parsed.append(
+                        boost::begin(result_range),
+                        boost::end(result_range));
+                    new_start = read_buffer_.begin();
+                    read_more(uri);
+                    break;
+                  }
+              case version:
+                  input_range = boost::make_iterator_range(
+                      new_start, data_end);
+                  boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
+                      request_parser::version_done,
+                      input_range);
+                  if (view_handler) head_.append(boost::begin(result_range), boost::end(result_range));
+                  if (!parsed_ok) {
+                      client_error();
+                      break;
+                  } else if (parsed_ok == true) {
+                      if (!view_handler) {
+                          request_->set_version_major(parser.version_major());
+                          request_->set_version_minor(parser.version_minor());
                       }
-                  case version:
-                      input_range = boost::make_iterator_range(
-                          new_start, data_end);
-                      boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
-                          request_parser::version_done,
-                          input_range);
-                      if (!parsed_ok) {
-                          client_error();
-                          break;
-                      } else if (parsed_ok == true) {
-                          boost::fusion::tuple<uint8_t, uint8_t> version_pair;
-                          partial_parsed.append(boost::begin(result_range), boost::end(result_range));
-                          parse_version(partial_parsed, version_pair);
-                          request_.set_version_major(boost::fusion::get<0>(version_pair));
-                          request_.set_version_minor(boost::fusion::get<1>(version_pair));
-                          new_start = boost::end(result_range);
-                          partial_parsed.clear();
-                      } else {
+                      http_1_0_ = parser.version_major() < 1
+                          || (parser.version_major() == 1
+                              && parser.version_minor() == 0);
+                      new_start = boost::end(result_range);
+                      partial_parsed.clear();
+                  } else {
+                      partial_parsed.append(
+                          boost::begin(result_range),
+                          boost::end(result_range));
+                      new_start = read_buffer_.begin();
+                      read_more(version);
+                      break;
+                  }
+              case headers:
+                  input_range = boost::make_iterator_range(
+                      new_start, data_end);
+                  boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
+                      request_parser::headers_done,
+                      input_range);
+                  if (view_handler) head_.append(boost::begin(result_range), boost::end(result_range));
+                  if (!parsed_ok) {
+                      client_error();
+                      break;
+                  } else if (parsed_ok == true) {
+                      // The parser has already located every header. When
+                      // the whole header block arrived in this read it is
+                      // used right where it is in the read buffer; otherwise
+                      // it is the earlier pieces saved in partial_parsed plus
+                      // this one. View handlers get the copy in head_.
+                      char const * block = &*input_range.begin();
+                      if (view_handler) {
+                          block = head_.data() + parser.headers_begin();
+                      } else if (!partial_parsed.empty()) {
                           partial_parsed.append(
                               boost::begin(result_range),
                               boost::end(result_range));
-                          new_start = read_buffer_.begin();
-                          read_more(version);
-                          break;
+                          block = partial_parsed.data();
                       }
-                  case headers:
-                      input_range = boost::make_iterator_range(
-                          new_start, data_end);
-                      boost::fusion::tie(parsed_ok, result_range) = parser.parse_until(
-                          request_parser::headers_done,
-                          input_range);
-                      if (!parsed_ok) {
-                          client_error();
-                          break;
-                      } else if (parsed_ok == true) {
-                          partial_parsed.append(
-                              boost::begin(result_range),
-                              boost::end(result_range));
-                          std::vector<std::pair<std::string, std::string> > headers;
-                          parse_headers(partial_parsed, headers);
-                          for (std::vector<std::pair<std::string, std::string> >::const_iterator it = headers.begin();
-                               it != headers.end();
-                               ++it) {
-                            request_.append_header(it->first, it->second);
+                      keep_alive_ = !http_1_0_;
+                      reset_body();
+                      bool bad_length = false;
+                      typedef std::vector<request_parser::header_span> header_spans;
+                      header_spans const & spans = parser.header_spans();
+                      for (header_spans::const_iterator it = spans.begin();
+                           it != spans.end();
+                           ++it) {
+                        boost::iterator_range<char const *> name(block + it->name_begin, block + it->name_end),
+                                                            value(block + it->value_begin, block + it->value_end);
+                        if (view_handler) {
+                          request_view::header header = { name, value };
+                          view_.headers_.push_back(header);
+                        } else {
+                          request_->append_header(std::string(name.begin(), name.end()),
+                                                  std::string(value.begin(), value.end()));
+                        }
+                        well_known_header const id =
+                            lookup_header(name.begin(), name.size());
+                        if (id == connection_header) {
+                          if (impl::contains_token(value.begin(), value.end(), "close"))
+                            keep_alive_ = false;
+                          else if (impl::contains_token(value.begin(), value.end(), "keep-alive"))
+                            keep_alive_ = true;
+                        } else if (id == content_length_header) {
+                          if (body_framing_ == no_body || body_framing_ == length_body) {
+                            if (parse_content_length(value, body_length_remaining_))
+                              body_framing_ = body_length_remaining_ ? length_body : no_body;
+                            else
+                              bad_length = true;
                           }
-                          new_start = boost::end(result_range);
+                        } else if (id == transfer_encoding_header) {
+                          // Transfer-Encoding overrides any Content-Length.
+                          body_framing_ = impl::contains_token(value.begin(), value.end(), "chunked")
+                              ? chunked_body : unframed_body;
+                        }
+                      }
+                      partial_parsed.clear();
+                      if (bad_length) {
+                        client_error();
+                        return;
+                      }
+                      body_done_ = (body_framing_ == no_body);
+                      if (body_framing_ == unframed_body) keep_alive_ = false;
+                      new_start = boost::end(result_range);
+                      cancel_deadline();
+                      if (view_handler) {
+                          char const * head = head_.data();
+                          view_.method_ = request_view::string_range(head, head + parser.method_end());
+                          view_.destination_ = request_view::string_range(
+                              head + parser.uri_begin(), head + parser.uri_end());
+                          view_.source_ = request_view::string_range(
+                              peer_.data(), peer_.data() + peer_.size());
+                          view_.version_major_ = parser.version_major();
+                          view_.version_minor_ = parser.version_minor();
+                          head_request_ = boost::equals(view_.method_, "HEAD");
                           thread_pool().post(
                               boost::bind(
-                                  handler,
-                                  boost::cref(request_),
+                                  &async_server_connection::invoke_view_handler,
                                   async_server_connection::shared_from_this()));
                           return;
-                      } else {
-                          partial_parsed.append(
-                              boost::begin(result_range),
-                              boost::end(result_range));
-                          new_start = read_buffer_.begin();
-                          read_more(headers);
-                          break;
                       }
-                  default:
-                      BOOST_ASSERT(false && "This is a bug, report to the cpp-netlib devel mailing list!");
-                      std::abort();
-              }
+                      thread_pool().post(
+                          boost::bind(
+                              &async_server_connection::invoke_handler,
+                              async_server_connection::shared_from_this(),
+                              request_));
+                      return;
+                  } else {
+                      partial_parsed.append(
+                          boost::begin(result_range),
+                          boost::end(result_range));
+                      new_start = read_buffer_.begin();
+                      read_more(headers);
+                      break;
+                  }
+              default:
+                  BOOST_ASSERT(false && "This is a bug, report to the cpp-netlib devel mailing list!");
+                  std::abort();
+          }
+      }
+
+      void invoke_handler(std::shared_ptr<request> current_request) {
+          handler(*current_request, async_server_connection::shared_from_this());
+      }
+
+      // The view points into head_, so a response that completes while the
+      // handler is still running must not move on to the next request yet.
+      void invoke_view_handler() {
+          {
+              lock_guard lock(headers_mutex);
+              in_view_handler_ = true;
+          }
+          try {
+              view_handler(view_, async_server_connection::shared_from_this());
+          } catch (...) {
+              view_handler_returned();
+              throw;
+          }
+          view_handler_returned();
+      }
+
+      void view_handler_returned() {
+          lock_guard lock(headers_mutex);
+          in_view_handler_ = false;
+          if (response_done_deferred_) {
+              response_done_deferred_ = false;
+              strand.post(
+                  boost::bind(
+                      &async_server_connection::response_done
+                      , async_server_connection::shared_from_this()));
+          }
+      }
+
+      // Called once the whole response to the current request has been
+      // written. For persistent connections this resets the per-request state
+      // and goes on with the next request, parsing any pipelined data that is
+      // already in the buffer before reading from the socket again.
+      void response_done() {
+          lock_guard lock(headers_mutex);
+          if (in_view_handler_) {
+              response_done_deferred_ = true;
+              return;
+          }
+          // A body the handler did not read is skipped over to find the start
+          // of the next request. After a raw read() there is no telling where
+          // it ends, so the connection is not re-used.
+          if (keep_alive_ && !body_done_ && !raw_read_) {
+              strand.post(
+                  boost::bind(
+                      &async_server_connection::drain_body,
+                      async_server_connection::shared_from_this()));
+              return;
+          }
+          if (!keep_alive_ || !body_done_ || raw_read_) {
+              boost::system::error_code ignored;
+              socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ignored);
+              return;
+          }
+          headers_already_sent = false;
+          headers_in_progress = false;
+          body_remaining_ = boost::none;
+          head_request_ = false;
+          reset_body();
+          chunked_response_ = false;
+          status = ok;
+          parser.reset();
+          partial_parsed.clear();
+          head_.clear();
+          view_.clear();
+          if (!view_handler) {
+              request_ = std::make_shared<request>();
+              request_->set_source(peer_);
+          }
+          if (new_start != data_end) {
+              arm_deadline(header_read_timeout_);
+              strand.post(
+                  boost::bind(
+                      &async_server_connection::parse_input,
+                      async_server_connection::shared_from_this(),
+                      method));
           } else {
-              error_encountered = boost::in_place<boost::system::system_error>(ec);
+              new_start = data_end = read_buffer_.begin();
+              idle_ = true;
+              arm_deadline(idle_timeout_);
+              read_more(method);
           }
       }
 
+      void drain_body() {
+          read_body_impl(&async_server_connection::body_drained);
+      }
+
+      static void body_drained(input_range, boost::system::error_code const & ec, bool done, connection_ptr connection) {
+          if (ec) return;
+          connection->strand.post(
+              boost::bind(
+                  done ? &async_server_connection::response_done
+                       : &async_server_connection::drain_body,
+                  connection));
+      }
+
       void client_error() {
           static char const * bad_request =
               "HTTP/1.0 400 Bad Request\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: 12\r\n\r\nBad Request.";
@@ -508,6 +1269,7 @@ namespace network { namespace http {
       void write_headers_only(std::function<void()> callback) {
           if (headers_in_progress) return;
           headers_in_progress = true;
+          begin_write();
           boost::asio::async_write(
               socket()
               , headers_buffer
@@ -522,6 +1284,7 @@ namespace network { namespace http {
 
       void handle_write_headers(std::function<void()> callback, boost::system::error_code const & ec, std::size_t bytes_transferred) {
           lock_guard lock(headers_mutex);
+          end_write();
           if (!ec) {
               headers_buffer.consume(headers_buffer.size());
               headers_already_sent = true;
@@ -532,6 +1295,7 @@ namespace network { namespace http {
                   thread_pool().post(*start++);
               }
               pending_actions_list().swap(pending_actions);
+              if (body_remaining_ && *body_remaining_ == 0) response_done();
           } else {
               error_encountered = boost::in_place<boost::system::system_error>(ec);
           }
@@ -539,13 +1303,28 @@ namespace network { namespace http {
 
       void handle_write(
           std::function<void(boost::system::error_code const &)> callback
-          , shared_array_list temporaries
+          , buffer_owner temporaries
           , shared_buffers buffers
+          , std::size_t payload
           , boost::system::error_code const & ec
           , std::size_t bytes_transferred
       ) {
           // we want to forget the temporaries and buffers
           thread_pool().post(boost::bind(callback, ec));
+          lock_guard lock(headers_mutex);
+          end_write();
+          if (ec) return;
+          account_body_bytes(payload);
+      }
+
+      // Counts bytes of the response body against its Content-Length and
+      // completes the response once all of it has been written.
+      void account_body_bytes(std::size_t bytes) {
+          lock_guard lock(headers_mutex);
+          if (body_remaining_) {
+              *body_remaining_ -= std::min(*body_remaining_, bytes);
+              if (*body_remaining_ == 0) response_done();
+          }
       }
 
       template <class Range>
@@ -596,15 +1375,252 @@ namespace network { namespace http {
           }
 
           if (!buffers->empty()) {
-              write_vec_impl(*buffers, callback, temporaries, buffers);
+              write_body(*buffers, callback, temporaries, buffers);
           }
       }
 
+      // Writes a piece of the response body, framing it as a chunk (size
+      // line, payload, CRLF) in a single gather write if the response is
+      // chunked. Empty writes complete right away without sending anything
+      // since an empty chunk would end the body.
+      template <class ConstBufferSeq, class Callback>
+      void write_body(ConstBufferSeq const & seq
+                     ,Callback const & callback
+                     ,buffer_owner temporaries
+                     ,shared_buffers buffers)
+      {
+          lock_guard lock(headers_mutex);
+          std::size_t size = boost::asio::buffer_size(seq);
+          if (!chunked_response_) {
+              write_vec_impl(seq, callback, temporaries, buffers, size);
+              return;
+          }
+          if (size == 0) {
+              std::function<void(boost::system::error_code)> callback_function = callback;
+              thread_pool().post(boost::bind(callback_function, boost::system::error_code()));
+              return;
+          }
+          std::ostringstream size_line;
+          size_line << std::hex << size << constants::crlf();
+          std::shared_ptr<std::pair<buffer_owner, std::string> > frame =
+              std::make_shared<std::pair<buffer_owner, std::string> >(temporaries, size_line.str());
+          shared_buffers framed =
+              std::make_shared<std::vector<boost::asio::const_buffer> >(0);
+          framed->push_back(boost::asio::buffer(frame->second));
+          framed->insert(framed->end(), seq.begin(), seq.end());
+          framed->push_back(boost::asio::buffer(constants::crlf(), 2));
+          write_vec_impl(*framed, callback, frame, framed, size);
+      }
+
+#if !defined(_WIN32)
+      struct file_transfer {
+          file_transfer()
+          : fd(-1), offset(0), remaining(0), sent(0), framed(false), use_fallback(false) {}
+          int fd;
+          off_t offset;
+          std::size_t remaining, sent;
+          bool framed, use_fallback;
+          std::vector<char> buffer;
+          std::function<void(boost::system::error_code)> callback;
+      };
+
+      void start_file_transfer(std::shared_ptr<file_transfer> transfer) {
+          lock_guard lock(headers_mutex);
+          if (transfer->remaining == 0) {
+              thread_pool().post(boost::bind(transfer->callback, boost::system::error_code()));
+              return;
+          }
+          begin_write();
+          if (chunked_response_) {
+              transfer->framed = true;
+              std::ostringstream size_line_stream;
+              size_line_stream << std::hex << transfer->remaining << constants::crlf();
+              std::shared_ptr<std::string> size_line = std::make_shared<std::string>(size_line_stream.str());
+              boost::asio::async_write(
+                  socket_
+                  , boost::asio::buffer(*size_line)
+                  , strand.wrap(
+                      boost::bind(
+                          &async_server_connection::handle_file_framing
+                          , async_server_connection::shared_from_this()
+                          , transfer
+                          , size_line
+                          , boost::asio::placeholders::error)));
+              return;
+          }
+          strand.post(
+              boost::bind(
+                  &async_server_connection::send_file_some
+                  , async_server_connection::shared_from_this()
+                  , transfer));
+      }
+
+      void handle_file_framing(std::shared_ptr<file_transfer> transfer, std::shared_ptr<std::string>, boost::system::error_code const & ec) {
+          if (ec) finish_file_transfer(transfer, ec);
+          else if (transfer->remaining == 0) finish_file_transfer(transfer, ec);
+          else send_file_some(transfer);
+      }
+
+      void send_file_some(std::shared_ptr<file_transfer> transfer) {
+#if defined(__linux__)
+          if (!transfer->use_fallback) {
+              // sendfile needs to see EAGAIN instead of blocking, after which
+              // we wait for the socket to become writable again.
+              boost::system::error_code ignored;
+              socket_.native_non_blocking(true, ignored);
+              while (transfer->remaining != 0) {
+                  ssize_t sent = ::sendfile(
+                      socket_.native_handle(), transfer->fd, &transfer->offset,
+                      std::min<std::size_t>(transfer->remaining, 1u << 30));
+                  if (sent > 0) {
+                      transfer->remaining -= sent;
+                      transfer->sent += sent;
+                  } else if (sent == 0) {
+                      finish_file_transfer(transfer, boost::asio::error::eof);
+                      return;
+                  } else if (errno == EINTR) {
+                      continue;
+                  } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                      arm_deadline(write_timeout_);
+                      socket_.async_write_some(
+                          boost::asio::null_buffers()
+                          , strand.wrap(
+                              boost::bind(
+                                  &async_server_connection::handle_file_writable
+                                  , async_server_connection::shared_from_this()
+                                  , transfer
+                                  , boost::asio::placeholders::error)));
+                      return;
+                  } else if (errno == EINVAL || errno == ENOSYS) {
+                      transfer->use_fallback = true;
+                      break;
+                  } else {
+                      finish_file_transfer(
+                          transfer,
+                          boost::system::error_code(errno, boost::system::system_category()));
+                      return;
+                  }
+              }
+              if (!transfer->use_fallback) {
+                  finish_file_transfer(transfer, boost::system::error_code());
+                  return;
+              }
+          }
+#endif
+          if (transfer->remaining == 0) {
+              finish_file_transfer(transfer, boost::system::error_code());
+              return;
+          }
+          if (transfer->buffer.empty())
+              transfer->buffer.resize(NETWORK_HTTP_SERVER_CONNECTION_FILE_BUFFER_SIZE);
+          ssize_t bytes_read = 0;
+          do {
+              bytes_read = ::pread(
+                  transfer->fd, &transfer->buffer[0],
+                  std::min(transfer->remaining, transfer->buffer.size()),
+                  transfer->offset);
+          } while (bytes_read < 0 && errno == EINTR);
+          if (bytes_read <= 0) {
+              finish_file_transfer(
+                  transfer,
+                  bytes_read == 0
+                      ? boost::system::error_code(boost::asio::error::eof)
+                      : boost::system::error_code(errno, boost::system::system_category()));
+              return;
+          }
+          boost::asio::async_write(
+              socket_
+              , boost::asio::buffer(&transfer->buffer[0], bytes_read)
+              , strand.wrap(
+                  boost::bind(
+                      &async_server_connection::handle_file_data_written
+                      , async_server_connection::shared_from_this()
+                      , transfer
+                      , boost::asio::placeholders::error
+                      , boost::asio::placeholders::bytes_transferred)));
+      }
+
+      void handle_file_writable(std::shared_ptr<file_transfer> transfer, boost::system::error_code const & ec) {
+          if (ec) finish_file_transfer(transfer, ec);
+          else send_file_some(transfer);
+      }
+
+      void handle_file_data_written(std::shared_ptr<file_transfer> transfer, boost::system::error_code const & ec, std::size_t bytes_transferred) {
+          if (ec) {
+              finish_file_transfer(transfer, ec);
+              return;
+          }
+          transfer->offset += bytes_transferred;
+          transfer->remaining -= bytes_transferred;
+          transfer->sent += bytes_transferred;
+          arm_deadline(write_timeout_);
+          send_file_some(transfer);
+      }
+
+      void finish_file_transfer(std::shared_ptr<file_transfer> transfer, boost::system::error_code const & ec) {
+          if (!ec && transfer->framed) {
+              transfer->framed = false;
+              boost::asio::async_write(
+                  socket_
+                  , boost::asio::buffer(constants::crlf(), 2)
+                  , strand.wrap(
+                      boost::bind(
+                          &async_server_connection::handle_file_framing
+                          , async_server_connection::shared_from_this()
+                          , transfer
+                          , std::shared_ptr<std::string>()
+                          , boost::asio::placeholders::error)));
+              return;
+          }
+          thread_pool().post(boost::bind(transfer->callback, ec));
+          lock_guard lock(headers_mutex);
+          end_write();
+          if (ec) {
+              error_encountered = boost::in_place<boost::system::system_error>(ec);
+              return;
+          }
+          account_body_bytes(transfer->sent);
+      }
+#endif
+
+      // Ends a response whose body is not chunked once every write issued
+      // for it so far has completed; end_write() picks it up otherwise.
+      void finish_body(std::function<void(boost::system::error_code)> callback) {
+          lock_guard lock(headers_mutex);
+          if (writes_in_flight_ > 0) {
+              body_finished_ = boost::bind(
+                  &async_server_connection::finish_body
+                  , async_server_connection::shared_from_this()
+                  , callback);
+              return;
+          }
+          boost::system::error_code ec;
+          if (error_encountered) ec = error_encountered->code();
+          thread_pool().post(boost::bind(callback, ec));
+          if (!ec && !body_remaining_)
+              strand.post(
+                  boost::bind(
+                      &async_server_connection::response_done
+                      , async_server_connection::shared_from_this()));
+      }
+
+      void handle_last_chunk(std::function<void(boost::system::error_code)> callback, boost::system::error_code const & ec) {
+          callback(ec);
+          if (!ec)
+              strand.post(
+                  boost::bind(
+                      &async_server_connection::response_done
+                      , async_server_connection::shared_from_this()));
+      }
+
+      // Writes the buffers once the headers are out. Only `payload` bytes
+      // of them count as response body, the rest is chunk framing.
       template <class ConstBufferSeq, class Callback>
       void write_vec_impl(ConstBufferSeq const & seq
                          ,Callback const & callback
-                         ,shared_array_list temporaries
-                         ,shared_buffers buffers)
+                         ,buffer_owner temporaries
+                         ,shared_buffers buffers
+                         ,std::size_t payload)
       {
           lock_guard lock(headers_mutex);
           if (error_encountered)
@@ -616,7 +1632,7 @@ namespace network { namespace http {
           std::function<void()> continuation = boost::bind(
               &async_server_connection::template write_vec_impl<ConstBufferSeq, std::function<void(boost::system::error_code)> >
               ,async_server_connection::shared_from_this()
-              ,seq, callback_function, temporaries, buffers
+              ,seq, callback_function, temporaries, buffers, payload
           );
 
           if (!headers_already_sent && !headers_in_progress) {
@@ -627,17 +1643,20 @@ namespace network { namespace http {
               return;
           }
 
+          begin_write();
           boost::asio::async_write(
                socket_
               ,seq
-              ,boost::bind(
-                  &async_server_connection::handle_write
-                  ,async_server_connection::shared_from_this()
-                  ,callback_function
-                  ,temporaries
-                  ,buffers
-                  ,boost::asio::placeholders::error
-                  ,boost::asio::placeholders::bytes_transferred)
+              ,strand.wrap(
+                  boost::bind(
+                      &async_server_connection::handle_write
+                      ,async_server_connection::shared_from_this()
+                      ,callback_function
+                      ,temporaries
+                      ,buffers
+                      ,payload
+                      ,boost::asio::placeholders::error
+                      ,boost::asio::placeholders::bytes_transferred))
           );
       }
   };
@@ -0,0 +1,86 @@
+// Copyright 2012 Dean Michael Berris <dberris@google.com>.
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_CONNECTION_POOL_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_SERVER_CONNECTION_POOL_HPP_20121018
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <network/utils/thread_pool.hpp>
+#include <network/concurrency/timer_wheel.hpp>
+#include <network/protocol/http/server/options.hpp>
+
+namespace boost { namespace asio {
+
+class io_service;
+
+}  // namespace asio
+
+}  // namespace boost
+
+namespace network { namespace http {
+
+struct request;
+
+class request_view;
+class async_server_connection;
+
+// A bounded freelist of async_server_connection objects. Connections handed
+// out by acquire() are returned to the pool (instead of being destroyed)
+// once the last reference to them goes away, so that the strand, buffers and
+// mutexes they carry can be reused for the next accepted socket. The
+// capacity comes from server_options::connection_pool_size, 0 disables
+// recycling. Connections get their timeouts from the same options and are
+// timed on the given wheel, if any. Connections pass requests to the view
+// handler when one is given, and to the regular handler otherwise.
+class async_server_connection_pool
+    : public std::enable_shared_from_this<async_server_connection_pool> {
+ public:
+  typedef std::shared_ptr<async_server_connection> connection_ptr;
+  typedef std::function<void(request const &, connection_ptr)> handler_function;
+  typedef std::function<void(request_view const &, connection_ptr)> view_handler_function;
+
+  async_server_connection_pool(server_options const &options,
+                               boost::asio::io_service &service,
+                               handler_function handler,
+                               utils::thread_pool &thread_pool,
+                               concurrency::timer_wheel *timers,
+                               view_handler_function view_handler = view_handler_function());
+  ~async_server_connection_pool();
+
+  connection_ptr acquire();
+
+  // Number of acquire() calls served from the freelist, and the number that
+  // had to allocate a new connection.
+  std::size_t hits() const;
+  std::size_t misses() const;
+
+ private:
+  void release(async_server_connection *connection);
+
+  server_options options_;
+  std::size_t capacity_;
+  boost::asio::io_service &service_;
+  handler_function handler_;
+  view_handler_function view_handler_;
+  utils::thread_pool &thread_pool_;
+  concurrency::timer_wheel *timers_;
+  mutable std::mutex mutex_;
+  std::vector<async_server_connection *> free_;
+  std::size_t hits_, misses_;
+
+  async_server_connection_pool(async_server_connection_pool const &);  // = delete
+  async_server_connection_pool& operator=(async_server_connection_pool const &);  // = delete
+};
+
+}  // namespace http
+
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_CONNECTION_POOL_HPP_20121018
@@ -0,0 +1,95 @@
+// Copyright 2012 Dean Michael Berris <dberris@google.com>.
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_CONNECTION_POOL_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_SERVER_CONNECTION_POOL_IPP_20121018
+
+#include <network/protocol/http/server/connection/pool.hpp>
+#include <network/protocol/http/server/connection/async.hpp>
+#include <boost/asio/io_service.hpp>
+
+namespace network { namespace http {
+
+async_server_connection_pool::async_server_connection_pool(
+    server_options const &options,
+    boost::asio::io_service &service,
+    handler_function handler,
+    utils::thread_pool &thread_pool,
+    concurrency::timer_wheel *timers,
+    view_handler_function view_handler)
+: options_(options)
+, capacity_(options.connection_pool_size())
+, service_(service)
+, handler_(handler)
+, view_handler_(view_handler)
+, thread_pool_(thread_pool)
+, timers_(timers)
+, mutex_()
+, free_()
+, hits_(0)
+, misses_(0) {
+  free_.reserve(capacity_);
+}
+
+async_server_connection_pool::~async_server_connection_pool() {
+  for (std::vector<async_server_connection *>::iterator it = free_.begin();
+       it != free_.end();
+       ++it)
+    delete *it;
+}
+
+async_server_connection_pool::connection_ptr async_server_connection_pool::acquire() {
+  async_server_connection *connection = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_.empty()) {
+      connection = free_.back();
+      free_.pop_back();
+      ++hits_;
+    } else {
+      ++misses_;
+    }
+  }
+  if (connection == 0) {
+    connection = new async_server_connection(service_, handler_, thread_pool_, view_handler_);
+    connection->set_timeouts(options_, timers_);
+  }
+  // The deleter keeps the pool alive for as long as any of its connections
+  // are still in use, even if the server itself has gone away.
+  return connection_ptr(
+      connection,
+      std::bind(&async_server_connection_pool::release,
+                shared_from_this(),
+                std::placeholders::_1));
+}
+
+std::size_t async_server_connection_pool::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+std::size_t async_server_connection_pool::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+void async_server_connection_pool::release(async_server_connection *connection) {
+  connection->recycle();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < capacity_) {
+      free_.push_back(connection);
+      return;
+    }
+  }
+  delete connection;
+}
+
+}  // namespace http
+
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_CONNECTION_POOL_IPP_20121018
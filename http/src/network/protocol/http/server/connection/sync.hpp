@@ -33,11 +33,6 @@
 
 namespace network { namespace http {
 
-#ifndef NETWORK_NO_LIB
-  extern void parse_version(std::string const & partial_parsed, boost::fusion::tuple<uint8_t,uint8_t> & version_pair);
-  extern void parse_headers(std::string const & input, std::vector<std::pair<std::string,std::string> > & container);
-#endif
-
 class sync_server_connection : public boost::enable_shared_from_this<sync_server_connection> {
  public:
   sync_server_connection(boost::asio::io_service & service,
@@ -150,11 +145,8 @@ class sync_server_connection : public boost::enable_shared_from_this<sync_server
             client_error();
             break;
           } else if (parsed_ok == true) {
-            boost::fusion::tuple<uint8_t, uint8_t> version_pair;
-            partial_parsed.append(boost::begin(result_range), boost::end(result_range));
-            parse_version(partial_parsed, version_pair);
-            request_.set_version_major(boost::fusion::get<0>(version_pair));
-            request_.set_version_minor(boost::fusion::get<1>(version_pair));
+            request_.set_version_major(parser_.version_major());
+            request_.set_version_minor(parser_.version_minor());
             new_start = boost::end(result_range);
             partial_parsed.clear();
           } else {
@@ -175,16 +167,24 @@ class sync_server_connection : public boost::enable_shared_from_this<sync_server
             client_error();
             break;
           } else if (parsed_ok == true) {
-            partial_parsed.append(
-              boost::begin(result_range),
-              boost::end(result_range));
-            std::vector<std::pair<std::string, std::string> > headers;
-            parse_headers(partial_parsed, headers);
-            for (std::vector<std::pair<std::string, std::string> >::const_iterator it = headers.begin();
-               it != headers.end();
+            // Header spans index into the header block, which is still in
+            // the read buffer unless it took more than one read to arrive.
+            char const * block = &*input_range.begin();
+            if (!partial_parsed.empty()) {
+              partial_parsed.append(
+                boost::begin(result_range),
+                boost::end(result_range));
+              block = partial_parsed.data();
+            }
+            typedef std::vector<request_parser::header_span> header_spans;
+            header_spans const & spans = parser_.header_spans();
+            for (header_spans::const_iterator it = spans.begin();
+               it != spans.end();
                ++it) {
-            request_.append_header(it->first, it->second);
+            request_.append_header(std::string(block + it->name_begin, block + it->name_end),
+                                   std::string(block + it->value_begin, block + it->value_end));
             }
+            partial_parsed.clear();
             new_start = boost::end(result_range);
             if (read_body_) {
             } else {
@@ -0,0 +1,190 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_IMPL_REQUEST_SCAN_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_SERVER_IMPL_REQUEST_SCAN_HPP_20121018
+
+#include <string>
+
+// Defining NETWORK_HTTP_NO_SIMD keeps the request parser on its byte-at-a-time
+// scanner, which is also what non-x86 targets get.
+#if !defined(NETWORK_HTTP_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define NETWORK_HTTP_SCAN_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER)
+#define NETWORK_HTTP_SCAN_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace network { namespace http { namespace impl {
+
+// Character classes used by request_parser. They follow the classic "C"
+// locale, so bytes outside of ASCII are neither control, space, nor
+// printable characters.
+inline bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+inline bool is_alnum(char c) {
+  return is_digit(c) || is_upper(c) || (c >= 'a' && c <= 'z');
+}
+inline bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+inline bool is_cntrl(char c) {
+  return static_cast<unsigned char>(c) < 0x20 || c == 0x7f;
+}
+// Alphanumeric or punctuation, i.e. any visible ASCII character.
+inline bool is_graph(char c) { return c > 0x20 && c < 0x7f; }
+inline char to_lower(char c) { return is_upper(c) ? c - 'A' + 'a' : c; }
+
+// Whether [begin, end) is the lower-case `token`, ignoring the case of the
+// letters there.
+inline bool equals_token(char const *begin, char const *end, char const *token) {
+  for (; begin != end && *token; ++begin, ++token)
+    if (to_lower(*begin) != *token) return false;
+  return begin == end && !*token;
+}
+
+// Whether the lower-case `token` occurs in [begin, end), ignoring the case
+// of the letters there. Header values are ASCII, so this needs no locale.
+inline bool contains_token(char const *begin, char const *end, char const *token) {
+  std::size_t const size = std::char_traits<char>::length(token);
+  for (; static_cast<std::size_t>(end - begin) >= size; ++begin) {
+    std::size_t matched = 0;
+    while (matched != size && to_lower(begin[matched]) == token[matched]) ++matched;
+    if (matched == size) return true;
+  }
+  return false;
+}
+
+// The runs of bytes that leave the parser in the same state: request URI
+// characters, header name characters, and header value characters.
+enum scan_kind { scan_uri, scan_header_name, scan_header_value };
+
+inline bool in_run(scan_kind kind, char c) {
+  switch (kind) {
+    case scan_uri: return !is_cntrl(c) && !is_space(c);
+    case scan_header_name: return c != ':' && is_graph(c);
+    case scan_header_value: return !is_cntrl(c);
+  }
+  return false;
+}
+
+inline char const * scan_scalar(scan_kind kind, char const *begin, char const *end) {
+  while (begin != end && in_run(kind, *begin)) ++begin;
+  return begin;
+}
+
+#if defined(NETWORK_HTTP_SCAN_SSE2)
+// Returns a mask with the bits of the bytes in `block` that end the run set.
+inline unsigned scan_block_sse2(scan_kind kind, __m128i block) {
+  __m128i const del = _mm_set1_epi8(0x7f);
+  __m128i in_run;
+  if (kind == scan_header_name) {
+    // As signed bytes, only 0x21-0x7f compare greater than ' '.
+    in_run = _mm_andnot_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, del),
+                     _mm_cmpeq_epi8(block, _mm_set1_epi8(':'))),
+        _mm_cmpgt_epi8(block, _mm_set1_epi8(' ')));
+  } else {
+    // Unsigned comparison against the smallest byte that stays in the run.
+    __m128i const low = _mm_set1_epi8(kind == scan_uri ? 0x21 : 0x20);
+    in_run = _mm_andnot_si128(
+        _mm_cmpeq_epi8(block, del),
+        _mm_cmpeq_epi8(_mm_max_epu8(block, low), block));
+  }
+  return ~static_cast<unsigned>(_mm_movemask_epi8(in_run)) & 0xffffu;
+}
+
+inline char const * scan_sse2(scan_kind kind, char const *begin, char const *end) {
+  while (end - begin >= 16) {
+    unsigned mask = scan_block_sse2(
+        kind, _mm_loadu_si128(reinterpret_cast<__m128i const *>(begin)));
+    if (mask) return begin + __builtin_ctz(mask);
+    begin += 16;
+  }
+  return scan_scalar(kind, begin, end);
+}
+#endif
+
+#if defined(NETWORK_HTTP_SCAN_AVX2)
+__attribute__((target("avx2")))
+inline char const * scan_avx2(scan_kind kind, char const *begin, char const *end) {
+  __m256i const del = _mm256_set1_epi8(0x7f);
+  __m256i const colon = _mm256_set1_epi8(':');
+  __m256i const space = _mm256_set1_epi8(' ');
+  __m256i const low = _mm256_set1_epi8(kind == scan_uri ? 0x21 : 0x20);
+  while (end - begin >= 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin));
+    __m256i in_run;
+    if (kind == scan_header_name) {
+      in_run = _mm256_andnot_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(block, del),
+                          _mm256_cmpeq_epi8(block, colon)),
+          _mm256_cmpgt_epi8(block, space));
+    } else {
+      in_run = _mm256_andnot_si256(
+          _mm256_cmpeq_epi8(block, del),
+          _mm256_cmpeq_epi8(_mm256_max_epu8(block, low), block));
+    }
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(in_run));
+    if (mask) return begin + __builtin_ctz(mask);
+    begin += 32;
+  }
+  return scan_sse2(kind, begin, end);
+}
+#endif
+
+typedef char const * (*scan_function)(scan_kind, char const *, char const *);
+
+// Picks the widest scanner the CPU supports, once.
+inline scan_function select_scan() {
+#if defined(NETWORK_HTTP_SCAN_AVX2)
+  if (__builtin_cpu_supports("avx2")) return &scan_avx2;
+#endif
+#if defined(NETWORK_HTTP_SCAN_SSE2)
+  return &scan_sse2;
+#else
+  return &scan_scalar;
+#endif
+}
+
+// Returns the first position in [begin, end) that does not continue a run
+// of the given kind.
+inline char const * scan_run(scan_kind kind, char const *begin, char const *end) {
+  static scan_function const scan = select_scan();
+  return scan(kind, begin, end);
+}
+
+inline char * scan_run(scan_kind kind, char *begin, char *end) {
+  return begin + (scan_run(kind, static_cast<char const *>(begin), end) - begin);
+}
+
+inline std::string::const_iterator scan_run(scan_kind kind,
+                                            std::string::const_iterator begin,
+                                            std::string::const_iterator end) {
+  if (begin == end) return begin;
+  char const *first = &*begin;
+  return begin + (scan_run(kind, first, first + (end - begin)) - first);
+}
+
+inline std::string::iterator scan_run(scan_kind kind,
+                                      std::string::iterator begin,
+                                      std::string::iterator end) {
+  if (begin == end) return begin;
+  char const *first = &*begin;
+  return begin + (scan_run(kind, first, first + (end - begin)) - first);
+}
+
+// Iterators over storage that is not known to be contiguous go byte by byte.
+template <class Iterator>
+Iterator scan_run(scan_kind kind, Iterator begin, Iterator end) {
+  while (begin != end && in_run(kind, *begin)) ++begin;
+  return begin;
+}
+
+}  // namespace impl
+}  // namespace http
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_IMPL_REQUEST_SCAN_HPP_20121018
@@ -17,6 +17,7 @@ class socket_options_setter {
  protected:
   void set_socket_options(server_options const &options, boost::asio::ip::tcp::socket &socket);
   void set_acceptor_options(server_options const &options, boost::asio::ip::tcp::acceptor &acceptor);
+  static bool reuse_port_supported();
 };
 
 }  // namespace http
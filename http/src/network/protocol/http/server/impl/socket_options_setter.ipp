@@ -9,9 +9,22 @@
 
 #include <network/protocol/http/server/impl/socket_options_setter.hpp>
 #include <network/protocol/http/server/options.hpp>
+#include <boost/asio/detail/socket_option.hpp>
 
 namespace network { namespace http {
 
+#ifdef SO_REUSEPORT
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port_option;
+#endif
+
+bool socket_options_setter::reuse_port_supported() {
+#ifdef SO_REUSEPORT
+  return true;
+#else
+  return false;
+#endif
+}
+
 void socket_options_setter::set_socket_options(server_options const & options, boost::asio::ip::tcp::socket &socket) {
   boost::system::error_code ignored;
   socket.non_blocking(options.non_blocking_io(), ignored);
@@ -45,6 +58,10 @@ void socket_options_setter::set_acceptor_options(server_options const &options,
   acceptor.set_option(
       boost::asio::ip::tcp::acceptor::enable_connection_aborted(options.report_aborted()),
       ignored);
+#ifdef SO_REUSEPORT
+  if (options.reuse_port() && options.reactors() > 1)
+    acceptor.set_option(reuse_port_option(true), ignored);
+#endif
 }
 
 }  // namespace http
@@ -8,6 +8,7 @@
 #define NETWORK_PROTOCOL_HTTP_SERVER_OPTIONS_HPP_20120318
 
 #include <string>
+#include <cstddef>
 
 namespace boost { namespace asio {
 
@@ -71,6 +72,61 @@ class server_options {
   server_options& linger_timeout(int setting);
   int linger_timeout() const;
 
+  // Set the number of idle connection objects the server keeps around for
+  // reuse by later accepted sockets. 0 (the default) disables pooling.
+  server_options& connection_pool_size(std::size_t size);
+  std::size_t connection_pool_size() const;
+
+  // Set the number of reactors the asynchronous server runs. Each reactor
+  // has its own io_service and thread, and connections stay on the reactor
+  // they were handed to. 1 (the default) runs everything on a single
+  // io_service as before.
+  server_options& reactors(std::size_t count);
+  std::size_t reactors() const;
+
+  // With more than one reactor, give each reactor its own acceptor bound
+  // with SO_REUSEPORT and let the kernel spread incoming connections. When
+  // false (the default), or when the platform lacks SO_REUSEPORT, a single
+  // acceptor hands accepted sockets to the reactors in round-robin order.
+  server_options& reuse_port(bool setting);
+  bool reuse_port() const;
+
+  // Set the number of accepts each acceptor keeps outstanding at once, so
+  // that bursts of new connections do not wait on a single accept handler.
+  // The default is 1.
+  server_options& pending_accepts(std::size_t count);
+  std::size_t pending_accepts() const;
+
+  // Set the maximum number of connections accepted per wakeup. Values above
+  // 1 (the default) make the acceptor drain its backlog with non-blocking
+  // accepts after each completed asynchronous one.
+  server_options& accept_batch_size(std::size_t count);
+  std::size_t accept_batch_size() const;
+
+  // Set how long, in milliseconds, an acceptor waits before accepting again
+  // after running out of file descriptors or memory (EMFILE, ENFILE,
+  // ENOBUFS, ENOMEM). The default is 100.
+  server_options& accept_retry_delay(int milliseconds);
+  int accept_retry_delay() const;
+
+  // Connection timeouts for the asynchronous server, in milliseconds. 0 (the
+  // default) disables the respective timeout. The idle timeout applies while
+  // a persistent connection waits for its next request, the header read
+  // timeout while a request line and headers are coming in, the body read
+  // timeout to each read() a handler makes, and the write timeout to
+  // outstanding response writes. A connection that times out is closed.
+  server_options& idle_timeout(int milliseconds);
+  int idle_timeout() const;
+
+  server_options& header_read_timeout(int milliseconds);
+  int header_read_timeout() const;
+
+  server_options& body_read_timeout(int milliseconds);
+  int body_read_timeout() const;
+
+  server_options& write_timeout(int milliseconds);
+  int write_timeout() const;
+
  private:
   server_options_pimpl *pimpl_;
 };
@@ -23,10 +23,20 @@ class server_options_pimpl {
   , receive_low_watermark_(-1)
   , send_low_watermark_(-1)
   , linger_timeout_(30)
+  , idle_timeout_(0)
+  , header_read_timeout_(0)
+  , body_read_timeout_(0)
+  , write_timeout_(0)
+  , accept_retry_delay_(100)
+  , connection_pool_size_(0)
+  , reactors_(1)
+  , pending_accepts_(1)
+  , accept_batch_size_(1)
   , reuse_address_(false)
   , report_aborted_(false)
   , non_blocking_io_(true)
   , linger_(false)
+  , reuse_port_(false)
   {}
 
   server_options_pimpl *clone() const {
@@ -129,14 +139,97 @@ class server_options_pimpl {
     return linger_timeout_;
   }
 
+  void connection_pool_size(std::size_t size) {
+    connection_pool_size_ = size;
+  }
+
+  std::size_t connection_pool_size() const {
+    return connection_pool_size_;
+  }
+
+  void reactors(std::size_t count) {
+    reactors_ = count;
+  }
+
+  std::size_t reactors() const {
+    return reactors_;
+  }
+
+  void reuse_port(bool setting) {
+    reuse_port_ = setting;
+  }
+
+  bool reuse_port() const {
+    return reuse_port_;
+  }
+
+  void pending_accepts(std::size_t count) {
+    pending_accepts_ = count;
+  }
+
+  std::size_t pending_accepts() const {
+    return pending_accepts_;
+  }
+
+  void accept_batch_size(std::size_t count) {
+    accept_batch_size_ = count;
+  }
+
+  std::size_t accept_batch_size() const {
+    return accept_batch_size_;
+  }
+
+  void accept_retry_delay(int milliseconds) {
+    accept_retry_delay_ = milliseconds;
+  }
+
+  int accept_retry_delay() const {
+    return accept_retry_delay_;
+  }
+
+  void idle_timeout(int milliseconds) {
+    idle_timeout_ = milliseconds;
+  }
+
+  int idle_timeout() const {
+    return idle_timeout_;
+  }
+
+  void header_read_timeout(int milliseconds) {
+    header_read_timeout_ = milliseconds;
+  }
+
+  int header_read_timeout() const {
+    return header_read_timeout_;
+  }
+
+  void body_read_timeout(int milliseconds) {
+    body_read_timeout_ = milliseconds;
+  }
+
+  int body_read_timeout() const {
+    return body_read_timeout_;
+  }
+
+  void write_timeout(int milliseconds) {
+    write_timeout_ = milliseconds;
+  }
+
+  int write_timeout() const {
+    return write_timeout_;
+  }
+
  private:
   std::string address_, port_;
   boost::asio::io_service *io_service_;
   int receive_buffer_size_, send_buffer_size_,
       receive_low_watermark_, send_low_watermark_,
-      linger_timeout_;
+      linger_timeout_, idle_timeout_, header_read_timeout_,
+      body_read_timeout_, write_timeout_, accept_retry_delay_;
+  std::size_t connection_pool_size_, reactors_, pending_accepts_,
+      accept_batch_size_;
   bool reuse_address_, report_aborted_,
-       non_blocking_io_, linger_;
+       non_blocking_io_, linger_, reuse_port_;
 
   server_options_pimpl(server_options_pimpl const &other)
   : address_(other.address_)
@@ -147,10 +240,20 @@ class server_options_pimpl {
   , receive_low_watermark_(other.receive_low_watermark_)
   , send_low_watermark_(other.send_low_watermark_)
   , linger_timeout_(other.linger_timeout_)
+  , idle_timeout_(other.idle_timeout_)
+  , header_read_timeout_(other.header_read_timeout_)
+  , body_read_timeout_(other.body_read_timeout_)
+  , write_timeout_(other.write_timeout_)
+  , accept_retry_delay_(other.accept_retry_delay_)
+  , connection_pool_size_(other.connection_pool_size_)
+  , reactors_(other.reactors_)
+  , pending_accepts_(other.pending_accepts_)
+  , accept_batch_size_(other.accept_batch_size_)
   , reuse_address_(other.reuse_address_)
   , report_aborted_(other.report_aborted_)
   , non_blocking_io_(other.non_blocking_io_)
-  , linger_(other.linger_) {}
+  , linger_(other.linger_)
+  , reuse_port_(other.reuse_port_) {}
 
 };
 
@@ -283,6 +386,96 @@ int server_options::linger_timeout() const {
   return pimpl_->linger_timeout();
 }
 
+server_options& server_options::connection_pool_size(std::size_t size) {
+  pimpl_->connection_pool_size(size);
+  return *this;
+}
+
+std::size_t server_options::connection_pool_size() const {
+  return pimpl_->connection_pool_size();
+}
+
+server_options& server_options::reactors(std::size_t count) {
+  pimpl_->reactors(count);
+  return *this;
+}
+
+std::size_t server_options::reactors() const {
+  return pimpl_->reactors();
+}
+
+server_options& server_options::reuse_port(bool setting) {
+  pimpl_->reuse_port(setting);
+  return *this;
+}
+
+bool server_options::reuse_port() const {
+  return pimpl_->reuse_port();
+}
+
+server_options& server_options::pending_accepts(std::size_t count) {
+  pimpl_->pending_accepts(count);
+  return *this;
+}
+
+std::size_t server_options::pending_accepts() const {
+  return pimpl_->pending_accepts();
+}
+
+server_options& server_options::accept_batch_size(std::size_t count) {
+  pimpl_->accept_batch_size(count);
+  return *this;
+}
+
+std::size_t server_options::accept_batch_size() const {
+  return pimpl_->accept_batch_size();
+}
+
+server_options& server_options::accept_retry_delay(int milliseconds) {
+  pimpl_->accept_retry_delay(milliseconds);
+  return *this;
+}
+
+int server_options::accept_retry_delay() const {
+  return pimpl_->accept_retry_delay();
+}
+
+server_options& server_options::idle_timeout(int milliseconds) {
+  pimpl_->idle_timeout(milliseconds);
+  return *this;
+}
+
+int server_options::idle_timeout() const {
+  return pimpl_->idle_timeout();
+}
+
+server_options& server_options::header_read_timeout(int milliseconds) {
+  pimpl_->header_read_timeout(milliseconds);
+  return *this;
+}
+
+int server_options::header_read_timeout() const {
+  return pimpl_->header_read_timeout();
+}
+
+server_options& server_options::body_read_timeout(int milliseconds) {
+  pimpl_->body_read_timeout(milliseconds);
+  return *this;
+}
+
+int server_options::body_read_timeout() const {
+  return pimpl_->body_read_timeout();
+}
+
+server_options& server_options::write_timeout(int milliseconds) {
+  pimpl_->write_timeout(milliseconds);
+  return *this;
+}
+
+int server_options::write_timeout() const {
+  return pimpl_->write_timeout();
+}
+
 }  // namespace http
 
 }  // namespace network
@@ -7,11 +7,13 @@
 #ifndef NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_PARSER_HPP_20101005
 #define NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_PARSER_HPP_20101005
 
+#include <iterator>
 #include <utility>
+#include <vector>
 #include <boost/range/iterator_range.hpp>
 #include <boost/logic/tribool.hpp>
 #include <boost/fusion/tuple.hpp>
-#include <boost/algorithm/string/classification.hpp>
+#include <network/protocol/http/server/impl/request_scan.hpp>
 
 namespace network { namespace http {
 
@@ -42,16 +44,53 @@ namespace network { namespace http {
             , headers_done
         };
 
+        // The location of one header line within the header block, which
+        // starts right after the request line's CRLF. Offsets count bytes
+        // from the start of that block, across all the calls to parse_until
+        // that it took to get through it.
+        struct header_span {
+            std::size_t name_begin, name_end, value_begin, value_end;
+        };
+
         explicit request_parser(state_t start_state = method_start)
         : internal_state(start_state)
+        , offset_(0)
+        , method_end_(0)
+        , uri_begin_(0)
+        , uri_end_(0)
+        , headers_begin_(0)
+        , version_major_(0)
+        , version_minor_(0)
+        , header_spans_()
         {}
 
         void reset(state_t start_state = method_start) {
             internal_state = method_start;
+            offset_ = method_end_ = uri_begin_ = uri_end_ = headers_begin_ = 0;
+            version_major_ = version_minor_ = 0;
+            // Keeps the capacity, so a connection stops allocating here once
+            // it has seen its largest request.
+            header_spans_.clear();
         }
 
         state_t state() const { return internal_state; }
 
+        // Where the method and the URI end up in the request, counting bytes
+        // from its first one, and where the header block starts. Each is set
+        // once the parser has gone past it.
+        std::size_t method_end() const { return method_end_; }
+        std::size_t uri_begin() const { return uri_begin_; }
+        std::size_t uri_end() const { return uri_end_; }
+        std::size_t headers_begin() const { return headers_begin_; }
+
+        // The HTTP version, once the parser is past version_d2.
+        unsigned short version_major() const { return version_major_; }
+        unsigned short version_minor() const { return version_minor_; }
+
+        // The headers found so far. A span is complete once the parser has
+        // moved past its header_cr.
+        std::vector<header_span> const & header_spans() const { return header_spans_; }
+
         template <class Range>
         boost::fusion::tuple<boost::logic::tribool, boost::iterator_range<typename Range::const_iterator> >
         parse_until(state_t stop_state, Range & range) {
@@ -62,30 +101,52 @@ namespace network { namespace http {
                     , current_iterator = start;
             boost::iterator_range<iterator> local_range = 
                 boost::make_iterator_range(start, end);
+            std::size_t const base = offset_;
             while (
                 !boost::empty(local_range)
                 && stop_state != internal_state
                 && indeterminate(parsed_ok)
             ) {
                 current_iterator = boost::begin(local_range);
+                // Bytes that continue a URI, header name, or header value do
+                // not change the state, so runs of them are skipped in bulk.
+                if (internal_state == uri_char
+                    || internal_state == header_name
+                    || internal_state == header_value) {
+                    current_iterator = impl::scan_run(
+                        internal_state == uri_char ? impl::scan_uri
+                        : internal_state == header_name ? impl::scan_header_name
+                        : impl::scan_header_value,
+                        current_iterator, end);
+                    if (current_iterator == end) break;
+                }
                 switch(internal_state) {
                     case method_start:
-                        if (boost::algorithm::is_upper()(*current_iterator)) internal_state = method_char;
+                        if (impl::is_upper(*current_iterator)) internal_state = method_char;
                         else parsed_ok = false;
                         break;
                     case method_char:
-                        if (boost::algorithm::is_upper()(*current_iterator)) break;
-                        else if (boost::algorithm::is_space()(*current_iterator)) internal_state = method_done;
+                        if (impl::is_upper(*current_iterator)) break;
+                        else if (impl::is_space(*current_iterator)) {
+                            method_end_ = base + std::distance(start, current_iterator);
+                            internal_state = method_done;
+                        }
                         else parsed_ok = false;
                         break;
                     case method_done:
-                        if (boost::algorithm::is_cntrl()(*current_iterator)) parsed_ok = false;
-                        else if (boost::algorithm::is_space()(*current_iterator)) parsed_ok = false;
-                        else internal_state = uri_char;
+                        if (impl::is_cntrl(*current_iterator)) parsed_ok = false;
+                        else if (impl::is_space(*current_iterator)) parsed_ok = false;
+                        else {
+                            uri_begin_ = base + std::distance(start, current_iterator);
+                            internal_state = uri_char;
+                        }
                         break;
                     case uri_char:
-                        if (boost::algorithm::is_cntrl()(*current_iterator)) parsed_ok = false;
-                        else if (boost::algorithm::is_space()(*current_iterator)) internal_state = uri_done;
+                        if (impl::is_cntrl(*current_iterator)) parsed_ok = false;
+                        else if (impl::is_space(*current_iterator)) {
+                            uri_end_ = base + std::distance(start, current_iterator);
+                            internal_state = uri_done;
+                        }
                         break;
                     case uri_done:
                         if (*current_iterator == 'H') internal_state = version_h;
@@ -108,7 +169,10 @@ namespace network { namespace http {
                         else parsed_ok = false;
                         break;
                     case version_slash:
-                        if (boost::algorithm::is_digit()(*current_iterator)) internal_state = version_d1;
+                        if (impl::is_digit(*current_iterator)) {
+                            version_major_ = *current_iterator - '0';
+                            internal_state = version_d1;
+                        }
                         else parsed_ok = false;
                         break;
                     case version_d1:
@@ -116,7 +180,10 @@ namespace network { namespace http {
                         else parsed_ok = false;
                         break;
                     case version_dot:
-                        if (boost::algorithm::is_digit()(*current_iterator)) internal_state = version_d2;
+                        if (impl::is_digit(*current_iterator)) {
+                            version_minor_ = *current_iterator - '0';
+                            internal_state = version_d2;
+                        }
                         else parsed_ok = false;
                         break;
                     case version_d2:
@@ -124,26 +191,44 @@ namespace network { namespace http {
                         else parsed_ok = false;
                         break;
                     case version_cr:
-                        if (*current_iterator == '\n') internal_state = version_done;
+                        if (*current_iterator == '\n') {
+                            headers_begin_ = base + std::distance(start, current_iterator) + 1;
+                            internal_state = version_done;
+                        }
                         else parsed_ok = false;
                         break;
                     case version_done:
-                        if (boost::algorithm::is_alnum()(*current_iterator)) internal_state = header_name;
+                        if (impl::is_alnum(*current_iterator)) {
+                            begin_header(base + std::distance(start, current_iterator));
+                            internal_state = header_name;
+                        }
                         else if (*current_iterator == '\r') internal_state = headers_cr;
                         else parsed_ok = false;
                         break;
                     case header_name:
-                        if (*current_iterator == ':') internal_state = header_colon;
-                        else if (boost::algorithm::is_alnum()(*current_iterator) || boost::algorithm::is_punct()(*current_iterator)) break;
+                        if (*current_iterator == ':') {
+                            header_spans_.back().name_end =
+                                base + std::distance(start, current_iterator) - headers_begin_;
+                            internal_state = header_colon;
+                        }
+                        else if (impl::is_graph(*current_iterator)) break;
                         else parsed_ok = false;
                         break;
                     case header_colon:
-                        if (*current_iterator == ' ') internal_state = header_value;
+                        if (*current_iterator == ' ') {
+                            header_spans_.back().value_begin =
+                                base + std::distance(start, current_iterator) + 1 - headers_begin_;
+                            internal_state = header_value;
+                        }
                         else parsed_ok = false;
                         break;
                     case header_value:
-                        if (*current_iterator == '\r') internal_state = header_cr;
-                        else if (boost::algorithm::is_cntrl()(*current_iterator)) parsed_ok = false;
+                        if (*current_iterator == '\r') {
+                            header_spans_.back().value_end =
+                                base + std::distance(start, current_iterator) - headers_begin_;
+                            internal_state = header_cr;
+                        }
+                        else if (impl::is_cntrl(*current_iterator)) parsed_ok = false;
                         break;
                     case header_cr:
                         if (*current_iterator == '\n') internal_state = header_line_done;
@@ -151,7 +236,10 @@ namespace network { namespace http {
                         break;
                     case header_line_done:
                         if (*current_iterator == '\r') internal_state = headers_cr;
-                        else if (boost::algorithm::is_alnum()(*current_iterator)) internal_state = header_name;
+                        else if (impl::is_alnum(*current_iterator)) {
+                            begin_header(base + std::distance(start, current_iterator));
+                            internal_state = header_name;
+                        }
                         else parsed_ok = false;
                         break;
                     case headers_cr:
@@ -168,6 +256,7 @@ namespace network { namespace http {
                 local_range = boost::make_iterator_range(
                     ++current_iterator, end);
             }
+            offset_ = base + std::distance(start, current_iterator);
             return boost::fusion::make_tuple(
                 parsed_ok, 
                 boost::make_iterator_range(
@@ -177,7 +266,15 @@ namespace network { namespace http {
         }
 
     private:
+        void begin_header(std::size_t position) {
+            header_span span = { position - headers_begin_, 0, 0, 0 };
+            header_spans_.push_back(span);
+        }
+
         state_t internal_state;
+        std::size_t offset_, method_end_, uri_begin_, uri_end_, headers_begin_;
+        unsigned short version_major_, version_minor_;
+        std::vector<header_span> header_spans_;
 
     };
     
@@ -0,0 +1,71 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_VIEW_HPP_20121018
+#define NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_VIEW_HPP_20121018
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/range/iterator_range.hpp>
+
+namespace network { namespace http {
+
+struct request;
+
+class async_server_connection;
+
+// A read-only view of a request received by the asynchronous server. The
+// method, destination, source and headers are ranges over storage owned by
+// the connection, so handing a request_view to a handler allocates nothing
+// once the connection has warmed up.
+//
+// A request_view is only valid for the duration of the handler call it was
+// passed to. Handlers that need the request afterwards -- for instance
+// because they respond from another thread -- take a copy with to_request().
+class request_view {
+ public:
+  typedef boost::iterator_range<char const *> string_range;
+
+  struct header {
+    string_range name, value;
+  };
+
+  typedef std::vector<header> headers_type;
+
+  request_view();
+
+  string_range method() const { return method_; }
+  string_range destination() const { return destination_; }
+  string_range source() const { return source_; }
+  unsigned short version_major() const { return version_major_; }
+  unsigned short version_minor() const { return version_minor_; }
+
+  // Headers in the order they were received.
+  headers_type const & headers() const { return headers_; }
+
+  // The value of the first header with the given name, compared without
+  // regard to case. Returns an empty range if there is no such header.
+  string_range header_value(string_range name) const;
+  string_range header_value(char const *name) const;
+
+  // Copies everything into an owning request.
+  request to_request() const;
+
+ private:
+  friend class async_server_connection;
+
+  void clear();
+
+  string_range method_, destination_, source_;
+  unsigned short version_major_, version_minor_;
+  headers_type headers_;
+};
+
+}  // namespace http
+
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_VIEW_HPP_20121018
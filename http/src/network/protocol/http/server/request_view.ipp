@@ -0,0 +1,76 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_VIEW_IPP_20121018
+#define NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_VIEW_IPP_20121018
+
+#include <network/protocol/http/server/request_view.hpp>
+#include <network/protocol/http/request.hpp>
+#include <network/protocol/http/server/impl/request_scan.hpp>
+#include <cstring>
+
+namespace network { namespace http {
+
+namespace {
+
+  // Header names are ASCII, so this skips the locale that
+  // boost::iequals would construct on every call.
+  bool same_name(request_view::string_range name, request_view::string_range other) {
+    if (name.size() != other.size()) return false;
+    for (char const *c = name.begin(), *o = other.begin(); c != name.end(); ++c, ++o)
+      if (impl::to_lower(*c) != impl::to_lower(*o)) return false;
+    return true;
+  }
+
+}  // namespace
+
+request_view::request_view()
+: method_()
+, destination_()
+, source_()
+, version_major_(0)
+, version_minor_(0)
+, headers_()
+{}
+
+request_view::string_range request_view::header_value(string_range name) const {
+  for (headers_type::const_iterator it = headers_.begin();
+       it != headers_.end();
+       ++it)
+    if (same_name(it->name, name)) return it->value;
+  return string_range();
+}
+
+request_view::string_range request_view::header_value(char const *name) const {
+  return header_value(string_range(name, name + std::strlen(name)));
+}
+
+request request_view::to_request() const {
+  request copy;
+  copy.set_method(std::string(method_.begin(), method_.end()));
+  copy.set_destination(std::string(destination_.begin(), destination_.end()));
+  copy.set_source(std::string(source_.begin(), source_.end()));
+  copy.set_version_major(version_major_);
+  copy.set_version_minor(version_minor_);
+  for (headers_type::const_iterator it = headers_.begin();
+       it != headers_.end();
+       ++it)
+    copy.append_header(std::string(it->name.begin(), it->name.end()),
+                       std::string(it->value.begin(), it->value.end()));
+  return copy;
+}
+
+void request_view::clear() {
+  method_ = destination_ = source_ = string_range();
+  version_major_ = version_minor_ = 0;
+  // Keeps the capacity for the connection's next request.
+  headers_.clear();
+}
+
+}  // namespace http
+
+}  // namespace network
+
+#endif  // NETWORK_PROTOCOL_HTTP_SERVER_REQUEST_VIEW_IPP_20121018
@@ -10,6 +10,10 @@
 #include <network/protocol/http/server/options.hpp>
 #include <network/protocol/http/server/sync_impl.hpp>
 #include <network/protocol/http/server/async_impl.hpp>
+#include <network/protocol/http/server/request_view.hpp>
+#include <functional>
+#include <memory>
+#include <type_traits>
 
 namespace network { namespace http {
 
@@ -38,9 +42,48 @@ sync_server<SyncHandler>::~sync_server() {
   delete pimpl_;
 }
 
+namespace impl {
+
+template <class Handler>
+struct is_request_view_handler {
+  template <class H>
+  static std::true_type test(decltype(std::declval<H &>()(
+      std::declval<request_view const &>(),
+      std::declval<std::shared_ptr<async_server_connection> >())) *);
+  template <class H>
+  static std::false_type test(...);
+  typedef decltype(test<Handler>(0)) type;
+};
+
+template <class AsyncHandler>
+async_server_impl * make_async_server_impl(server_options const &options,
+                                           AsyncHandler &handler,
+                                           utils::thread_pool &pool,
+                                           std::true_type) {
+  return new async_server_impl(
+      options,
+      std::function<void(request_view const &, std::shared_ptr<async_server_connection>)>(handler),
+      pool);
+}
+
+template <class AsyncHandler>
+async_server_impl * make_async_server_impl(server_options const &options,
+                                           AsyncHandler &handler,
+                                           utils::thread_pool &pool,
+                                           std::false_type) {
+  return new async_server_impl(
+      options,
+      std::function<void(request const &, std::shared_ptr<async_server_connection>)>(handler),
+      pool);
+}
+
+}  // namespace impl
+
 template <class AsyncHandler>
 async_server<AsyncHandler>::async_server(server_options const &options, AsyncHandler &handler, utils::thread_pool &pool)
-: pimpl_(new async_server_impl(options, handler, pool))
+: pimpl_(impl::make_async_server_impl(
+      options, handler, pool,
+      typename impl::is_request_view_handler<AsyncHandler>::type()))
 {}
 
 template <class AsyncHandler>
@@ -58,6 +101,16 @@ void async_server<AsyncHandler>::listen() {
   pimpl_->listen();
 }
 
+template <class AsyncHandler>
+std::size_t async_server<AsyncHandler>::connection_pool_hits() const {
+  return pimpl_->connection_pool_hits();
+}
+
+template <class AsyncHandler>
+std::size_t async_server<AsyncHandler>::connection_pool_misses() const {
+  return pimpl_->connection_pool_misses();
+}
+
 template <class SyncHandler>
 async_server<SyncHandler>::~async_server() {
   delete pimpl_;
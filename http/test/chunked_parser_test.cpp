@@ -0,0 +1,99 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Chunked Parser Test
+#include <boost/config/warning_disable.hpp>
+#include <boost/test/unit_test.hpp>
+#include <network/protocol/http/parser/chunked.hpp>
+#include <string>
+
+namespace http = network::http;
+namespace logic = boost::logic;
+namespace fusion = boost::fusion;
+
+namespace {
+
+// Feeds the input to the parser in pieces of at most `step` bytes and
+// collects the decoded body, the way a connection would as data arrives.
+logic::tribool decode(http::chunked_parser &parser,
+                      std::string const &input,
+                      std::size_t step,
+                      std::string &body) {
+  std::string::const_iterator current = input.begin();
+  logic::tribool result = logic::indeterminate;
+  while (current != input.end()) {
+    std::size_t available = input.end() - current;
+    std::string::const_iterator end = current + (available < step ? available : step);
+    while (current != end) {
+      boost::iterator_range<std::string::const_iterator> data;
+      fusion::tie(result, current, data) = parser.parse(current, end);
+      body.append(data.begin(), data.end());
+      if (!logic::indeterminate(result)) return result;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(chunked_parser_single_pass) {
+  http::chunked_parser parser;
+  std::string body;
+  logic::tribool result = decode(
+      parser, "5\r\nHello\r\n7;ext=1\r\n, World\r\n0\r\n\r\n", 1024, body);
+  BOOST_CHECK(bool(result));
+  BOOST_CHECK_EQUAL(body, "Hello, World");
+  BOOST_CHECK(parser.trailers().empty());
+}
+
+BOOST_AUTO_TEST_CASE(chunked_parser_byte_at_a_time) {
+  http::chunked_parser parser;
+  std::string body;
+  logic::tribool result = decode(
+      parser, "1a\r\nabcdefghijklmnopqrstuvwxyz\r\n0\r\nX-Checksum: 42\r\n\r\n", 1, body);
+  BOOST_CHECK(bool(result));
+  BOOST_CHECK_EQUAL(body, "abcdefghijklmnopqrstuvwxyz");
+  BOOST_CHECK_EQUAL(parser.trailers(), "X-Checksum: 42\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(chunked_parser_stops_at_end_of_body) {
+  http::chunked_parser parser;
+  std::string input = "3\r\nabc\r\n0\r\n\r\nGET / HTTP/1.1\r\n";
+  std::string::const_iterator current = input.begin();
+  logic::tribool result = logic::indeterminate;
+  std::string body;
+  while (logic::indeterminate(result)) {
+    boost::iterator_range<std::string::const_iterator> data;
+    fusion::tie(result, current, data) = parser.parse(current, input.cend());
+    body.append(data.begin(), data.end());
+  }
+  BOOST_CHECK(bool(result));
+  BOOST_CHECK_EQUAL(body, "abc");
+  BOOST_CHECK_EQUAL(std::string(current, input.cend()), "GET / HTTP/1.1\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(chunked_parser_rejects_malformed_input) {
+  std::string body;
+  http::chunked_parser bad_size;
+  BOOST_CHECK(bool(!decode(bad_size, "zz\r\n", 16, body)));
+  http::chunked_parser missing_crlf;
+  BOOST_CHECK(bool(!decode(missing_crlf, "3\r\nabcX\r\n0\r\n\r\n", 16, body)));
+  http::chunked_parser overflow;
+  BOOST_CHECK(bool(!decode(overflow, "fffffffffffffffffffff\r\n", 64, body)));
+}
+
+BOOST_AUTO_TEST_CASE(chunked_parser_reset) {
+  http::chunked_parser parser;
+  std::string body;
+  BOOST_CHECK(bool(decode(parser, "0\r\nA: b\r\n\r\n", 16, body)));
+  parser.reset();
+  BOOST_CHECK(parser.trailers().empty());
+  BOOST_CHECK(parser.state() == http::chunked_parser::chunk_size_start);
+  BOOST_CHECK(bool(decode(parser, "2\r\nok\r\n0\r\n\r\n", 16, body)));
+  BOOST_CHECK_EQUAL(body, "ok");
+}
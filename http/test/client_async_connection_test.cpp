@@ -0,0 +1,513 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Client Async Connection Test
+#include <boost/test/unit_test.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <network/protocol/http/client/connection/async_normal.hpp>
+#include <network/protocol/http/client/connection/connection_delegate.hpp>
+#include <network/protocol/http/client/connection/resolver_delegate.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/protocol/http/errors.hpp>
+#include <network/protocol/http/request.hpp>
+#include <network/protocol/http/response.hpp>
+#include <network/protocol/http/response/response_state.hpp>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace http = network::http;
+
+namespace {
+
+// Resolves everything to the loopback address without touching the network.
+struct fake_resolver : http::resolver_delegate {
+  explicit fake_resolver(boost::asio::io_service &service) : service_(service) {}
+  virtual void resolve(std::string const &, uint16_t port,
+                       resolve_completion_function once_resolved) {
+    boost::asio::ip::udp::resolver resolver(service_);
+    boost::asio::ip::udp::resolver::query query("127.0.0.1", "80");
+    resolver_iterator it = resolver.resolve(query);
+    once_resolved(boost::system::error_code(), iterator_pair(it, resolver_iterator()));
+  }
+  virtual void clear_resolved_cache() {}
+  boost::asio::io_service &service_;
+};
+
+// Plays back canned server output. A read with nothing left to hand out
+// either reports the end of the stream, once the server has "closed" the
+// connection, or never completes, like a server waiting for a request.
+struct fake_socket : http::connection_delegate {
+  explicit fake_socket(boost::asio::io_service &service)
+  : service_(service), connects(0), closed(false), disconnected(false) {}
+
+  virtual void connect(boost::asio::ip::tcp::endpoint &, std::string const &,
+                       std::function<void(boost::system::error_code const &)> handler) {
+    ++connects;
+    disconnected = false;
+    service_.post(std::bind(handler, boost::system::error_code()));
+  }
+
+  virtual void write(boost::asio::streambuf &command_streambuf,
+                     std::function<void(boost::system::error_code const &, size_t)> handler) {
+    std::size_t size = command_streambuf.size();
+    writes.push_back(std::string(boost::asio::buffers_begin(command_streambuf.data()),
+                                 boost::asio::buffers_end(command_streambuf.data())));
+    command_streambuf.consume(size);
+    service_.post(std::bind(handler, boost::system::error_code(), size));
+  }
+
+  virtual void read_some(boost::asio::mutable_buffers_1 const &read_buffer,
+                         std::function<void(boost::system::error_code const &, size_t)> handler) {
+    if (output.empty()) {
+      if (closed)
+        service_.post(std::bind(handler, boost::asio::error::eof, 0));
+      return;
+    }
+    std::string piece = output.front();
+    output.pop_front();
+    std::size_t size = boost::asio::buffer_copy(read_buffer, boost::asio::buffer(piece));
+    if (size < piece.size()) output.push_front(piece.substr(size));
+    service_.post(std::bind(handler, boost::system::error_code(), size));
+  }
+
+  virtual bool is_open() { return !disconnected && !closed; }
+  virtual void disconnect() { disconnected = true; }
+
+  // Queues the response, handed out `step` bytes per read.
+  void serve(std::string const &response, std::size_t step = 4096) {
+    for (std::size_t offset = 0; offset < response.size(); offset += step)
+      output.push_back(response.substr(offset, step));
+  }
+
+  boost::asio::io_service &service_;
+  std::deque<std::string> output;
+  std::vector<std::string> writes;
+  int connects;
+  bool closed, disconnected;
+};
+
+struct connection_fixture {
+  connection_fixture()
+  : socket(std::make_shared<fake_socket>(service)),
+    released(false), reusable(false), releases(0) {
+    pipeline(1);
+  }
+
+  void pipeline(std::size_t depth) {
+    connection = std::make_shared<http::http_async_connection>(
+        std::make_shared<fake_resolver>(service), socket, service, false, depth);
+    connection->set_release_callback([this](bool reuse) {
+      released = true;
+      reusable = reuse;
+      ++releases;
+    });
+  }
+
+  http::response send(http::client_connection::callback_type callback =
+                          http::client_connection::callback_type(),
+                      http::request_options const &options = http::request_options()) {
+    released = false;
+    return connection->send_request(
+        "GET", http::request("http://www.example.com/"), true, callback, options);
+  }
+
+  void run() {
+    service.reset();
+    service.run();
+  }
+
+  // Sends a GET and runs the io_service until the connection has nothing
+  // more to do; the response is complete once the connection is released.
+  http::response get(http::client_connection::callback_type callback =
+                         http::client_connection::callback_type()) {
+    http::response response = send(callback);
+    run();
+    return response;
+  }
+
+  std::string body_of(http::response const &response) {
+    BOOST_REQUIRE(released);
+    std::string body;
+    response.get_body(body);
+    return body;
+  }
+
+  boost::asio::io_service service;
+  std::shared_ptr<fake_socket> socket;
+  std::shared_ptr<http::http_async_connection> connection;
+  bool released, reusable;
+  int releases;
+};
+
+std::size_t requests_in(std::string const &written) {
+  std::size_t count = 0;
+  for (std::size_t at = written.find("GET "); at != std::string::npos;
+       at = written.find("GET ", at + 1))
+    ++count;
+  return count;
+}
+
+std::string const length_response =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 13\r\n"
+    "\r\n"
+    "Hello, world!";
+
+std::string const chunked_response =
+    "HTTP/1.1 200 OK\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "5\r\nHello\r\n"
+    "8;name=value\r\n, world!\r\n"
+    "0\r\n"
+    "X-Trailer: 1\r\n"
+    "\r\n";
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_CASE(content_length_ends_the_body, connection_fixture) {
+  for (std::size_t step = 1; step <= length_response.size(); step += 7) {
+    socket->serve(length_response, step);
+    http::response response = get();
+    BOOST_CHECK_EQUAL(body_of(response), "Hello, world!");
+    BOOST_CHECK(reusable);
+  }
+  // The connection was set up once and then reused.
+  BOOST_CHECK_EQUAL(socket->connects, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(chunked_body_is_decoded, connection_fixture) {
+  for (std::size_t step = 1; step <= chunked_response.size(); step += 5) {
+    socket->serve(chunked_response, step);
+    http::response response = get();
+    BOOST_CHECK_EQUAL(body_of(response), "Hello, world!");
+    BOOST_CHECK(reusable);
+  }
+  BOOST_CHECK_EQUAL(socket->connects, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(callback_gets_the_framed_body, connection_fixture) {
+  std::string body;
+  bool ended = false;
+  socket->serve(chunked_response, 9);
+  get([&](boost::iterator_range<char const *> const &range,
+          boost::system::error_code const &ec) {
+    body.append(boost::begin(range), boost::end(range));
+    if (ec == boost::asio::error::eof) ended = true;
+  });
+  BOOST_CHECK(released);
+  BOOST_CHECK(ended);
+  BOOST_CHECK_EQUAL(body, "Hello, world!");
+  BOOST_CHECK(reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(connection_close_is_not_reusable, connection_fixture) {
+  socket->serve("HTTP/1.1 200 OK\r\n"
+                "Connection: close\r\n"
+                "Content-Length: 2\r\n"
+                "\r\n"
+                "ok");
+  http::response response = get();
+  BOOST_CHECK_EQUAL(body_of(response), "ok");
+  BOOST_CHECK(!reusable);
+  BOOST_CHECK(socket->disconnected);
+}
+
+BOOST_FIXTURE_TEST_CASE(unframed_body_ends_with_the_connection, connection_fixture) {
+  socket->serve("HTTP/1.1 200 OK\r\n"
+                "\r\n"
+                "until the end");
+  socket->closed = true;
+  http::response response = get();
+  BOOST_CHECK_EQUAL(body_of(response), "until the end");
+  BOOST_CHECK(!reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(no_content_has_no_body, connection_fixture) {
+  socket->serve("HTTP/1.1 204 No Content\r\n"
+                "\r\n");
+  http::response response = get();
+  BOOST_CHECK_EQUAL(body_of(response), "");
+  BOOST_CHECK(reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(truncated_body_is_an_error, connection_fixture) {
+  socket->serve("HTTP/1.1 200 OK\r\n"
+                "Content-Length: 10\r\n"
+                "\r\n"
+                "short");
+  socket->closed = true;
+  http::response response = get();
+  BOOST_REQUIRE(released);
+  std::string body;
+  BOOST_CHECK_THROW(response.get_body(body), std::runtime_error);
+  BOOST_CHECK(!reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(invalid_chunk_is_an_error, connection_fixture) {
+  socket->serve("HTTP/1.1 200 OK\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "zz\r\n");
+  http::response response = get();
+  BOOST_REQUIRE(released);
+  std::string body;
+  BOOST_CHECK_THROW(response.get_body(body), std::runtime_error);
+  BOOST_CHECK(!reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(invalid_content_length_is_an_error, connection_fixture) {
+  // The server stays open, so falling back to reading until the end of the
+  // stream would never release the connection.
+  char const *lengths[] = {"12x", "", "99999999999999999999999"};
+  for (std::size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    socket->serve(std::string("HTTP/1.1 200 OK\r\n"
+                              "Content-Length: ") + lengths[i] + "\r\n"
+                  "\r\n"
+                  "Hello, world!");
+    http::response response = get();
+    BOOST_REQUIRE(released);
+    std::string body;
+    BOOST_CHECK_THROW(response.get_body(body), std::runtime_error);
+    BOOST_CHECK(!reusable);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(pipelined_responses_are_matched_in_order, connection_fixture) {
+  pipeline(3);
+  http::response first = send(), second = send(), third = send();
+  socket->serve("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst"
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "6\r\nsecond\r\n0\r\n\r\n"
+                "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nthird");
+  run();
+  BOOST_CHECK_EQUAL(releases, 3);
+  BOOST_CHECK_EQUAL(body_of(first), "first");
+  BOOST_CHECK_EQUAL(body_of(second), "second");
+  BOOST_CHECK_EQUAL(body_of(third), "third");
+  BOOST_CHECK(reusable);
+  // All three requests went out in one write on one connection.
+  BOOST_REQUIRE_EQUAL(socket->writes.size(), 1u);
+  BOOST_CHECK_EQUAL(requests_in(socket->writes[0]), 3u);
+  BOOST_CHECK_EQUAL(socket->connects, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(requests_wait_for_responses_without_pipelining, connection_fixture) {
+  http::response first = send(), second = send();
+  socket->serve(length_response);
+  socket->serve(length_response);
+  run();
+  BOOST_CHECK_EQUAL(body_of(first), "Hello, world!");
+  BOOST_CHECK_EQUAL(body_of(second), "Hello, world!");
+  BOOST_REQUIRE_EQUAL(socket->writes.size(), 2u);
+  BOOST_CHECK_EQUAL(requests_in(socket->writes[0]), 1u);
+  BOOST_CHECK_EQUAL(socket->connects, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(close_in_the_middle_of_a_pipeline_falls_back, connection_fixture) {
+  pipeline(3);
+  http::response first = send(), second = send(), third = send();
+  // The server answers the first request and closes the connection; the
+  // other two go out again on a new connection, one at a time.
+  socket->serve("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 5\r\n\r\nfirst");
+  socket->serve(length_response);
+  socket->serve(length_response);
+  run();
+  BOOST_CHECK_EQUAL(releases, 3);
+  BOOST_CHECK_EQUAL(body_of(first), "first");
+  BOOST_CHECK_EQUAL(body_of(second), "Hello, world!");
+  BOOST_CHECK_EQUAL(body_of(third), "Hello, world!");
+  BOOST_CHECK_EQUAL(socket->connects, 2);
+  BOOST_REQUIRE_EQUAL(socket->writes.size(), 3u);
+  BOOST_CHECK_EQUAL(requests_in(socket->writes[0]), 3u);
+  BOOST_CHECK_EQUAL(requests_in(socket->writes[1]), 1u);
+  BOOST_CHECK_EQUAL(requests_in(socket->writes[2]), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(silent_server_times_out_waiting_for_the_response, connection_fixture) {
+  http::response response = send(http::client_connection::callback_type(),
+                                 http::request_options().first_byte_timeout(10));
+  run();
+  BOOST_REQUIRE(released);
+  std::string body;
+  BOOST_CHECK_THROW(response.get_body(body), http::errors::connection_timeout_exception);
+  BOOST_CHECK(!reusable);
+  BOOST_CHECK(socket->disconnected);
+}
+
+BOOST_FIXTURE_TEST_CASE(stalled_body_runs_into_the_overall_timeout, connection_fixture) {
+  socket->serve("HTTP/1.1 200 OK\r\n"
+                "Content-Length: 10\r\n"
+                "\r\n"
+                "short");
+  std::string body;
+  boost::system::error_code last_error;
+  http::response response = send(
+      [&](boost::iterator_range<char const *> const &range,
+          boost::system::error_code const &ec) {
+        body.append(boost::begin(range), boost::end(range));
+        last_error = ec;
+      },
+      http::request_options().timeout(20));
+  run();
+  BOOST_REQUIRE(released);
+  BOOST_CHECK_EQUAL(body, "short");
+  BOOST_CHECK(last_error == boost::asio::error::timed_out);
+  BOOST_CHECK_THROW(response.get_destination(body), http::errors::connection_timeout_exception);
+  BOOST_CHECK(!reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(response_callbacks_follow_the_response, connection_fixture) {
+  std::vector<std::string> seen;
+  socket->serve(length_response, 11);
+  http::response response = send();
+  std::shared_ptr<http::response_state> state =
+      http::impl::setter_access().get_response_state(response);
+  BOOST_REQUIRE(state);
+  state->on_headers([&](http::response const &r) {
+    std::string status_message;
+    r.get_status_message(status_message);
+    seen.push_back("headers " + status_message);
+  });
+  state->on_complete([&](http::response const &r, std::exception_ptr error) {
+    std::string body;
+    if (!error) r.get_body(body);
+    seen.push_back(error ? "failed" : "complete " + body);
+  });
+  run();
+  BOOST_REQUIRE_EQUAL(seen.size(), 2u);
+  BOOST_CHECK_EQUAL(seen[0], "headers OK");
+  BOOST_CHECK_EQUAL(seen[1], "complete Hello, world!");
+
+  seen.clear();
+  socket->serve("HTTP/1.1 200 OK\r\n"
+                "Content-Length: 10\r\n"
+                "\r\n"
+                "short");
+  socket->closed = true;
+  state = http::impl::setter_access().get_response_state(send());
+  state->on_complete([&](http::response const &, std::exception_ptr error) {
+    seen.push_back(error ? "failed" : "complete");
+  });
+  run();
+  BOOST_REQUIRE_EQUAL(seen.size(), 1u);
+  BOOST_CHECK_EQUAL(seen[0], "failed");
+}
+
+namespace {
+
+// Hands out the pieces one per call, and notes how many writes had been
+// made by then.
+struct piece_producer {
+  piece_producer(std::vector<std::string> pieces, std::vector<std::string> const &writes)
+  : pieces(pieces), writes(writes) {}
+
+  std::size_t operator()(char *data, std::size_t size) {
+    writes_seen.push_back(writes.size());
+    if (pieces.empty()) return 0;
+    std::string piece = pieces.front();
+    pieces.erase(pieces.begin());
+    BOOST_REQUIRE(piece.size() <= size);
+    std::copy(piece.begin(), piece.end(), data);
+    return piece.size();
+  }
+
+  std::vector<std::string> pieces;
+  std::vector<std::string> const &writes;
+  std::vector<std::size_t> writes_seen;
+};
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_CASE(streamed_body_is_chunked_one_piece_per_write, connection_fixture) {
+  std::vector<std::string> pieces;
+  pieces.push_back("Hello, ");
+  pieces.push_back("world!");
+  piece_producer producer(pieces, socket->writes);
+  socket->serve(length_response);
+  http::response response = connection->send_request(
+      "PUT", http::request("http://www.example.com/"), true,
+      http::client_connection::callback_type(),
+      http::request_options().body_producer(std::ref(producer)));
+  run();
+  BOOST_CHECK_EQUAL(body_of(response), "Hello, world!");
+  BOOST_REQUIRE_EQUAL(socket->writes.size(), 4u);
+  BOOST_CHECK_EQUAL(socket->writes[1], "7\r\nHello, \r\n");
+  BOOST_CHECK_EQUAL(socket->writes[2], "6\r\nworld!\r\n");
+  BOOST_CHECK_EQUAL(socket->writes[3], "0\r\n\r\n");
+  // Each piece was asked for once the one before it had been written.
+  BOOST_REQUIRE_EQUAL(producer.writes_seen.size(), 3u);
+  BOOST_CHECK_EQUAL(producer.writes_seen[0], 1u);
+  BOOST_CHECK_EQUAL(producer.writes_seen[1], 2u);
+  BOOST_CHECK_EQUAL(producer.writes_seen[2], 3u);
+  BOOST_CHECK(reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(streamed_body_of_known_length_is_sent_as_is, connection_fixture) {
+  std::vector<std::string> pieces;
+  pieces.push_back("Hello, ");
+  pieces.push_back("world!");
+  piece_producer producer(pieces, socket->writes);
+  socket->serve(length_response);
+  http::response response = connection->send_request(
+      "POST", http::request("http://www.example.com/"), true,
+      http::client_connection::callback_type(),
+      http::request_options().body_producer(std::ref(producer)).body_length(13u));
+  run();
+  BOOST_CHECK_EQUAL(body_of(response), "Hello, world!");
+  BOOST_REQUIRE_EQUAL(socket->writes.size(), 3u);
+  BOOST_CHECK_EQUAL(socket->writes[1], "Hello, ");
+  BOOST_CHECK_EQUAL(socket->writes[2], "world!");
+  // Nothing is asked for past the length.
+  BOOST_CHECK_EQUAL(producer.writes_seen.size(), 2u);
+}
+
+BOOST_FIXTURE_TEST_CASE(slow_streamed_body_outlasts_the_overall_timeout, connection_fixture) {
+  std::vector<std::string> pieces(6, "piece");
+  piece_producer producer(pieces, socket->writes);
+  socket->serve(length_response);
+  http::response response = connection->send_request(
+      "PUT", http::request("http://www.example.com/"), true,
+      http::client_connection::callback_type(),
+      http::request_options()
+          .body_producer([&](char *data, std::size_t size) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(15));
+            return producer(data, size);
+          })
+          .timeout(40));
+  run();
+  // Six pieces take longer than the timeout, but none of them stalls.
+  BOOST_CHECK_EQUAL(body_of(response), "Hello, world!");
+  BOOST_CHECK_EQUAL(socket->writes.size(), 8u);
+  BOOST_CHECK(reusable);
+}
+
+BOOST_FIXTURE_TEST_CASE(streamed_body_shorter_than_its_length_fails, connection_fixture) {
+  std::vector<std::string> pieces;
+  pieces.push_back("short");
+  piece_producer producer(pieces, socket->writes);
+  http::response response = connection->send_request(
+      "PUT", http::request("http://www.example.com/"), true,
+      http::client_connection::callback_type(),
+      http::request_options().body_producer(std::ref(producer)).body_length(20u));
+  run();
+  std::string body;
+  BOOST_CHECK_THROW(response.get_body(body), std::length_error);
+  BOOST_CHECK(socket->disconnected);
+  // The request was not sent again.
+  BOOST_CHECK_EQUAL(socket->connects, 1);
+}
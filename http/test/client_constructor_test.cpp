@@ -30,3 +30,15 @@ BOOST_AUTO_TEST_CASE(http_client_constructor_test) {
          .add_openssl_verify_path("/dev/null");
   http::client instance2(options);
 }
+
+BOOST_AUTO_TEST_CASE(http_client_io_threads_test) {
+  // A client may run its I/O on several threads of its own.
+  http::client_options options;
+  options.io_threads(4);
+  http::client instance(options);
+  http::client_options const & settings = options;
+  BOOST_CHECK_EQUAL(settings.io_threads(), 4u);
+  // Without a thread the client could not do anything.
+  options.io_threads(0);
+  BOOST_CHECK_EQUAL(settings.io_threads(), 1u);
+}
@@ -10,10 +10,43 @@
 #define BOOST_TEST_MODULE HTTP 1.0 Get Test
 #include <network/include/http/client.hpp>
 #include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 
 namespace net = network;
 namespace http = network::http;
 
+namespace {
+
+// Takes any two arguments, so it would convert to a body handler as well as
+// to a completion callback.
+struct completion {
+  completion() : done(false), failed(false) {}
+
+  template <class Response, class Error>
+  void operator()(Response const &response, Error const &error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->response = response;
+    failed = bool(error);
+    done = true;
+    finished.notify_all();
+  }
+
+  bool wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return finished.wait_for(lock, std::chrono::seconds(30), [this]() { return done; });
+  }
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  http::client::response response;
+  bool done, failed;
+};
+
+}  // namespace
+
 BOOST_AUTO_TEST_CASE(http_client_get_test) {
     http::client::request request("http://www.google.com/");
     request << net::header("Connection", "close");
@@ -33,6 +66,19 @@ BOOST_AUTO_TEST_CASE(http_client_get_test) {
     BOOST_CHECK ( status_message_ == std::string("Found") || status_message_ == std::string("OK") );
 }
 
+BOOST_AUTO_TEST_CASE(http_client_async_get_test) {
+    http::client::request request("http://www.google.com/");
+    request << net::header("Connection", "close");
+    http::client client_;
+    completion done;
+    client_.async_get(request, std::ref(done));
+    BOOST_REQUIRE ( done.wait() );
+    BOOST_REQUIRE ( !done.failed );
+    uint16_t status_;
+    done.response.get_status(status_);
+    BOOST_CHECK ( status_ == 302u || status_ == 200u );
+}
+
 #ifdef NETWORK_ENABLE_HTTPS
 
 BOOST_AUTO_TEST_CASE(https_client_get_test) {
@@ -0,0 +1,137 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Client Connection Race Test
+#include <boost/test/unit_test.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <network/protocol/http/client/connection/connection_race.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace http = network::http;
+namespace ip = boost::asio::ip;
+
+namespace {
+
+struct race_fixture {
+  race_fixture()
+  : acceptor(service, ip::tcp::endpoint(ip::address_v4::loopback(), 0)),
+    called(false) {}
+
+  // A loopback port that nothing listens on, so connecting is refused.
+  ip::tcp::endpoint refused() {
+    ip::tcp::acceptor closed(service, ip::tcp::endpoint(ip::address_v4::loopback(), 0));
+    ip::tcp::endpoint endpoint = closed.local_endpoint();
+    closed.close();
+    return endpoint;
+  }
+
+  void race(std::vector<ip::tcp::endpoint> const &endpoints, int delay_ms = 250) {
+    std::shared_ptr<http::connection_race> race_ =
+        std::make_shared<http::connection_race>(service, endpoints,
+                                                std::chrono::milliseconds(delay_ms));
+    race_->start([this](boost::system::error_code const &ec,
+                        std::unique_ptr<ip::tcp::socket> socket) {
+      called = true;
+      error = ec;
+      winner = std::move(socket);
+    });
+    service.run();
+  }
+
+  boost::asio::io_service service;
+  ip::tcp::acceptor acceptor;
+  bool called;
+  boost::system::error_code error;
+  std::unique_ptr<ip::tcp::socket> winner;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(interleave_alternates_address_families) {
+  ip::tcp::endpoint v6a(ip::address::from_string("2001:db8::1"), 80),
+                    v6b(ip::address::from_string("2001:db8::2"), 80),
+                    v6c(ip::address::from_string("2001:db8::3"), 80),
+                    v4a(ip::address::from_string("192.0.2.1"), 80),
+                    v4b(ip::address::from_string("192.0.2.2"), 80);
+  std::vector<ip::tcp::endpoint> resolved;
+  resolved.push_back(v6a);
+  resolved.push_back(v6b);
+  resolved.push_back(v6c);
+  resolved.push_back(v4a);
+  resolved.push_back(v4b);
+  std::vector<ip::tcp::endpoint> ordered = http::connection_race::interleave(resolved);
+  BOOST_REQUIRE_EQUAL(ordered.size(), 5u);
+  BOOST_CHECK(ordered[0] == v6a);
+  BOOST_CHECK(ordered[1] == v4a);
+  BOOST_CHECK(ordered[2] == v6b);
+  BOOST_CHECK(ordered[3] == v4b);
+  BOOST_CHECK(ordered[4] == v6c);
+}
+
+BOOST_FIXTURE_TEST_CASE(refused_address_falls_through_to_the_next, race_fixture) {
+  std::vector<ip::tcp::endpoint> endpoints;
+  endpoints.push_back(refused());
+  endpoints.push_back(acceptor.local_endpoint());
+  // The delay is long enough that only the refusal can start the second
+  // attempt this quickly.
+  race(endpoints, 60 * 1000);
+  BOOST_REQUIRE(called);
+  BOOST_CHECK(!error);
+  BOOST_REQUIRE(winner);
+  BOOST_CHECK(winner->remote_endpoint() == acceptor.local_endpoint());
+}
+
+BOOST_FIXTURE_TEST_CASE(all_addresses_refused_is_an_error, race_fixture) {
+  std::vector<ip::tcp::endpoint> endpoints;
+  endpoints.push_back(refused());
+  endpoints.push_back(refused());
+  race(endpoints);
+  BOOST_REQUIRE(called);
+  BOOST_CHECK(error);
+  BOOST_CHECK(!winner);
+}
+
+BOOST_FIXTURE_TEST_CASE(cancelled_race_does_not_complete, race_fixture) {
+  std::vector<ip::tcp::endpoint> endpoints;
+  endpoints.push_back(acceptor.local_endpoint());
+  std::shared_ptr<http::connection_race> race_ =
+      std::make_shared<http::connection_race>(service, endpoints,
+                                              std::chrono::milliseconds(250));
+  race_->start([this](boost::system::error_code const &, std::unique_ptr<ip::tcp::socket>) {
+    called = true;
+  });
+  race_->cancel();
+  service.run();
+  BOOST_CHECK(!called);
+}
+
+BOOST_FIXTURE_TEST_CASE(cancel_waits_for_a_running_callback, race_fixture) {
+  std::vector<ip::tcp::endpoint> endpoints;
+  endpoints.push_back(acceptor.local_endpoint());
+  std::shared_ptr<http::connection_race> race_ =
+      std::make_shared<http::connection_race>(service, endpoints,
+                                              std::chrono::milliseconds(250));
+  std::atomic<bool> started(false), finished(false);
+  race_->start([&started, &finished](boost::system::error_code const &,
+                                     std::unique_ptr<ip::tcp::socket>) {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    finished = true;
+  });
+  std::thread runner([this] { service.run(); });
+  while (!started) std::this_thread::yield();
+  // Whatever the callback refers to may be destroyed once this returns.
+  race_->cancel();
+  BOOST_CHECK(finished);
+  runner.join();
+}
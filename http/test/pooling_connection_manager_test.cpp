@@ -0,0 +1,213 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Client Pooling Connection Manager Test
+#include <boost/test/unit_test.hpp>
+#include <network/protocol/http/client/pooling_connection_manager.hpp>
+#include <network/protocol/http/client/options.hpp>
+#include <network/protocol/http/request.hpp>
+#include <network/protocol/http/response.hpp>
+#include <functional>
+#include <vector>
+
+namespace http = network::http;
+
+namespace {
+
+// Stands in for a connection; tests decide when each of its requests is
+// finished, whether it is reusable and whether it is still open.
+struct fake_connection : http::client_connection {
+  fake_connection() : open(true) {}
+  virtual http::response send_request(std::string const &,
+                                      http::request const &,
+                                      bool,
+                                      callback_type,
+                                      http::request_options const &) {
+    return http::response();
+  }
+  virtual client_connection * clone() const { return new fake_connection; }
+  virtual void reset() {}
+  virtual void set_release_callback(release_callback_type callback) {
+    release_callback = callback;
+  }
+  virtual bool is_open() { return open; }
+
+  void finish(bool reusable) {
+    BOOST_REQUIRE(release_callback);
+    release_callback(reusable);
+  }
+
+  bool open;
+  release_callback_type release_callback;
+};
+
+struct fake_factory : http::connection_factory {
+  virtual std::shared_ptr<http::client_connection> create_connection(
+      boost::asio::io_service &,
+      http::request_base const &,
+      http::client_options const &) {
+    return std::make_shared<fake_connection>();
+  }
+};
+
+struct pool_fixture {
+  pool_fixture()
+  : example("http://www.example.com/"),
+    other("http://www.example.org/") {
+    options.connection_factory(std::make_shared<fake_factory>());
+  }
+
+  std::shared_ptr<fake_connection> get(http::pooling_connection_manager &pool,
+                                       http::request const &request) {
+    return std::static_pointer_cast<fake_connection>(
+        pool.get_connection(service, request, options));
+  }
+
+  boost::asio::io_service service;
+  http::client_options options;
+  http::request example, other;
+};
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_CASE(released_connections_are_reused_last_in_first_out, pool_fixture) {
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> first = get(pool, example);
+  std::shared_ptr<fake_connection> second = get(pool, example);
+  BOOST_CHECK(first != second);
+  first->finish(true);
+  second->finish(true);
+  BOOST_CHECK(get(pool, example) == second);
+  BOOST_CHECK(get(pool, example) == first);
+  http::connection_pool_statistics stats = pool.statistics();
+  BOOST_CHECK_EQUAL(stats.created, 2u);
+  BOOST_CHECK_EQUAL(stats.reused, 2u);
+  BOOST_CHECK_EQUAL(stats.in_use, 2u);
+  BOOST_CHECK_EQUAL(stats.idle, 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(connections_are_kept_per_host, pool_fixture) {
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> connection = get(pool, example);
+  connection->finish(true);
+  BOOST_CHECK(get(pool, other) != connection);
+  BOOST_CHECK(get(pool, example) == connection);
+}
+
+BOOST_FIXTURE_TEST_CASE(unusable_connections_are_not_reused, pool_fixture) {
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> closed = get(pool, example);
+  closed->finish(false);
+  BOOST_CHECK(get(pool, example) != closed);
+
+  std::shared_ptr<fake_connection> dropped = get(pool, example);
+  dropped->finish(true);
+  dropped->open = false;
+  BOOST_CHECK(get(pool, example) != dropped);
+
+  http::connection_pool_statistics stats = pool.statistics();
+  BOOST_CHECK_EQUAL(stats.not_reusable, 1u);
+  BOOST_CHECK_EQUAL(stats.failed_checks, 1u);
+  BOOST_CHECK_EQUAL(stats.reused, 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(health_check_can_be_turned_off, pool_fixture) {
+  options.check_idle_connections(false);
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> connection = get(pool, example);
+  connection->finish(true);
+  connection->open = false;
+  BOOST_CHECK(get(pool, example) == connection);
+}
+
+BOOST_FIXTURE_TEST_CASE(oldest_idle_connection_overflows, pool_fixture) {
+  options.max_idle_connections_per_host(1);
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> first = get(pool, example);
+  std::shared_ptr<fake_connection> second = get(pool, example);
+  first->finish(true);
+  second->finish(true);
+  http::connection_pool_statistics stats = pool.statistics();
+  BOOST_CHECK_EQUAL(stats.idle, 1u);
+  BOOST_CHECK_EQUAL(stats.overflowed, 1u);
+  BOOST_CHECK(get(pool, example) == second);
+}
+
+BOOST_FIXTURE_TEST_CASE(idle_connections_expire, pool_fixture) {
+  options.idle_connection_timeout(0);
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> connection = get(pool, example);
+  connection->finish(true);
+  BOOST_CHECK(get(pool, example) != connection);
+  BOOST_CHECK_EQUAL(pool.statistics().expired, 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(reset_closes_idle_connections, pool_fixture) {
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> connection = get(pool, example);
+  connection->finish(true);
+  BOOST_CHECK_EQUAL(pool.statistics().idle, 1u);
+  pool.reset();
+  BOOST_CHECK_EQUAL(pool.statistics().idle, 0u);
+  BOOST_CHECK(get(pool, example) != connection);
+}
+
+BOOST_FIXTURE_TEST_CASE(busy_connections_are_shared_up_to_the_pipeline_depth, pool_fixture) {
+  options.pipeline_depth(2);
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> first = get(pool, example);
+  BOOST_CHECK(get(pool, example) == first);
+  std::shared_ptr<fake_connection> second = get(pool, example);
+  BOOST_CHECK(second != first);
+  BOOST_CHECK(get(pool, example) == second);
+  http::connection_pool_statistics stats = pool.statistics();
+  BOOST_CHECK_EQUAL(stats.created, 2u);
+  BOOST_CHECK_EQUAL(stats.pipelined, 2u);
+  BOOST_CHECK_EQUAL(stats.in_use, 2u);
+  // The connection goes idle once both of its requests are done.
+  first->finish(true);
+  BOOST_CHECK_EQUAL(pool.statistics().idle, 0u);
+  first->finish(true);
+  stats = pool.statistics();
+  BOOST_CHECK_EQUAL(stats.idle, 1u);
+  BOOST_CHECK_EQUAL(stats.in_use, 1u);
+  BOOST_CHECK(get(pool, example) == first);
+}
+
+BOOST_FIXTURE_TEST_CASE(busy_connections_are_not_shared_without_pipelining, pool_fixture) {
+  http::pooling_connection_manager pool(options);
+  std::shared_ptr<fake_connection> first = get(pool, example);
+  BOOST_CHECK(get(pool, example) != first);
+  BOOST_CHECK_EQUAL(pool.statistics().pipelined, 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(idle_connections_are_shared_by_the_callers_services, pool_fixture) {
+  http::pooling_connection_manager pool(options);
+  boost::asio::io_service second_service, unrelated_service;
+  std::vector<boost::asio::io_service *> services;
+  services.push_back(&service);
+  services.push_back(&second_service);
+  std::size_t picked = 0;
+  std::function<boost::asio::io_service &()> pick =
+      [&]() -> boost::asio::io_service & { return *services[picked++ % services.size()]; };
+  std::shared_ptr<http::client_connection> first =
+      pool.get_connection(services, pick, example, options);
+  std::shared_ptr<http::client_connection> second =
+      pool.get_connection(services, pick, example, options);
+  BOOST_CHECK_EQUAL(picked, 2u);
+  std::static_pointer_cast<fake_connection>(first)->finish(true);
+  std::static_pointer_cast<fake_connection>(second)->finish(true);
+  // Both idle connections are found whichever io_service would come next.
+  BOOST_CHECK(pool.get_connection(services, pick, example, options) == second);
+  BOOST_CHECK(pool.get_connection(services, pick, example, options) == first);
+  BOOST_CHECK_EQUAL(picked, 2u);
+  std::static_pointer_cast<fake_connection>(first)->finish(true);
+  // Callers that do not run the connection's io_service get a new one.
+  BOOST_CHECK(pool.get_connection(unrelated_service, example, options) != first);
+  BOOST_CHECK(get(pool, example) == first);
+}
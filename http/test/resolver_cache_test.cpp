@@ -0,0 +1,138 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Client Resolver Cache Test
+#include <boost/test/unit_test.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <network/protocol/http/client/connection/resolver_cache.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace http = network::http;
+
+namespace {
+
+// Answers "localhost" through the system resolver, which needs no network,
+// and reports every other name as not existing. Lookups are counted and
+// complete from the io_service, the way a real resolver's do.
+struct counting_cache : http::resolver_cache {
+  counting_cache(std::chrono::milliseconds ttl, std::chrono::milliseconds negative_ttl)
+  : http::resolver_cache(ttl, negative_ttl), lookups(0) {}
+
+  virtual void lookup(boost::asio::io_service & service,
+                      std::string const & host,
+                      uint16_t port,
+                      lookup_handler handler) {
+    ++lookups;
+    if (host == "localhost") {
+      http::resolver_cache::lookup(service, host, port, handler);
+    } else {
+      service.post(std::bind(handler,
+                             boost::system::error_code(boost::asio::error::host_not_found),
+                             resolver_iterator()));
+    }
+  }
+
+  int lookups;
+};
+
+struct cache_fixture {
+  cache_fixture()
+  : cache(std::chrono::milliseconds(400), std::chrono::milliseconds(200)) {}
+
+  void resolve(std::string const & host) {
+    cache.resolve(service, host, 80,
+                  [this](boost::system::error_code const & ec,
+                         http::resolver_delegate::iterator_pair endpoints) {
+      errors.push_back(ec);
+      resolved.push_back(endpoints.first != endpoints.second);
+    });
+  }
+
+  void run() {
+    service.reset();
+    service.run();
+  }
+
+  boost::asio::io_service service;
+  counting_cache cache;
+  std::vector<boost::system::error_code> errors;
+  std::vector<bool> resolved;
+};
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_CASE(cached_names_are_not_looked_up_again, cache_fixture) {
+  resolve("localhost");
+  run();
+  resolve("LocalHost");
+  BOOST_REQUIRE_EQUAL(resolved.size(), 2u);  // answered right away
+  BOOST_CHECK(resolved[0]);
+  BOOST_CHECK(resolved[1]);
+  BOOST_CHECK_EQUAL(cache.lookups, 1);
+  http::resolver_cache_statistics stats = cache.statistics();
+  BOOST_CHECK_EQUAL(stats.hits, 1u);
+  BOOST_CHECK_EQUAL(stats.entries, 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(concurrent_resolutions_share_a_lookup, cache_fixture) {
+  resolve("localhost");
+  resolve("localhost");
+  resolve("localhost");
+  run();
+  BOOST_REQUIRE_EQUAL(resolved.size(), 3u);
+  BOOST_CHECK(resolved[0] && resolved[1] && resolved[2]);
+  BOOST_CHECK_EQUAL(cache.lookups, 1);
+  BOOST_CHECK_EQUAL(cache.statistics().coalesced, 2u);
+}
+
+BOOST_FIXTURE_TEST_CASE(missing_names_are_cached_until_the_negative_ttl, cache_fixture) {
+  resolve("nowhere.invalid");
+  run();
+  resolve("nowhere.invalid");
+  BOOST_REQUIRE_EQUAL(errors.size(), 2u);
+  BOOST_CHECK(errors[0] == boost::asio::error::host_not_found);
+  BOOST_CHECK(errors[1] == boost::asio::error::host_not_found);
+  BOOST_CHECK_EQUAL(cache.lookups, 1);
+  BOOST_CHECK_EQUAL(cache.statistics().negative_hits, 1u);
+  std::this_thread::sleep_for(std::chrono::milliseconds(250));
+  resolve("nowhere.invalid");
+  run();
+  BOOST_CHECK_EQUAL(cache.lookups, 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(entries_used_near_expiry_are_refreshed, cache_fixture) {
+  resolve("localhost");
+  run();
+  // Into the last quarter of the ttl: answered from the cache, and looked
+  // up again in the background.
+  std::this_thread::sleep_for(std::chrono::milliseconds(320));
+  resolve("localhost");
+  BOOST_CHECK_EQUAL(resolved.size(), 2u);
+  run();
+  BOOST_CHECK_EQUAL(cache.lookups, 2);
+  BOOST_CHECK_EQUAL(cache.statistics().refreshes, 1u);
+  // The refresh restarted the ttl, so the entry outlives the first one.
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  resolve("localhost");
+  BOOST_CHECK_EQUAL(resolved.size(), 3u);
+  BOOST_CHECK_EQUAL(cache.lookups, 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(clear_forgets_cached_names, cache_fixture) {
+  resolve("localhost");
+  run();
+  cache.clear();
+  BOOST_CHECK_EQUAL(cache.statistics().entries, 0u);
+  resolve("localhost");
+  run();
+  BOOST_CHECK_EQUAL(cache.lookups, 2);
+}
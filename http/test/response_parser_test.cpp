@@ -0,0 +1,142 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Response Parser Test
+#include <boost/config/warning_disable.hpp>
+#include <boost/test/unit_test.hpp>
+#include <network/protocol/http/parser/incremental.hpp>
+#include <network/protocol/http/response/header_block.hpp>
+#include <cstring>
+#include <string>
+
+namespace http = network::http;
+namespace logic = boost::logic;
+namespace fusion = boost::fusion;
+
+namespace {
+
+typedef boost::iterator_range<char const *> range_type;
+
+std::string const response =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "Content-Length:   12  \r\n"
+    "X-A-Header-Long-Enough-To-Be-Scanned-In-Blocks: a value that is long as well\r\n"
+    "set-cookie: a=1\r\n"
+    "Set-Cookie: b=2\r\n"
+    "\r\n"
+    "body";
+
+// Feeds the response to the parser in pieces of at most `step` bytes, the
+// way the client does as data arrives, and collects the header block the
+// parser's spans refer to.
+logic::tribool parse(http::response_parser &parser,
+                     std::size_t step,
+                     std::string &block) {
+  std::size_t const headers_begin = response.find("\r\n") + 2;
+  std::size_t consumed = 0;
+  logic::tribool parsed_ok = logic::indeterminate;
+  while (logic::indeterminate(parsed_ok) && consumed < response.size()) {
+    std::size_t length = std::min(step, response.size() - consumed);
+    range_type input(response.data() + consumed,
+                     response.data() + consumed + length);
+    range_type result_range;
+    fusion::tie(parsed_ok, result_range) =
+        parser.parse_until(http::response_parser::http_headers_done, input);
+    consumed = boost::end(result_range) - response.data();
+  }
+  block.assign(response.data() + headers_begin, response.data() + consumed);
+  return parsed_ok;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(response_parser_records_status_and_headers) {
+  for (std::size_t step = 1; step <= response.size(); step += 3) {
+    http::response_parser parser;
+    std::string data;
+    BOOST_REQUIRE(bool(parse(parser, step, data)));
+    BOOST_CHECK_EQUAL(parser.version_major(), 1);
+    BOOST_CHECK_EQUAL(parser.version_minor(), 1);
+    BOOST_CHECK_EQUAL(parser.status(), 404);
+    http::header_block headers(data, parser.header_spans());
+    BOOST_REQUIRE_EQUAL(headers.size(), std::size_t(5));
+    BOOST_CHECK_EQUAL(std::string(boost::begin(headers.name(2)), boost::end(headers.name(2))),
+                      "X-A-Header-Long-Enough-To-Be-Scanned-In-Blocks");
+    BOOST_CHECK_EQUAL(std::string(boost::begin(headers.value(2)), boost::end(headers.value(2))),
+                      "a value that is long as well");
+    http::header_block::string_range length = headers.find("content-length");
+    BOOST_CHECK_EQUAL(std::string(boost::begin(length), boost::end(length)), "12");
+    BOOST_CHECK(headers.contains("CONTENT-TYPE"));
+    BOOST_CHECK(!headers.contains("Transfer-Encoding"));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(header_block_looks_up_every_value) {
+  http::response_parser parser;
+  std::string data;
+  BOOST_REQUIRE(bool(parse(parser, response.size(), data)));
+  http::header_block headers(data, parser.header_spans());
+  std::string cookies;
+  headers.for_each("Set-Cookie", [&](std::string const &, std::string const &value) {
+    cookies += value + ";";
+  });
+  BOOST_CHECK_EQUAL(cookies, "a=1;b=2;");
+  std::size_t count = 0;
+  headers.for_each([&](std::string const &, std::string const &) { ++count; });
+  BOOST_CHECK_EQUAL(count, std::size_t(5));
+}
+
+BOOST_AUTO_TEST_CASE(header_block_names_match_in_any_case) {
+  http::response_parser parser;
+  std::string data;
+  BOOST_REQUIRE(bool(parse(parser, response.size(), data)));
+  http::header_block headers(data, parser.header_spans());
+  http::header_block::string_range long_value =
+      headers.find("x-a-HEADER-long-Enough-to-be-scanned-IN-blocks");
+  BOOST_CHECK_EQUAL(std::string(boost::begin(long_value), boost::end(long_value)),
+                    "a value that is long as well");
+  BOOST_CHECK(headers.contains("cOnTeNt-LeNgTh"));
+  std::size_t cookies = 0;
+  headers.for_each("SET-cookie", [&](std::string const &, std::string const &) { ++cookies; });
+  BOOST_CHECK_EQUAL(cookies, std::size_t(2));
+  // Only letters fold; other characters and lengths must match exactly.
+  // '\r' differs from '-' only in the bit that folds the case of letters.
+  BOOST_CHECK(!headers.contains("Content_Type"));
+  BOOST_CHECK(!headers.contains("Content-Typ"));
+  BOOST_CHECK(!headers.contains("Content-Types"));
+  BOOST_CHECK(!headers.contains("Set\rCookie"));
+}
+
+BOOST_AUTO_TEST_CASE(response_parser_rejects_bad_status) {
+  char const *inputs[] = {
+    "HTTP/1.1 2000 OK\r\n",
+    "HTTP/1.1 20x OK\r\n",
+    "HTTP/1.1 OK\r\n"
+  };
+  for (std::size_t index = 0; index < 3; ++index) {
+    http::response_parser parser;
+    range_type input(inputs[index], inputs[index] + std::strlen(inputs[index]));
+    logic::tribool parsed_ok;
+    range_type result_range;
+    fusion::tie(parsed_ok, result_range) =
+        parser.parse_until(http::response_parser::http_status_done, input);
+    BOOST_CHECK(bool(!parsed_ok));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(response_parser_reset) {
+  http::response_parser parser;
+  std::string data;
+  BOOST_REQUIRE(bool(parse(parser, 7, data)));
+  parser.reset();
+  BOOST_CHECK(parser.header_spans().empty());
+  BOOST_CHECK_EQUAL(parser.status(), 0);
+  BOOST_REQUIRE(bool(parse(parser, 11, data)));
+  BOOST_CHECK_EQUAL(parser.header_spans().size(), std::size_t(5));
+}
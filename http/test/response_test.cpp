@@ -9,7 +9,13 @@
 #endif
 #define BOOST_TEST_MODULE HTTP Client Response Test
 #include <network/protocol/http/response.hpp>
+#include <network/protocol/http/response/response_state.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/test/unit_test.hpp>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 namespace http = network::http;
 
@@ -72,3 +78,84 @@ BOOST_AUTO_TEST_CASE(response_setters_and_getters_test) {
   BOOST_CHECK_EQUAL(version, std::string("HTTP/1.1"));
   BOOST_CHECK(expected_headers == headers);
 }
+
+BOOST_AUTO_TEST_CASE(response_state_callbacks_test) {
+  std::shared_ptr<http::response_state> state =
+      std::make_shared<http::response_state>();
+  std::vector<std::string> seen;
+  state->on_headers([&](http::response const &r) {
+    boost::uint16_t status;
+    r.get_status(status);
+    seen.push_back("headers " + boost::lexical_cast<std::string>(status));
+  });
+  state->on_complete([&](http::response const &r, std::exception_ptr error) {
+    std::string body;
+    r.get_body(body);
+    seen.push_back(error ? "failed" : "complete " + body);
+  });
+  state->set_version("HTTP/1.1");
+  state->set_status(200u);
+  state->set_status_message("OK");
+  BOOST_CHECK(seen.empty());
+  state->set_headers(http::header_block());
+  BOOST_REQUIRE_EQUAL(seen.size(), 1u);
+  state->set_body("Hello, World!");
+  state->set_source("");
+  state->set_destination("");
+  BOOST_REQUIRE_EQUAL(seen.size(), 2u);
+  BOOST_CHECK_EQUAL(seen[0], "headers 200");
+  BOOST_CHECK_EQUAL(seen[1], "complete Hello, World!");
+  // Late callbacks are called right away.
+  state->on_complete([&](http::response const &, std::exception_ptr error) {
+    seen.push_back(error ? "failed" : "late");
+  });
+  BOOST_CHECK_EQUAL(seen.back(), "late");
+  // Parts are only set once.
+  state->set_body("Goodbye!");
+  BOOST_CHECK_EQUAL(state->body(), "Hello, World!");
+}
+
+BOOST_AUTO_TEST_CASE(response_state_failure_test) {
+  std::shared_ptr<http::response_state> state =
+      std::make_shared<http::response_state>();
+  bool headers_called = false;
+  std::exception_ptr completed_with;
+  state->on_headers([&](http::response const &) { headers_called = true; });
+  state->on_complete([&](http::response const &, std::exception_ptr error) {
+    completed_with = error;
+  });
+  state->set_status(200u);
+  std::thread reader([&] {
+    BOOST_CHECK_THROW(state->headers(), std::runtime_error);
+  });
+  state->fail(std::make_exception_ptr(std::runtime_error("lost")));
+  reader.join();
+  BOOST_CHECK(!headers_called);
+  BOOST_CHECK(completed_with);
+  // What arrived before the failure is still there.
+  BOOST_CHECK_EQUAL(state->status(), 200u);
+  BOOST_CHECK_THROW(state->version(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(response_setters_override_the_shared_state_test) {
+  std::shared_ptr<http::response_state> state =
+      std::make_shared<http::response_state>();
+  state->set_version("HTTP/1.1");
+  state->set_status(404u);
+  state->set_status_message("Not Found");
+  state->set_headers(http::header_block());
+  state->set_body("");
+  state->set_source("");
+  state->set_destination("");
+  state->on_complete([](http::response const &shared, std::exception_ptr) {
+    http::response copy(shared);
+    copy.set_status(200u);
+    boost::uint16_t original_status, copied_status;
+    shared.get_status(original_status);
+    copy.get_status(copied_status);
+    BOOST_CHECK_EQUAL(original_status, 404u);
+    BOOST_CHECK_EQUAL(copied_status, 200u);
+    BOOST_CHECK(copy != shared);
+    BOOST_CHECK(http::response(shared) == shared);
+  });
+}
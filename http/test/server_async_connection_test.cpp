@@ -0,0 +1,625 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE HTTP Asynchronous Server Connection Tests
+#include <boost/test/unit_test.hpp>
+#include <network/include/http/server.hpp>
+#include <network/protocol/http/server/connection/async.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace http = network::http;
+namespace utils = network::utils;
+
+namespace {
+
+typedef http::async_server_connection::connection_ptr connection_ptr;
+
+http::server_options loopback(std::string const &port) {
+  http::server_options options;
+  options.address("127.0.0.1")
+         .port(port)
+         .reuse_address(true);
+  return options;
+}
+
+// Runs an async_server for the lifetime of the fixture. The server is
+// listening by the time the constructor returns.
+template <class Handler>
+struct running_server {
+  running_server(Handler &handler, std::string const &port)
+  : pool(2)
+  , instance(loopback(port), handler, pool) {
+    start();
+  }
+
+  running_server(Handler &handler, http::server_options const &options)
+  : pool(2)
+  , instance(options, handler, pool) {
+    start();
+  }
+
+  ~running_server() {
+    instance.stop();
+    thread.join();
+  }
+
+  void start() {
+    instance.listen();
+    thread = std::thread([this] { instance.run(); });
+  }
+
+  utils::thread_pool pool;
+  http::async_server<Handler> instance;
+  std::thread thread;
+};
+
+// Sends the given bytes on a fresh connection and returns everything the
+// server sends back until it closes the connection, or whatever arrived
+// within five seconds if it does not. Nothing is read back before `wait`
+// has passed.
+std::string exchange(std::string const &port, std::string const &requests,
+                     std::chrono::milliseconds wait = std::chrono::milliseconds(0)) {
+  using boost::asio::ip::tcp;
+  boost::asio::io_service service;
+  tcp::socket socket(service);
+  socket.connect(tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"),
+                               static_cast<unsigned short>(std::stoi(port))));
+  boost::asio::write(socket, boost::asio::buffer(requests));
+  std::this_thread::sleep_for(wait);
+  boost::asio::streambuf received;
+  boost::asio::deadline_timer deadline(service, boost::posix_time::seconds(5));
+  deadline.async_wait([&socket](boost::system::error_code const &ec) {
+    boost::system::error_code ignored;
+    if (!ec) socket.close(ignored);
+  });
+  boost::asio::async_read(socket, received,
+      [&deadline](boost::system::error_code const &, std::size_t) {
+        deadline.cancel();
+      });
+  service.run();
+  return std::string(boost::asio::buffers_begin(received.data()),
+                     boost::asio::buffers_end(received.data()));
+}
+
+http::response_header content_length(std::size_t length) {
+  http::response_header header = { "Content-Length", std::to_string(length) };
+  return header;
+}
+
+// Answers every request with its destination as the body.
+struct echo_destination {
+  void operator()(http::request const &request, connection_ptr connection) {
+    std::string destination;
+    request.get_destination(destination);
+    http::response_header headers[] = {
+        { "Content-Type", "text/plain" }
+        , content_length(destination.size())
+    };
+    connection->set_status(http::async_server_connection::ok);
+    connection->set_headers(boost::make_iterator_range(headers, headers + 2));
+    connection->write(destination);
+  }
+};
+
+// Sends the body as caller-owned buffers: first a vector with nothing in
+// it, then the actual pieces with a null and an empty one mixed in.
+struct zero_copy_pieces {
+  typedef std::shared_ptr<std::string const> piece;
+
+  void operator()(http::request const &, connection_ptr connection) {
+    http::response_header headers[] = { content_length(13) };
+    connection->set_headers(boost::make_iterator_range(headers, headers + 1));
+    std::vector<piece> nothing(2);
+    nothing[1] = std::make_shared<std::string>();
+    connection->write(nothing, [connection](boost::system::error_code const &ec) {
+      if (ec) return;
+      std::vector<piece> pieces;
+      pieces.push_back(std::make_shared<std::string>("Hello, "));
+      pieces.push_back(piece());
+      pieces.push_back(std::make_shared<std::string>());
+      pieces.push_back(std::make_shared<std::string>("World!"));
+      connection->write(pieces, [](boost::system::error_code const &) {});
+    });
+  }
+};
+
+// Sends a chunked body in two pieces with an empty write in between, and
+// ends it with a trailer. The Content-Length is wrong on purpose; it must
+// not end the response early.
+struct chunked_with_trailers {
+  void operator()(http::request const &, connection_ptr connection) {
+    http::response_header headers[] = {
+        { "Transfer-Encoding", "chunked" }
+        , content_length(2)
+    };
+    connection->set_headers(boost::make_iterator_range(headers, headers + 2));
+    connection->write(std::string("Hello, "), [connection](boost::system::error_code const &) {
+      std::vector<boost::asio::const_buffer> nothing(1, boost::asio::const_buffer("", 0));
+      connection->write(nothing, [connection](boost::system::error_code const &) {
+        connection->write(std::string("World!"), [connection](boost::system::error_code const &) {
+          http::response_header trailers[] = { { "X-Checksum", "abc" } };
+          connection->finish(boost::make_iterator_range(trailers, trailers + 1),
+                             [](boost::system::error_code const &) {});
+        });
+      });
+    });
+  }
+};
+
+// Delimits the body by closing the connection, and finishes without
+// waiting for anything to be written.
+struct finish_right_away {
+  void operator()(http::request const &, connection_ptr connection) {
+    http::response_header headers[] = { { "Content-Type", "text/plain" } };
+    connection->set_headers(boost::make_iterator_range(headers, headers + 1));
+    connection->write(std::string(100000, 'x'));
+    connection->finish();
+  }
+};
+
+// Responds in full before it looks at the request, giving the connection
+// every chance to move on to the next request while the view is in use.
+struct respond_then_look {
+  struct seen {
+    std::mutex mutex;
+    std::vector<std::string> methods, destinations, names;
+    std::vector<unsigned short> minor_versions;
+    std::vector<http::request> copies;
+  };
+
+  respond_then_look() : requests(std::make_shared<seen>()) {}
+
+  void operator()(http::request_view const &request, connection_ptr connection) {
+    http::response_header headers[] = { content_length(2) };
+    connection->set_headers(boost::make_iterator_range(headers, headers + 1));
+    connection->write(std::string("ok"));
+    connection->finish();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::lock_guard<std::mutex> lock(requests->mutex);
+    http::request_view::string_range method = request.method(),
+                                     destination = request.destination(),
+                                     name = request.header_value("x-name");
+    requests->methods.push_back(std::string(method.begin(), method.end()));
+    requests->minor_versions.push_back(request.version_minor());
+    requests->destinations.push_back(std::string(destination.begin(), destination.end()));
+    requests->names.push_back(std::string(name.begin(), name.end()));
+    requests->copies.push_back(request.to_request());
+  }
+
+  // Shared by the copies the server makes of the handler.
+  std::shared_ptr<seen> requests;
+};
+
+// Reads the whole request body with read_body and answers with it.
+struct echo_body {
+  void operator()(http::request const &, connection_ptr connection) {
+    read(connection, std::make_shared<std::string>());
+  }
+
+  static void read(connection_ptr connection, std::shared_ptr<std::string> body) {
+    connection->read_body(
+        [body](http::async_server_connection::input_range data,
+               boost::system::error_code const &ec, bool done, connection_ptr connection) {
+          if (ec) return;
+          body->append(boost::begin(data), boost::end(data));
+          if (!done) return read(connection, body);
+          http::response_header headers[] = { content_length(body->size()) };
+          connection->set_headers(boost::make_iterator_range(headers, headers + 1));
+          connection->write(*body);
+        });
+  }
+};
+
+// Answers with a body far larger than the socket buffers can hold.
+struct large_body {
+  static std::size_t const size = 64 * 1024 * 1024;
+
+  void operator()(http::request const &, connection_ptr connection) {
+    http::response_header headers[] = { content_length(size) };
+    connection->set_headers(boost::make_iterator_range(headers, headers + 1));
+    connection->write(std::string(size, 'x'));
+  }
+};
+
+// Whether the server closes a connection that stops making progress well
+// before exchange() would give up on it.
+template <class Handler>
+bool times_out(http::server_options const &options, std::string const &requests,
+               std::string &received,
+               std::chrono::milliseconds wait = std::chrono::milliseconds(0)) {
+  Handler handler;
+  running_server<Handler> server(handler, options);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  received = exchange(options.port(), requests, wait);
+  return std::chrono::steady_clock::now() - start < std::chrono::seconds(3);
+}
+
+#if !defined(_WIN32)
+// Sends part of a file, framed by Content-Length or as a single chunk.
+struct send_file {
+  send_file(std::string const &path, bool chunked) : path(path), chunked(chunked) {}
+
+  void operator()(http::request const &, connection_ptr connection) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    http::response_header headers[] = {
+        chunked ? http::response_header{ "Transfer-Encoding", "chunked" }
+                : content_length(100000)
+    };
+    connection->set_headers(boost::make_iterator_range(headers, headers + 1));
+    connection->write_file(fd, 10, 100000, [connection, fd, this](boost::system::error_code const &) {
+      ::close(fd);
+      if (chunked) connection->finish();
+    });
+  }
+
+  std::string path;
+  bool chunked;
+};
+
+// A file of 100010 bytes: ten bytes of header followed by the digits 0-9
+// over and over.
+struct temporary_file {
+  temporary_file() {
+    char name[] = "/tmp/server_async_connection_test.XXXXXX";
+    int fd = ::mkstemp(name);
+    path = name;
+    std::string contents = "0123456789";
+    for (int i = 0; i < 100000; ++i) contents += static_cast<char>('0' + i % 10);
+    BOOST_REQUIRE(::write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size()));
+    ::close(fd);
+  }
+
+  ~temporary_file() { ::unlink(path.c_str()); }
+
+  std::string path;
+};
+
+// Uses up every file descriptor the process may open but one, under a
+// lowered limit, and gives them all back when it goes away.
+struct descriptor_shortage {
+  descriptor_shortage() {
+    ::getrlimit(RLIMIT_NOFILE, &original);
+    rlimit lowered = original;
+    if (lowered.rlim_cur > 256) lowered.rlim_cur = 256;
+    ::setrlimit(RLIMIT_NOFILE, &lowered);
+    for (int fd; (fd = ::open("/dev/null", O_RDONLY)) >= 0;)
+      fillers.push_back(fd);
+    BOOST_REQUIRE_EQUAL(errno, EMFILE);
+    BOOST_REQUIRE(!fillers.empty());
+    ::close(fillers.back());
+    fillers.pop_back();
+  }
+
+  ~descriptor_shortage() { end(); }
+
+  void end() {
+    for (std::size_t i = 0; i < fillers.size(); ++i) ::close(fillers[i]);
+    fillers.clear();
+    ::setrlimit(RLIMIT_NOFILE, &original);
+  }
+
+  rlimit original;
+  std::vector<int> fillers;
+};
+#endif
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(pipelined_requests_share_one_connection) {
+  echo_destination handler;
+  running_server<echo_destination> server(handler, "18101");
+  std::string received = exchange(
+      "18101",
+      "GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+      "GET /second HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+  std::string::size_type first = received.find("\r\n\r\n/first");
+  std::string::size_type second = received.find("\r\n\r\n/second");
+  BOOST_CHECK_EQUAL(received.compare(0, 15, "HTTP/1.1 200 OK"), 0);
+  BOOST_REQUIRE(first != std::string::npos);
+  BOOST_REQUIRE(second != std::string::npos);
+  BOOST_CHECK(first < second);
+  BOOST_CHECK_EQUAL(received.find("Connection: close"),
+                    received.rfind("Connection: close"));
+  BOOST_CHECK(received.find("Connection: close") > first);
+}
+
+BOOST_AUTO_TEST_CASE(http_1_0_requests_close_the_connection) {
+  echo_destination handler;
+  running_server<echo_destination> server(handler, "18102");
+  std::string received = exchange(
+      "18102",
+      "GET /only HTTP/1.0\r\n\r\n"
+      "GET /ignored HTTP/1.0\r\n\r\n");
+  BOOST_CHECK(received.find("/only") != std::string::npos);
+  BOOST_CHECK(received.find("/ignored") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(zero_copy_writes_gather_the_caller_buffers) {
+  zero_copy_pieces handler;
+  running_server<zero_copy_pieces> server(handler, "18103");
+  std::string received = exchange(
+      "18103", "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+  BOOST_CHECK(received.find("Content-Length: 13\r\n") != std::string::npos);
+  BOOST_CHECK_EQUAL(received.substr(received.find("\r\n\r\n") + 4), "Hello, World!");
+}
+
+BOOST_AUTO_TEST_CASE(chunked_response_ends_with_trailers) {
+  chunked_with_trailers handler;
+  running_server<chunked_with_trailers> server(handler, "18104");
+  std::string received = exchange(
+      "18104",
+      "GET /first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+      "GET /second HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+  std::string const body = "7\r\nHello, \r\n6\r\nWorld!\r\n0\r\nX-Checksum: abc\r\n\r\n";
+  std::string::size_type first = received.find("\r\n\r\n" + body);
+  BOOST_REQUIRE(first != std::string::npos);
+  std::string::size_type second = received.find("\r\n\r\n" + body, first + body.size());
+  BOOST_REQUIRE(second != std::string::npos);
+  BOOST_CHECK_EQUAL(received.size(), second + 4 + body.size());
+}
+
+BOOST_AUTO_TEST_CASE(finish_waits_for_the_body_to_be_written) {
+  finish_right_away handler;
+  running_server<finish_right_away> server(handler, "18105");
+  std::string received = exchange(
+      "18105", "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  BOOST_CHECK(received.find("Connection: close\r\n") != std::string::npos);
+  BOOST_CHECK_EQUAL(received.substr(received.find("\r\n\r\n") + 4), std::string(100000, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(request_view_outlives_the_response_within_the_handler) {
+  respond_then_look handler;
+  {
+    running_server<respond_then_look> server(handler, "18108");
+    std::string received = exchange(
+        "18108",
+        "GET /first HTTP/1.1\r\nHost: localhost\r\nX-Name: one\r\n\r\n"
+        "POST /second HTTP/1.0\r\nx-name: two\r\n\r\n");
+    BOOST_CHECK(received.find("\r\n\r\nok") != received.rfind("\r\n\r\nok"));
+  }
+  respond_then_look::seen &seen = *handler.requests;
+  std::lock_guard<std::mutex> lock(seen.mutex);
+  BOOST_REQUIRE_EQUAL(seen.destinations.size(), 2u);
+  BOOST_CHECK_EQUAL(seen.methods[0], "GET");
+  BOOST_CHECK_EQUAL(seen.destinations[0], "/first");
+  BOOST_CHECK_EQUAL(seen.names[0], "one");
+  BOOST_CHECK_EQUAL(seen.destinations[1], "/second");
+  BOOST_CHECK_EQUAL(seen.names[1], "two");
+  BOOST_CHECK_EQUAL(seen.methods[1], "POST");
+  BOOST_CHECK_EQUAL(seen.minor_versions[0], 1u);
+  BOOST_CHECK_EQUAL(seen.minor_versions[1], 0u);
+  std::string destination;
+  seen.copies[0].get_destination(destination);
+  BOOST_CHECK_EQUAL(destination, "/first");
+}
+
+BOOST_AUTO_TEST_CASE(only_served_connections_come_from_the_pool) {
+  echo_destination handler;
+  http::server_options options = loopback("18109");
+  options.pending_accepts(2)
+         .accept_batch_size(8)
+         .connection_pool_size(4);
+  running_server<echo_destination> server(handler, options);
+  for (int i = 0; i < 3; ++i)
+    BOOST_CHECK(exchange("18109", "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+                .find("HTTP/1.1 200 OK") == 0);
+  // One connection for each accept slot to begin with, and one more after
+  // each accepted socket; attempts that found the backlog empty take none.
+  BOOST_CHECK_EQUAL(server.instance.connection_pool_hits()
+                    + server.instance.connection_pool_misses(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE(recycled_connections_serve_new_sockets) {
+  echo_destination handler;
+  http::server_options options = loopback("18110");
+  options.connection_pool_size(4);
+  running_server<echo_destination> server(handler, options);
+  for (int i = 0; i < 4; ++i) {
+    std::string destination = "/" + std::to_string(i);
+    std::string received = exchange(
+        "18110", "GET " + destination + " HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                 "GET /last HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+    BOOST_CHECK(received.find("\r\n\r\n" + destination + "HTTP/1.1 200 OK") != std::string::npos);
+    // Let the connection go back to the pool before the next one arrives.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  BOOST_CHECK(server.instance.connection_pool_hits() > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(every_reactor_serves_requests) {
+  echo_destination handler;
+  for (int reuse_port = 0; reuse_port < 2; ++reuse_port) {
+    http::server_options options = loopback("18111");
+    options.reactors(3)
+           .reuse_port(reuse_port != 0);
+    running_server<echo_destination> server(handler, options);
+    for (int i = 0; i < 6; ++i)
+      BOOST_CHECK(exchange("18111", "GET /r HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")
+                  .find("\r\n\r\n/r") != std::string::npos);
+  }
+}
+
+#if !defined(_WIN32)
+BOOST_AUTO_TEST_CASE(write_file_sends_the_file_range) {
+  temporary_file file;
+  std::string expected;
+  for (int i = 0; i < 100000; ++i) expected += static_cast<char>('0' + i % 10);
+  send_file handler(file.path, false);
+  running_server<send_file> server(handler, "18106");
+  std::string received = exchange(
+      "18106", "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+  BOOST_CHECK(received.find("Content-Length: 100000\r\n") != std::string::npos);
+  BOOST_CHECK(received.substr(received.find("\r\n\r\n") + 4) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(write_file_is_one_chunk_of_a_chunked_body) {
+  temporary_file file;
+  std::string expected = "186a0\r\n";
+  for (int i = 0; i < 100000; ++i) expected += static_cast<char>('0' + i % 10);
+  expected += "\r\n0\r\n\r\n";
+  send_file handler(file.path, true);
+  running_server<send_file> server(handler, "18107");
+  std::string received = exchange(
+      "18107", "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+  BOOST_CHECK(received.substr(received.find("\r\n\r\n") + 4) == expected);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(idle_connections_time_out) {
+  http::server_options options = loopback("18112");
+  options.idle_timeout(300);
+  std::string received;
+  BOOST_CHECK(times_out<echo_destination>(
+      options, "GET /idle HTTP/1.1\r\nHost: localhost\r\n\r\n", received));
+  BOOST_CHECK(received.find("\r\n\r\n/idle") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(slow_headers_time_out) {
+  http::server_options options = loopback("18113");
+  options.header_read_timeout(300);
+  std::string received;
+  BOOST_CHECK(times_out<echo_destination>(
+      options, "GET /slow HTTP/1.1\r\nHost: loc", received));
+  BOOST_CHECK(received.find("/slow") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(slow_bodies_time_out) {
+  http::server_options options = loopback("18114");
+  options.body_read_timeout(300);
+  std::string received;
+  BOOST_CHECK(times_out<echo_body>(
+      options, "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 10\r\n\r\nabc",
+      received));
+  BOOST_CHECK(received.find("abc") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(slow_readers_time_out) {
+  http::server_options options = loopback("18115");
+  options.write_timeout(300);
+  std::string received;
+  // The client reads nothing until the server has had ample time to give up
+  // on the write.
+  BOOST_CHECK(times_out<large_body>(
+      options, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n", received,
+      std::chrono::milliseconds(1500)));
+  BOOST_CHECK(received.size() < large_body::size);
+}
+
+BOOST_AUTO_TEST_CASE(read_body_follows_the_content_length) {
+  echo_body handler;
+  running_server<echo_body> server(handler, "18116");
+  std::string received = exchange(
+      "18116",
+      "POST / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n"
+      "Content-Length: 13\r\n\r\nHello, World!");
+  BOOST_CHECK(received.find("Content-Length: 13\r\n") != std::string::npos);
+  BOOST_CHECK_EQUAL(received.substr(received.find("\r\n\r\n") + 4), "Hello, World!");
+}
+
+BOOST_AUTO_TEST_CASE(read_body_decodes_chunks) {
+  echo_body handler;
+  running_server<echo_body> server(handler, "18117");
+  std::string received = exchange(
+      "18117",
+      "POST / HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n"
+      "7\r\nHello, \r\n6;name=value\r\nWorld!\r\n0\r\nX-Trailer: 1\r\n\r\n");
+  BOOST_CHECK_EQUAL(received.substr(received.find("\r\n\r\n") + 4), "Hello, World!");
+}
+
+BOOST_AUTO_TEST_CASE(request_after_a_read_body_is_served) {
+  echo_body handler;
+  running_server<echo_body> server(handler, "18118");
+  std::string received = exchange(
+      "18118",
+      "POST /first HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nfirst"
+      "POST /second HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n6\r\nsecond\r\n0\r\n\r\n");
+  std::string::size_type first = received.find("\r\n\r\nfirst");
+  std::string::size_type second = received.find("\r\n\r\nsecond");
+  BOOST_REQUIRE(first != std::string::npos);
+  BOOST_REQUIRE(second != std::string::npos);
+  BOOST_CHECK(first < second);
+}
+
+BOOST_AUTO_TEST_CASE(unread_body_is_drained_before_the_next_request) {
+  echo_destination handler;
+  running_server<echo_destination> server(handler, "18119");
+  // Neither body is read by the handler; the connection has to skip over
+  // them, chunk framing and all, to find the requests that follow.
+  std::string received = exchange(
+      "18119",
+      "POST /first HTTP/1.1\r\nHost: localhost\r\nContent-Length: 17\r\n\r\n"
+      "GET /bogus HTTP/1"
+      "POST /second HTTP/1.1\r\nHost: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n11\r\nGET /bogus HTTP/1\r\n0\r\n\r\n"
+      "GET /third HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+  std::string::size_type first = received.find("\r\n\r\n/first");
+  std::string::size_type second = received.find("\r\n\r\n/second");
+  std::string::size_type third = received.find("\r\n\r\n/third");
+  BOOST_REQUIRE(first != std::string::npos);
+  BOOST_REQUIRE(second != std::string::npos);
+  BOOST_REQUIRE(third != std::string::npos);
+  BOOST_CHECK(first < second && second < third);
+  BOOST_CHECK(received.find("/bogus") == std::string::npos);
+}
+
+#if !defined(_WIN32)
+BOOST_AUTO_TEST_CASE(accepts_again_once_descriptors_are_freed) {
+  echo_destination handler;
+  http::server_options options = loopback("18120");
+  options.accept_retry_delay(50);
+  running_server<echo_destination> server(handler, options);
+  // Plain sockets, because an io_service may need descriptors of its own.
+  descriptor_shortage shortage;
+  int client = ::socket(AF_INET, SOCK_STREAM, 0);
+  BOOST_REQUIRE(client >= 0);
+  timeval timeout = { 0, 500000 };
+  ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in address = sockaddr_in();
+  address.sin_family = AF_INET;
+  address.sin_port = htons(18120);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  BOOST_REQUIRE_EQUAL(::connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+  std::string const request = "GET /again HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+  BOOST_REQUIRE(::write(client, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+  // The connection waits in the backlog while the server has no descriptor
+  // to accept it with...
+  char buffer[4096];
+  BOOST_CHECK(::recv(client, buffer, sizeof(buffer), 0) < 0);
+  // ...and is served once the server retries after some have been freed.
+  shortage.end();
+  std::string received;
+  for (ssize_t got; (got = ::recv(client, buffer, sizeof(buffer), 0)) > 0;)
+    received.append(buffer, got);
+  ::close(client);
+  BOOST_CHECK(received.find("\r\n\r\n/again") != std::string::npos);
+}
+#endif
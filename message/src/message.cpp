@@ -11,5 +11,6 @@
 #undef NETWORK_NO_LIB
 #endif
 
+#include <network/message/header_storage.ipp>
 #include <network/message/message.ipp>
 #include <network/message/message_base.ipp>
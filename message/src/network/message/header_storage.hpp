@@ -0,0 +1,149 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_MESSAGE_HEADER_STORAGE_HPP_20121018
+#define NETWORK_MESSAGE_HEADER_STORAGE_HPP_20121018
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace network {
+
+// Header names common enough to get a fixed slot in header_storage.
+enum well_known_header {
+  accept_header,
+  accept_charset_header,
+  accept_encoding_header,
+  accept_language_header,
+  accept_ranges_header,
+  age_header,
+  allow_header,
+  authorization_header,
+  cache_control_header,
+  connection_header,
+  content_disposition_header,
+  content_encoding_header,
+  content_language_header,
+  content_length_header,
+  content_location_header,
+  content_range_header,
+  content_type_header,
+  cookie_header,
+  date_header,
+  etag_header,
+  expect_header,
+  expires_header,
+  host_header,
+  if_match_header,
+  if_modified_since_header,
+  if_none_match_header,
+  if_range_header,
+  if_unmodified_since_header,
+  keep_alive_header,
+  last_modified_header,
+  location_header,
+  origin_header,
+  pragma_header,
+  proxy_authenticate_header,
+  proxy_authorization_header,
+  range_header,
+  referer_header,
+  retry_after_header,
+  server_header,
+  set_cookie_header,
+  te_header,
+  trailer_header,
+  transfer_encoding_header,
+  upgrade_header,
+  user_agent_header,
+  vary_header,
+  via_header,
+  www_authenticate_header,
+  x_forwarded_for_header,
+  well_known_header_count,
+  unknown_header = well_known_header_count
+};
+
+// Maps a header name to its well_known_header, ignoring case. This is a
+// single hash computation and one comparison, using a perfect hash over the
+// names above. Anything else maps to unknown_header.
+well_known_header lookup_header(char const *name, std::size_t size);
+
+inline well_known_header lookup_header(std::string const &name) {
+  return lookup_header(name.data(), name.size());
+}
+
+// The canonical spelling of a well-known header name.
+char const * header_name(well_known_header id);
+
+// The header container behind message and request. Headers are kept in the
+// order they were appended, with their names spelled as given. Looking up a
+// well-known header goes straight to its slot; other names are found by a
+// scan of the (usually short) list. Lookups ignore case either way.
+class header_storage {
+ public:
+  header_storage();
+
+  void append(std::string const &name, std::string const &value);
+  void remove(std::string const &name);
+  void clear();
+
+  bool empty() const { return entries_.empty(); }
+  std::size_t size() const { return entries_.size(); }
+
+  // Calls f(name, value) for every header.
+  template <class Function>
+  void for_each(Function f) const {
+    for (std::vector<entry>::const_iterator it = entries_.begin();
+         it != entries_.end();
+         ++it)
+      f(it->name, it->value);
+  }
+
+  // Calls f(name, value) for every header with the given name.
+  template <class Function>
+  void for_each(std::string const &name, Function f) const {
+    well_known_header id = lookup_header(name);
+    if (id != unknown_header) {
+      for (boost::uint32_t index = first_[id]; index != npos; index = entries_[index].next)
+        f(entries_[index].name, entries_[index].value);
+      return;
+    }
+    for (std::vector<entry>::const_iterator it = entries_.begin();
+         it != entries_.end();
+         ++it)
+      if (it->id == unknown_header && same_name(it->name, name))
+        f(it->name, it->value);
+  }
+
+  // Whether both hold the same headers. Headers with different names may be
+  // in any order; the values of a repeated header must be in the same order.
+  bool equals(header_storage const &other) const;
+
+ private:
+  static boost::uint32_t const npos = 0xffffffffu;
+
+  struct entry {
+    std::string name, value;
+    well_known_header id;
+    // The next entry with the same well-known name.
+    boost::uint32_t next;
+  };
+
+  static bool same_name(std::string const &l, std::string const &r);
+  static bool name_less(std::pair<std::string, std::string> const &l,
+                        std::pair<std::string, std::string> const &r);
+  void link(boost::uint32_t index);
+
+  std::vector<entry> entries_;
+  boost::uint32_t first_[well_known_header_count], last_[well_known_header_count];
+};
+
+}  // namespace network
+
+#endif  // NETWORK_MESSAGE_HEADER_STORAGE_HPP_20121018
@@ -0,0 +1,190 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NETWORK_MESSAGE_HEADER_STORAGE_IPP_20121018
+#define NETWORK_MESSAGE_HEADER_STORAGE_IPP_20121018
+
+#include <network/message/header_storage.hpp>
+#include <algorithm>
+#include <utility>
+
+namespace network {
+
+namespace {
+
+  char const * const well_known_header_names[well_known_header_count] = {
+    "Accept",
+    "Accept-Charset",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Accept-Ranges",
+    "Age",
+    "Allow",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Disposition",
+    "Content-Encoding",
+    "Content-Language",
+    "Content-Length",
+    "Content-Location",
+    "Content-Range",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "ETag",
+    "Expect",
+    "Expires",
+    "Host",
+    "If-Match",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Range",
+    "If-Unmodified-Since",
+    "Keep-Alive",
+    "Last-Modified",
+    "Location",
+    "Origin",
+    "Pragma",
+    "Proxy-Authenticate",
+    "Proxy-Authorization",
+    "Range",
+    "Referer",
+    "Retry-After",
+    "Server",
+    "Set-Cookie",
+    "TE",
+    "Trailer",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+    "Vary",
+    "Via",
+    "WWW-Authenticate",
+    "X-Forwarded-For",
+  };
+
+  // Indexed by header_hash(); -1 marks slots that no well-known name hashes
+  // to. The hash has no collisions among the names above, which the message
+  // tests check whenever the list changes.
+  signed char const well_known_header_slots[128] = {
+    -1, -1, -1, -1, -1, 31, -1, -1, 47,  5, 19, -1, -1, 24, -1, 42,
+    -1,  2, -1,  4, -1, -1, -1, 48, 10, -1, -1, -1, 32, -1, -1, -1,
+    -1, -1, -1, -1, 35, -1, -1, -1, -1, 34, 11, -1, 26, 20, -1, -1,
+    -1, -1, -1, 45, -1, -1, 14, -1, 36, 16, 15, -1, -1, 18,  8, -1,
+    39, -1, -1, -1, -1, 44, 28, 23, -1, 13, -1, -1,  3,  9, -1, -1,
+    17, 21, -1, -1, 37, -1, 40, 33, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1,  6, 12, 29, -1, -1, 22, -1, -1, -1, -1, 27,  1,
+    -1, -1, 30, -1, -1, -1, 43, 46, 25, -1,  7, -1, 41,  0, 38, -1,
+  };
+
+  inline unsigned char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : static_cast<unsigned char>(c);
+  }
+
+  inline unsigned header_hash(char const *name, std::size_t size) {
+    return (size
+            + 12 * lower(name[0])
+            + 9 * lower(name[size - 1])
+            + 11 * lower(name[size / 2])) & 127u;
+  }
+
+  inline bool iequal(char const *l, char const *r, std::size_t size) {
+    for (std::size_t index = 0; index < size; ++index)
+      if (lower(l[index]) != lower(r[index])) return false;
+    return true;
+  }
+
+}  // namespace
+
+  well_known_header lookup_header(char const *name, std::size_t size) {
+    if (size == 0) return unknown_header;
+    int slot = well_known_header_slots[header_hash(name, size)];
+    if (slot < 0) return unknown_header;
+    char const *candidate = well_known_header_names[slot];
+    if (std::char_traits<char>::length(candidate) != size || !iequal(candidate, name, size))
+      return unknown_header;
+    return static_cast<well_known_header>(slot);
+  }
+
+  char const * header_name(well_known_header id) {
+    return id < well_known_header_count ? well_known_header_names[id] : "";
+  }
+
+  boost::uint32_t const header_storage::npos;
+
+  header_storage::header_storage()
+  : entries_() {
+    std::fill(first_, first_ + well_known_header_count, npos);
+    std::fill(last_, last_ + well_known_header_count, npos);
+  }
+
+  void header_storage::append(std::string const &name, std::string const &value) {
+    entry added = { name, value, lookup_header(name), npos };
+    entries_.push_back(added);
+    link(static_cast<boost::uint32_t>(entries_.size() - 1));
+  }
+
+  void header_storage::remove(std::string const &name) {
+    well_known_header id = lookup_header(name);
+    std::vector<entry>::iterator kept = entries_.begin();
+    for (std::vector<entry>::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->id == id && (id != unknown_header || same_name(it->name, name)))
+        continue;
+      if (kept != it) *kept = std::move(*it);
+      ++kept;
+    }
+    if (kept == entries_.end()) return;
+    entries_.erase(kept, entries_.end());
+    // Removing is rare enough that rebuilding the slots is fine.
+    std::fill(first_, first_ + well_known_header_count, npos);
+    std::fill(last_, last_ + well_known_header_count, npos);
+    for (boost::uint32_t index = 0; index < entries_.size(); ++index)
+      link(index);
+  }
+
+  void header_storage::clear() {
+    std::vector<entry>().swap(entries_);
+    std::fill(first_, first_ + well_known_header_count, npos);
+    std::fill(last_, last_ + well_known_header_count, npos);
+  }
+
+  bool header_storage::equals(header_storage const &other) const {
+    if (entries_.size() != other.entries_.size()) return false;
+    std::vector<std::pair<std::string, std::string> > mine, theirs;
+    mine.reserve(entries_.size());
+    theirs.reserve(entries_.size());
+    for (std::size_t index = 0; index < entries_.size(); ++index) {
+      mine.push_back(std::make_pair(entries_[index].name, entries_[index].value));
+      theirs.push_back(std::make_pair(other.entries_[index].name, other.entries_[index].value));
+    }
+    // Headers with different names may come in any order, but the values of
+    // a repeated header keep theirs.
+    std::stable_sort(mine.begin(), mine.end(), name_less);
+    std::stable_sort(theirs.begin(), theirs.end(), name_less);
+    return mine == theirs;
+  }
+
+  bool header_storage::name_less(std::pair<std::string, std::string> const &l,
+                                 std::pair<std::string, std::string> const &r) {
+    return l.first < r.first;
+  }
+
+  bool header_storage::same_name(std::string const &l, std::string const &r) {
+    return l.size() == r.size() && iequal(l.data(), r.data(), l.size());
+  }
+
+  void header_storage::link(boost::uint32_t index) {
+    entry &current = entries_[index];
+    current.next = npos;
+    if (current.id == unknown_header) return;
+    if (last_[current.id] == npos) first_[current.id] = index;
+    else entries_[last_[current.id]].next = index;
+    last_[current.id] = index;
+  }
+
+}  // namespace network
+
+#endif  // NETWORK_MESSAGE_HEADER_STORAGE_IPP_20121018
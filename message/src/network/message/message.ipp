@@ -11,6 +11,7 @@
 #include <utility>
 #include <algorithm>
 #include <network/message/message.hpp>
+#include <network/message/header_storage.hpp>
 
 namespace network {
 
@@ -33,15 +34,15 @@ namespace network {
 
     void append_header(std::string const & name,
                        std::string const & value) {
-      headers_.insert(std::make_pair(name, value));
+      headers_.append(name, value);
     }
 
     void remove_headers(std::string const & name) {
-      headers_.erase(name);
+      headers_.remove(name);
     }
 
     void remove_headers() {
-      std::multimap<std::string,std::string>().swap(headers_);
+      headers_.clear();
     }
 
     void set_body(std::string const & body) {
@@ -62,30 +63,19 @@ namespace network {
     }
 
     void get_headers(std::function<void(std::string const &, std::string const &)> inserter) const {
-      std::multimap<std::string, std::string>::const_iterator it  = headers_.begin(),
-      end = headers_.end();
-      for (; it != end; ++it) inserter(it->first, it->second);
+      headers_.for_each(inserter);
     }
 
     void get_headers(std::string const & name,
                      std::function<void(std::string const &, std::string const &)> inserter) const {
-      std::multimap<std::string, std::string>::const_iterator it = headers_.find(name),
-      end= headers_.end();
-      while (it != end) {
-        inserter(it->first, it->second);
-        ++it;
-      }
+      headers_.for_each(name, inserter);
     }
 
     void get_headers(std::function<bool(std::string const &, std::string const &)> predicate,
                      std::function<void(std::string const &, std::string const &)> inserter) const {
-      std::multimap<std::string, std::string>::const_iterator it = headers_.begin(),
-      end = headers_.end();
-      while (it != end) {
-        if (predicate(it->first, it->second))
-          inserter(it->first, it->second);
-        ++it;
-      }
+      headers_.for_each([&](std::string const &name, std::string const &value) {
+        if (predicate(name, value)) inserter(name, value);
+      });
     }
 
     void get_body(std::string & body) {
@@ -117,7 +107,7 @@ namespace network {
 
   private:
     std::string destination_, source_;
-    std::multimap<std::string, std::string> headers_;
+    header_storage headers_;
     // TODO: use Boost.IOStreams here later on.
     std::string body_;
     mutable size_t body_read_pos;
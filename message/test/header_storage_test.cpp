@@ -0,0 +1,137 @@
+// Copyright 2012 Google, Inc.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#ifdef BUILD_SHARED_LIBS
+# define BOOST_TEST_DYN_LINK
+#endif
+#define BOOST_TEST_MODULE header storage test
+#include <boost/config/warning_disable.hpp>
+#include <boost/test/unit_test.hpp>
+#include <network/message/header_storage.hpp>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace network;
+
+namespace {
+
+typedef std::vector<std::pair<std::string, std::string> > collected;
+
+struct collector {
+  explicit collector(collected &headers) : headers(headers) {}
+  void operator()(std::string const &name, std::string const &value) const {
+    headers.push_back(std::make_pair(name, value));
+  }
+  collected &headers;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(well_known_headers_map_to_themselves) {
+  for (int id = 0; id < well_known_header_count; ++id) {
+    std::string name = header_name(static_cast<well_known_header>(id));
+    BOOST_CHECK_EQUAL(lookup_header(name), id);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    BOOST_CHECK_EQUAL(lookup_header(name), id);
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    BOOST_CHECK_EQUAL(lookup_header(name), id);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(other_names_are_unknown) {
+  char const * names[] = {
+    "", "X", "Hostname", "Hos", "X-Forwarded-Host", "Content-Lengths",
+    "Accept-Datetime", "Set-Cookie2", "Cookies"
+  };
+  for (std::size_t index = 0; index < sizeof(names) / sizeof(names[0]); ++index)
+    BOOST_CHECK_EQUAL(lookup_header(names[index]), unknown_header);
+}
+
+BOOST_AUTO_TEST_CASE(headers_keep_insertion_order) {
+  header_storage storage;
+  storage.append("Set-Cookie", "a=1");
+  storage.append("X-Custom", "first");
+  storage.append("set-cookie", "b=2");
+  storage.append("x-custom", "second");
+  BOOST_CHECK_EQUAL(storage.size(), std::size_t(4));
+
+  collected all;
+  storage.for_each(collector(all));
+  BOOST_REQUIRE_EQUAL(all.size(), std::size_t(4));
+  BOOST_CHECK_EQUAL(all[0].first, "Set-Cookie");
+  BOOST_CHECK_EQUAL(all[3].first, "x-custom");
+
+  collected cookies;
+  storage.for_each("SET-COOKIE", collector(cookies));
+  BOOST_REQUIRE_EQUAL(cookies.size(), std::size_t(2));
+  BOOST_CHECK_EQUAL(cookies[0].second, "a=1");
+  BOOST_CHECK_EQUAL(cookies[1].second, "b=2");
+
+  collected custom;
+  storage.for_each("X-CUSTOM", collector(custom));
+  BOOST_REQUIRE_EQUAL(custom.size(), std::size_t(2));
+  BOOST_CHECK_EQUAL(custom[0].second, "first");
+  BOOST_CHECK_EQUAL(custom[1].second, "second");
+}
+
+BOOST_AUTO_TEST_CASE(remove_drops_every_value) {
+  header_storage storage;
+  storage.append("Host", "example.com");
+  storage.append("Accept", "text/html");
+  storage.append("X-Custom", "1");
+  storage.append("accept", "*/*");
+  storage.append("Via", "proxy");
+  storage.remove("ACCEPT");
+  storage.remove("x-custom");
+
+  collected all;
+  storage.for_each(collector(all));
+  BOOST_REQUIRE_EQUAL(all.size(), std::size_t(2));
+  BOOST_CHECK_EQUAL(all[0].first, "Host");
+  BOOST_CHECK_EQUAL(all[1].first, "Via");
+
+  collected via;
+  storage.for_each("via", collector(via));
+  BOOST_REQUIRE_EQUAL(via.size(), std::size_t(1));
+  BOOST_CHECK_EQUAL(via[0].second, "proxy");
+
+  storage.append("Accept", "image/png");
+  collected accept;
+  storage.for_each("Accept", collector(accept));
+  BOOST_REQUIRE_EQUAL(accept.size(), std::size_t(1));
+  BOOST_CHECK_EQUAL(accept[0].second, "image/png");
+
+  storage.clear();
+  BOOST_CHECK(storage.empty());
+}
+
+BOOST_AUTO_TEST_CASE(equality_ignores_the_order_of_different_names) {
+  header_storage left, right;
+  left.append("Host", "example.com");
+  left.append("X-Custom", "1");
+  right.append("X-Custom", "1");
+  right.append("Host", "example.com");
+  BOOST_CHECK(left.equals(right));
+  right.append("Host", "example.org");
+  BOOST_CHECK(!left.equals(right));
+}
+
+BOOST_AUTO_TEST_CASE(equality_keeps_the_order_of_repeated_values) {
+  header_storage left, right;
+  left.append("A", "1");
+  left.append("B", "x");
+  left.append("A", "2");
+  right.append("A", "1");
+  right.append("A", "2");
+  right.append("B", "x");
+  BOOST_CHECK(left.equals(right));
+  header_storage swapped;
+  swapped.append("A", "2");
+  swapped.append("A", "1");
+  swapped.append("B", "x");
+  BOOST_CHECK(!left.equals(swapped));
+}